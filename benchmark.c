@@ -0,0 +1,1237 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "kinectDetectionUtil.h"
+#include "kinectDense.h"
+#include "kinectCluster.h"
+#include "kinectTracking.h"
+#include "kinectPipeline.h"
+#include "kinectBackground.h"
+#include "kinectMatrix.h"
+#include "kinectCalibration.h"
+#include "kinectPlane.h"
+#include "kinectPublisher.h"
+#include "kinectNetwork.h"
+#include "kinectControl.h"
+#include "kinectProfile.h"
+
+///prototypes
+double elapsedTime(const struct timespec* start, const struct timespec* end);
+int benchmarkSimplify();
+int benchmarkPool(int nbFrames, const char* fileName, int maxCams);
+int benchmarkSampling(int nbFrames, const char* fileName);
+int benchmarkDense(int nbFrames, const char* fileName);
+int sameCloud(const TPointCloud* cloud, const TPointCloud* reference);
+int benchmarkMatrix();
+int benchmarkCalibration();
+int benchmarkPublisher();
+int benchmarkNetwork();
+int benchmarkControl();
+void* publishLoop(void* arg);
+int benchmarkBackground();
+int benchmarkBudget(int nbFrames, const char* fileName, int nbDeadlines, char* deadlines[]);
+int invertCofactor(TMatrix4D* invert, const TMatrix4D* m);
+float identityError(const TMatrix4D* m, const TMatrix4D* invert);
+int simplifyLinear(TCluster* clusters, int n, float tolerance);
+float maxPointError(TVecList* list, TVecList* reference);
+
+///functions
+int main(int argc, char* argv[])
+{
+	//floor and ceiling of the calibration, if any
+	TMatrix4D bases[MAXCAMERAS-1];
+	readCalibration("calibrationValues.cal", bases, MAXCAMERAS-1);
+	//input parameters
+	if(argc == 2 && strcmp(argv[1], "simplify") == 0){
+		return benchmarkSimplify();
+	}
+	if(argc == 2 && strcmp(argv[1], "matrix") == 0){
+		return benchmarkMatrix();
+	}
+	if(argc == 2 && strcmp(argv[1], "calibration") == 0){
+		return benchmarkCalibration();
+	}
+	if(argc == 2 && strcmp(argv[1], "publisher") == 0){
+		return benchmarkPublisher();
+	}
+	if(argc == 2 && strcmp(argv[1], "network") == 0){
+		return benchmarkNetwork();
+	}
+	if(argc == 2 && strcmp(argv[1], "control") == 0){
+		return benchmarkControl();
+	}
+	if(argc == 2 && strcmp(argv[1], "background") == 0){
+		return benchmarkBackground();
+	}
+	if(argc == 4 && strcmp(argv[1], "sampling") == 0){
+		return benchmarkSampling(atoi(argv[2]), argv[3]);
+	}
+	if(argc == 4 && strcmp(argv[1], "dense") == 0){
+		return benchmarkDense(atoi(argv[2]), argv[3]);
+	}
+	if(argc >= 4 && strcmp(argv[1], "budget") == 0){
+		return benchmarkBudget(atoi(argv[2]), argv[3], argc-4, argv+4);
+	}
+	if(argc == 5 && strcmp(argv[1], "pool") == 0){
+		return benchmarkPool(atoi(argv[2]), argv[3], atoi(argv[4]));
+	}
+	if(argc == 4 && strcmp(argv[1], "pool") == 0){
+		return benchmarkPool(atoi(argv[2]), NULL, atoi(argv[3]));
+	}
+	if(argc != 3 && argc != 4){
+		printf("usage: %s <number of frames> <main file> [<secondary file>]\n", argv[0]);
+		printf("       %s simplify\n", argv[0]);
+		printf("       %s pool <number of steps> <file> <maximum number of cameras>\n", argv[0]);
+		printf("       %s pool <number of steps> <maximum number of cameras>\n", argv[0]);
+		printf("       %s sampling <number of frames> <file>\n", argv[0]);
+		printf("       %s dense <number of frames> <file>\n", argv[0]);
+		printf("       %s budget <number of steps> <file> [<deadline in ms>...]\n", argv[0]);
+		printf("       %s matrix\n", argv[0]);
+		printf("       %s calibration\n", argv[0]);
+		printf("       %s publisher\n", argv[0]);
+		printf("       %s network\n", argv[0]);
+		printf("       %s control\n", argv[0]);
+		printf("       %s background\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	int nbFrames = atoi(argv[1]);
+	int nbCams = argc-2;
+	//set cameras replaying the recorded files as fast as possible
+	TDepthCamera cams[2];
+	TVecList lists[2];
+	TFrameSource source;
+	TRandom randoms[2];
+	int i, c;
+	for(c=0; c<nbCams; c++){
+		seedRandom(&(randoms[c]), 1, c);
+		createPrimaryCamera(&(cams[c]), c);
+		if(openReplaySource(&source, argv[c+2], REPLAYFAST | REPLAYLOOP)){
+			printf("Could not open %s.\n", argv[c+2]);
+			return EXIT_FAILURE;
+		}
+		setCameraSource(&(cams[c]), &source);
+	}
+	//point cloud for dense conversion
+	TPointCloud cloud;
+	TClusterGrid grid, sampleGrid;
+	TVecList denseList;
+	if(createPointCloud(&cloud, DEPTHSIZE) || createClusterGrid(&grid, 300, CLUSTERXYZ, 1024) || createClusterGrid(&sampleGrid, 300, CLUSTERXYZ, 64)){
+		printf("Could not allocate point cloud.\n");
+		return EXIT_FAILURE;
+	}
+	//change detection and background subtraction, then dense detection of the foreground
+	TBackground backgrounds[2];
+	TChangeMask changes[2];
+	short* foregrounds[2];
+	double changeTime = 0, backgroundTime = 0, foregroundTime = 0;
+	long nbForeground = 0, nbDirty = 0;
+	int nbSubtracted = 0;
+	for(c=0; c<nbCams; c++){
+		foregrounds[c] = malloc(DEPTHSIZE*sizeof(short));
+		if(foregrounds[c] == NULL || createBackground(&(backgrounds[c]), BACKGROUNDFRAMES, BACKGROUNDUPDATE) || createChangeMask(&(changes[c]), CHANGETHRESHOLD)){
+			printf("Could not allocate background model.\n");
+			return EXIT_FAILURE;
+		}
+	}
+	//tracked detection with a quarter of the samples, compared to the dense detection
+	TRegionTracker tracker;
+	TSamplingWindow window;
+	TVecList trackedList;
+	window.nbSamples = 0;
+	window.base = NULL;
+	initRegionTracker(&tracker, TRACKRATIO);
+	double trackTime = 0, uniformError = 0, trackError = 0;
+	int nbErrors = 0;
+	//filter of the detected positions
+	TKalmanTracker kalman;
+	double kalmanTime = 0;
+	int nbAccepted = 0;
+	initKalmanTracker(&kalman, KALMANACCELNOISE, KALMANMEASURENOISE);
+	//process depth maps
+	struct timespec start, end;
+	double readTime = 0, detectTime = 0, fuseTime = 0, denseTime = 0, clusterTime = 0;
+	long nbPoints = 0;
+	int nbClusters = 0;
+	unsigned int timestamp;
+	for(i=0; i<nbFrames; i++){
+		for(c=0; c<nbCams; c++){
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			if(updateCamera(&(cams[c]), &timestamp)){
+				printf("Could not read frame %d of %s.\n", i, argv[c+2]);
+				return EXIT_FAILURE;
+			}
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			readTime += elapsedTime(&start, &end);
+			detectDroneWindow(cams[c].data, &(lists[c]), &vec3DDistance, NULL, &(randoms[c]), &sampleGrid);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			detectTime += elapsedTime(&end, &start);
+			nbPoints += depthToPointCloud(kinectIntrinsics(), cams[c].data, &cloud);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			denseTime += elapsedTime(&start, &end);
+			detectDroneDense(cams[c].data, &cloud, &grid, &denseList);
+			nbClusters = grid.n;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			clusterTime += elapsedTime(&end, &start);
+			nbDirty += updateChangeMask(&(changes[c]), cams[c].data);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			changeTime += elapsedTime(&start, &end);
+			int learning = subtractBackground(&(backgrounds[c]), cams[c].data, foregrounds[c], &(changes[c]));
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			if(!learning){
+				backgroundTime += elapsedTime(&end, &start);
+				end = start;
+				nbForeground += backgrounds[c].nbForeground;
+				depthToPointCloud(kinectIntrinsics(), foregrounds[c], &cloud);
+				clusterPointCloud(&grid, &cloud);
+				resetClusterGrid(&grid);
+				clock_gettime(CLOCK_MONOTONIC, &start);
+				foregroundTime += elapsedTime(&end, &start);
+				nbSubtracted++;
+			}
+			if(c == 0){
+				int samples = nbIterations;
+				nbIterations /= 4;
+				trackerWindow(&tracker, kinectIntrinsics(), NULL, &window);
+				detectDroneWindow(cams[c].data, &trackedList, &vec3DDistance, &window, &(randoms[c]), &sampleGrid);
+				nbIterations = samples;
+				clock_gettime(CLOCK_MONOTONIC, &end);
+				trackTime += elapsedTime(&start, &end);
+				updateRegionTracker(&tracker, maxPointList(&trackedList));
+				if(denseList.n > 0){
+					uniformError += maxPointError(&(lists[c]), &denseList);
+					trackError += maxPointError(&trackedList, &denseList);
+					nbErrors++;
+				}
+			}
+		}
+		if(nbCams == 2){
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			fusePointList(&(lists[0]), &(lists[1]), 200, &vec3DDistance);
+			simplifyPointList(&(lists[0]), 200, &vec3DDistance);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			fuseTime += elapsedTime(&start, &end);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		nbAccepted += !updateKalmanTracker(&kalman, &(lists[0]), FRAMEPERIOD*1e-6);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		kalmanTime += elapsedTime(&start, &end);
+	}
+	//same seed, same detection
+	TVecList first, second;
+	seedRandom(&(randoms[0]), 1, 0);
+	detectDroneWindow(cams[0].data, &first, &vec3DDistance, NULL, &(randoms[0]), NULL);
+	seedRandom(&(randoms[0]), 1, 0);
+	detectDroneWindow(cams[0].data, &second, &vec3DDistance, NULL, &(randoms[0]), NULL);
+	int reproducible = first.n == second.n && memcmp(first.vector, second.vector, first.n*sizeof(TVec4D)) == 0 && memcmp(first.weight, second.weight, first.n*sizeof(first.weight[0])) == 0;
+	//transform of the whole point cloud to another base, batched and one vector at a time
+	TMatrix4D* transform = matrix4DTranslationRotationZ(1000, -500, 200, 0.5);
+	TVec4D* points = malloc(DEPTHSIZE*sizeof(TVec4D));
+	if(transform == NULL || points == NULL){
+		printf("Could not allocate transformed points.\n");
+		return EXIT_FAILURE;
+	}
+	int nbTransformed = depthToPointCloud(kinectIntrinsics(), cams[0].data, &cloud);
+	for(i=0; i<nbTransformed; i++){
+		points[i].x = cloud.x[i];
+		points[i].y = cloud.y[i];
+		points[i].z = cloud.z[i];
+		points[i].w = 1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	transformPointCloud(transform, &cloud);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double batchTime = elapsedTime(&start, &end);
+	for(i=0; i<nbTransformed; i++){
+		transformVec4D(&(points[i]), transform);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	double vectorTime = elapsedTime(&end, &start);
+	float transformError = 0;
+	for(i=0; i<nbTransformed; i++){
+		transformError = fmaxf(transformError, fabsf(points[i].x - cloud.x[i]) + fabsf(points[i].y - cloud.y[i]) + fabsf(points[i].z - cloud.z[i]));
+	}
+	free(points);
+	free(transform);
+	//floor and ceiling planes of the last depth map
+	TPlane floorFound, ceilingFound, oldFloor = floorPlane, oldCeiling = ceilingPlane;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int areaFound = !findFlightArea(cams[0].data, &cloud, &(randoms[0]));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double areaTime = elapsedTime(&start, &end);
+	floorFound = floorPlane;
+	ceilingFound = ceilingPlane;
+	floorPlane = oldFloor;
+	ceilingPlane = oldCeiling;
+	//nothing changes when the same depth map is compared again
+	double staticTime = 0;
+	for(i=0; i<nbFrames; i++){
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		updateChangeMask(&(changes[0]), cams[0].data);
+		subtractBackground(&(backgrounds[0]), cams[0].data, foregrounds[0], &(changes[0]));
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		staticTime += elapsedTime(&start, &end);
+	}
+	//display results
+	printf("Frames: %d, cameras: %d, samples per frame: %d\n", nbFrames, nbCams, nbIterations);
+	printf("Read:   %10.3f ms/frame\n", readTime*1000/nbFrames);
+	printf("Detect: %10.3f ms/frame (%.0f frames/s, %s)\n", detectTime*1000/nbFrames, nbFrames/detectTime, reproducible? "reproducible" : "not reproducible");
+	printf("Fuse:   %10.3f ms/frame\n", fuseTime*1000/nbFrames);
+	printf("Dense:  %10.3f ms/frame (%s, %ld points/frame)\n", denseTime*1000/nbFrames, pointCloudKernelName(), nbPoints/nbFrames);
+	printf("Dense detection: %10.3f ms/frame (%d clusters)\n", clusterTime*1000/nbFrames, nbClusters);
+	printf("Transform: %10.3f ms batched, %.3f ms per vector (%d points, difference %g mm)\n", batchTime*1000, vectorTime*1000, nbTransformed, transformError);
+	printf("Floor and ceiling: %.3f ms (%s)\n  floor ", areaTime*1000, areaFound? "found" : "not found");
+	displayPlane(&floorFound);
+	printf("\n  ceiling ");
+	displayPlane(&ceilingFound);
+	printf("\n");
+	printf("Change mask: %9.3f ms/frame (%ld of %d tiles changed/frame)\n", changeTime*1000/(nbFrames*nbCams), nbDirty/(nbFrames*nbCams), NBTILES);
+	printf("Unchanged depth map: %.3f ms/frame (change mask and background)\n", staticTime*1000/nbFrames);
+	if(nbSubtracted > 0){
+		printf("Background: %10.3f ms/frame (%ld foreground pixels/frame)\n", backgroundTime*1000/nbSubtracted, nbForeground/nbSubtracted);
+		printf("Dense detection of the foreground: %10.3f ms/frame\n", foregroundTime*1000/nbSubtracted);
+	}
+	printf("Tracked detection: %8.3f ms/frame (%d samples)\n", trackTime*1000/nbFrames, nbIterations/4);
+	printf("Kalman: %10.3f us/frame (%d accepted, confidence %.2f)\n", kalmanTime*1e6/nbFrames, nbAccepted, kalman.confidence);
+	if(nbErrors > 0){
+		printf("Error to dense detection: %.1f mm uniform, %.1f mm tracked\n", uniformError/nbErrors, trackError/nbErrors);
+	}
+	//free data
+	freePointCloud(&cloud);
+	freeClusterGrid(&grid);
+	freeClusterGrid(&sampleGrid);
+	for(c=0; c<nbCams; c++){
+		freeCamera(&(cams[c]));
+		freeBackground(&(backgrounds[c]));
+		freeChangeMask(&(changes[c]));
+		free(foregrounds[c]);
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Measures the number of depth maps processed per second by a detection pool with 1 to maxCams cameras.
+ * All cameras replay the same recorded file as fast as possible.
+ * Without a file, the cameras are synthetic sources giving depth maps at sensor rate, to run the pool without a Kinect:
+ * each step then waits for a new depth map, the background is removed, and the steps where the moving object is found are counted.
+ *
+ * @param Number of steps of the pool
+ * @param Name of the recorded file, NULL for synthetic sources
+ * @param Maximum number of cameras
+ */
+int benchmarkPool(int nbFrames, const char* fileName, int maxCams){
+	TDepthCamera cams[MAXCAMERAS];
+	TDetectionPool pool;
+	TVecList fusedList;
+	TFrameSource source;
+	struct timespec start, end;
+	int n, c, i;
+	if(maxCams > MAXCAMERAS){ maxCams = MAXCAMERAS; }
+	for(n=1; n<=maxCams; n++){
+		for(c=0; c<n; c++){
+			createPrimaryCamera(&(cams[c]), c);
+			if(fileName == NULL? openSyntheticSource(&source, c) : openReplaySource(&source, fileName, REPLAYFAST | REPLAYLOOP)){
+				printf("Could not open %s.\n", fileName == NULL? "the synthetic source" : fileName);
+				return EXIT_FAILURE;
+			}
+			setCameraSource(&(cams[c]), &source);
+		}
+		if(startDetectionPool(&pool, cams, n, 200, &vec3DDistance)){
+			printf("Could not start the detection pool.\n");
+			return EXIT_FAILURE;
+		}
+		seedDetectionPool(&pool, 1);
+		if(fileName == NULL && enableBackground(&pool, BACKGROUNDFRAMES, BACKGROUNDUPDATE)){
+			printf("Could not allocate the background models.\n");
+			return EXIT_FAILURE;
+		}
+		long nbDetections = 0, nbFound = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(i=0; i<nbFrames; i++){
+			int ret;
+			while((ret = runDetectionPool(&pool, &fusedList)) == 1 && fileName == NULL){
+				usleep(1000);
+			}
+			if(ret == -1){
+				printf("Could not read %s.\n", fileName == NULL? "the synthetic source" : fileName);
+				return EXIT_FAILURE;
+			}
+			for(c=0; c<n; c++){
+				nbDetections += (pool.status[c] == 0);
+			}
+			//the object of the synthetic depth maps is 2.5 m away and above the floor, which is 1 m below the camera
+			TVec4D* v = maxPointList(&fusedList);
+			nbFound += (v != NULL && fabsf(v->y - 2780) < 300 && v->z > -900);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		stopDetectionPool(&pool);
+		double time = elapsedTime(&start, &end);
+		printf("%d cameras: %8.0f depth maps/s, %8.0f steps/s", n, nbDetections/time, nbFrames/time);
+		if(fileName == NULL){
+			printf(", object found in %ld of %d steps", nbFound, nbFrames);
+		}
+		printf("\n");
+		for(c=0; c<n; c++){
+			freeCamera(&(cams[c]));
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Compares the accuracy of the sampling modes of detectDrone for several numbers of samples.
+ * The reference is the heaviest cluster of the dense detection of each depth map.
+ * A detection is a hit if its heaviest vector is closer than 100 mm to the reference.
+ *
+ * @param Number of depth maps
+ * @param Name of the recorded file
+ */
+int benchmarkSampling(int nbFrames, const char* fileName){
+	int counts[6] = {250, 500, 1000, 2000, 4000, 8000};
+	double error[NBSAMPLINGMODES][6];
+	int hits[NBSAMPLINGMODES][6];
+	int mode, k, i, nbRefs = 0;
+	TDepthCamera cam;
+	TFrameSource source;
+	TPointCloud cloud;
+	TClusterGrid grid, sampleGrid;
+	TVecList refList, list;
+	TRandom random;
+	unsigned int timestamp;
+	createPrimaryCamera(&cam, 0);
+	if(openReplaySource(&source, fileName, REPLAYFAST | REPLAYLOOP)){
+		printf("Could not open %s.\n", fileName);
+		return EXIT_FAILURE;
+	}
+	setCameraSource(&cam, &source);
+	if(createPointCloud(&cloud, DEPTHSIZE) || createClusterGrid(&grid, 300, CLUSTERXYZ, 1024) || createClusterGrid(&sampleGrid, 300, CLUSTERXYZ, 64)){
+		printf("Could not allocate point cloud.\n");
+		return EXIT_FAILURE;
+	}
+	memset(error, 0, sizeof(error));
+	memset(hits, 0, sizeof(hits));
+	seedRandom(&random, 1, 0);
+	int samples = nbIterations;
+	for(i=0; i<nbFrames; i++){
+		if(updateCamera(&cam, &timestamp)){
+			printf("Could not read frame %d of %s.\n", i, fileName);
+			return EXIT_FAILURE;
+		}
+		detectDroneDense(cam.data, &cloud, &grid, &refList);
+		TVec4D* ref = maxPointList(&refList);
+		if(ref == NULL){ continue; }
+		nbRefs++;
+		for(mode=0; mode<NBSAMPLINGMODES; mode++){
+			samplingMode = mode;
+			for(k=0; k<6; k++){
+				nbIterations = counts[k];
+				detectDroneWindow(cam.data, &list, &vec3DDistance, NULL, &random, &sampleGrid);
+				TVec4D* v = maxPointList(&list);
+				float d = (v == NULL)? 1000 : vec3DDistance(v, ref);
+				error[mode][k] += d < 1000? d : 1000;
+				hits[mode][k] += d < 100;
+			}
+		}
+	}
+	nbIterations = samples;
+	samplingMode = SAMPLINGRANDOM;
+	//display the curves, error in mm (limited to 1 m) and hit rate
+	printf("Frames with a reference: %d\n%8s", nbRefs, "samples");
+	for(mode=0; mode<NBSAMPLINGMODES; mode++){
+		printf(" %18s", samplingModeName(mode));
+	}
+	printf("\n");
+	for(k=0; k<6 && nbRefs>0; k++){
+		printf("%8d", counts[k]);
+		for(mode=0; mode<NBSAMPLINGMODES; mode++){
+			printf(" %8.1f mm %5.1f%%", error[mode][k]/nbRefs, 100.0*hits[mode][k]/nbRefs);
+		}
+		printf("\n");
+	}
+	freePointCloud(&cloud);
+	freeClusterGrid(&grid);
+	freeClusterGrid(&sampleGrid);
+	freeCamera(&cam);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Checks that all the kernels of depthToPointCloud and transformPoints supported by the CPU give identical point clouds.
+ * The depth maps of a recording are converted with tilted floor and ceiling planes, then a depth map made of edge values:
+ * depths around minDepth and maxDepth, and rows exactly on the floor and on the ceiling.
+ */
+int benchmarkDense(int nbFrames, const char* fileName){
+	static short edge[DEPTHSIZE];
+	const TIntrinsics* intr = kinectIntrinsics();
+	TDepthCamera cam;
+	TFrameSource source;
+	TPointCloud clouds[NBDENSEKERNELS];
+	TDetectionParams saved, params;
+	struct timespec start, end;
+	double time[NBDENSEKERNELS] = {0};
+	const char* names[NBDENSEKERNELS];
+	int nbKernels = 0, nbDifferent = 0, nbPoints = 0, i, k, xs, ys;
+	unsigned int timestamp;
+	while(nbKernels < NBDENSEKERNELS && setPointCloudKernel(nbKernels) == 0){
+		names[nbKernels] = pointCloudKernelName();
+		if(createPointCloud(&(clouds[nbKernels]), DEPTHSIZE)){
+			printf("Could not allocate point cloud.\n");
+			return EXIT_FAILURE;
+		}
+		nbKernels++;
+	}
+	createPrimaryCamera(&cam, 0);
+	if(openReplaySource(&source, fileName, REPLAYFAST | REPLAYLOOP)){
+		printf("Could not open %s.\n", fileName);
+		return EXIT_FAILURE;
+	}
+	setCameraSource(&cam, &source);
+	TMatrix4D* transform = matrix4DTranslationRotationZ(1000, -500, 200, 0.5);
+	if(transform == NULL){ return EXIT_FAILURE; }
+	getDetectionParams(&saved);
+	params = saved;
+	//tilted planes, so that every coefficient of the plane tests is used
+	params.floor = (TPlane){0.1f, -0.05f, 0.99373f, 900};
+	params.ceiling = (TPlane){-0.05f, 0.1f, -0.99373f, 1000};
+	//depth values around the limits, and rows of constant depth giving the same z for the floor and the ceiling
+	int values[] = {0, params.minDepth-1, params.minDepth, params.minDepth+1, params.maxDepth-1, params.maxDepth, params.maxDepth+1, 2047, 1500, 3000};
+	int nbValues = sizeof(values)/sizeof(values[0]);
+	//the floor row is the one with the lowest z, so that the rows between both planes are kept
+	int floorRow = DEPTHHEIGHT/4, ceilingRow = 3*DEPTHHEIGHT/4;
+	if(intr->rayZ[floorRow] > intr->rayZ[ceilingRow]){
+		floorRow = ceilingRow;
+		ceilingRow = DEPTHHEIGHT/4;
+	}
+	for(ys=0; ys<DEPTHHEIGHT; ys++){
+		for(xs=0; xs<DEPTHWIDTH; xs++){
+			edge[ys*DEPTHWIDTH+xs] = (ys == floorRow || ys == ceilingRow)? 2000 + xs%3 - 1 : values[(xs+ys)%nbValues];
+		}
+	}
+	for(i=0; i<=nbFrames; i++){
+		const short* data = edge;
+		if(i < nbFrames){
+			if(updateCamera(&cam, &timestamp)){
+				printf("Could not read frame %d of %s.\n", i, fileName);
+				return EXIT_FAILURE;
+			}
+			data = cam.data;
+		}else{
+			//the floor and the ceiling go through the points of depth 2000 of their row
+			params.floor = (TPlane){0, 0, 1, -(2000 + intr->depthOffset)*intr->rayZ[floorRow]};
+			params.ceiling = (TPlane){0, 0, -1, (2000 + intr->depthOffset)*intr->rayZ[ceilingRow]};
+		}
+		setDetectionParams(&params);
+		for(k=0; k<nbKernels; k++){
+			setPointCloudKernel(k);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			depthToPointCloud(intr, data, &(clouds[k]));
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			time[k] += elapsedTime(&start, &end);
+		}
+		nbPoints += clouds[0].n;
+		for(k=1; k<nbKernels; k++){
+			nbDifferent += !sameCloud(&(clouds[k]), &(clouds[0]));
+		}
+		//the transformation of the same points must be identical too
+		for(k=0; k<nbKernels; k++){
+			setPointCloudKernel(k);
+			transformPointCloud(transform, &(clouds[k]));
+		}
+		for(k=1; k<nbKernels; k++){
+			nbDifferent += !sameCloud(&(clouds[k]), &(clouds[0]));
+		}
+	}
+	setPointCloudKernel(DENSEFASTEST);
+	setDetectionParams(&saved);
+	printf("Depth maps: %d recorded and 1 of edge values, %d points\n", nbFrames, nbPoints);
+	for(k=0; k<nbKernels; k++){
+		printf("%-8s %7.3f ms/depth map\n", names[k], time[k]*1000/(nbFrames+1));
+		freePointCloud(&(clouds[k]));
+	}
+	printf("%d point clouds different from the scalar kernel\n", nbDifferent);
+	free(transform);
+	freeCamera(&cam);
+	return (nbDifferent == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Returns 1 if two point clouds have the same points in the same order, bit for bit, and 0 otherwise.
+ *
+ * @param Pointer to the point cloud
+ * @param Pointer to the reference point cloud
+ */
+int sameCloud(const TPointCloud* cloud, const TPointCloud* reference){
+	return cloud->n == reference->n && memcmp(cloud->x, reference->x, cloud->n*sizeof(float)) == 0
+		&& memcmp(cloud->y, reference->y, cloud->n*sizeof(float)) == 0 && memcmp(cloud->z, reference->z, cloud->n*sizeof(float)) == 0;
+}
+
+/**
+ * Compares simplifyLinear and mergeClusters on random clusters.
+ * The linear version is only run once on large lists.
+ * A chain of close clusters must not be merged into a single cluster.
+ */
+int benchmarkSimplify(){
+	int sizes[3] = {16, 1000, 100000};
+	int s, n;
+	struct timespec start, end;
+	srand(0);
+	for(s=0; s<3; s++){
+		TCluster* clusters = malloc(sizes[s]*sizeof(TCluster));
+		TCluster* copy = malloc(sizes[s]*sizeof(TCluster));
+		if(clusters == NULL || copy == NULL){ return EXIT_FAILURE; }
+		//random clusters in a 8m x 8m x 2m room, the number of clusters grows with the density
+		for(n=0; n<sizes[s]; n++){
+			clusters[n].x = rand()%8000 - 4000;
+			clusters[n].y = rand()%8000;
+			clusters[n].z = rand()%2000 - 1000;
+			clusters[n].weight = 1 + rand()%10;
+		}
+		int repeat = sizes[s] < 1000? 10000 : 1;
+		double linearTime, mergeTime;
+		int linearN = 0, mergeN = 0, r;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(r=0; r<repeat; r++){
+			memcpy(copy, clusters, sizes[s]*sizeof(TCluster));
+			linearN = simplifyLinear(copy, sizes[s], 200);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		linearTime = elapsedTime(&start, &end)/repeat;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(r=0; r<repeat; r++){
+			memcpy(copy, clusters, sizes[s]*sizeof(TCluster));
+			mergeN = mergeClusters(copy, sizes[s], 200, CLUSTERXYZ);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		mergeTime = elapsedTime(&start, &end)/repeat;
+		printf("%6d vectors: linear %10.4f ms (%d left), merge %10.4f ms (%d left), x%.1f\n", sizes[s], linearTime*1000, linearN, mergeTime*1000, mergeN, linearTime/mergeTime);
+		free(clusters);
+		free(copy);
+	}
+	//16 vectors in 4 groups, as the vector list of a depth map seeing the drone
+	TCluster groups[16], copy16[16];
+	for(n=0; n<16; n++){
+		groups[n].x = 1000*(n%4) + rand()%100;
+		groups[n].y = 3000 + rand()%100;
+		groups[n].z = rand()%100;
+		groups[n].weight = 1 + rand()%10;
+	}
+	int linearN = 0, mergeN = 0, r;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(r=0; r<10000; r++){
+		memcpy(copy16, groups, sizeof(groups));
+		linearN = simplifyLinear(copy16, 16, 200);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double linearTime = elapsedTime(&start, &end)/10000;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(r=0; r<10000; r++){
+		memcpy(copy16, groups, sizeof(groups));
+		mergeN = mergeClusters(copy16, 16, 200, CLUSTERXYZ);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double mergeTime = elapsedTime(&start, &end)/10000;
+	printf("%6d grouped: linear %10.4f ms (%d left), merge %10.4f ms (%d left), x%.1f\n", 16, linearTime*1000, linearN, mergeTime*1000, mergeN, linearTime/mergeTime);
+	//1000 clusters 100 mm apart on a line, each cluster is close to the next one
+	TCluster chain[1000];
+	for(n=0; n<1000; n++){
+		chain[n].x = 100*n;
+		chain[n].y = chain[n].z = 0;
+		chain[n].weight = 1;
+	}
+	int chainN = mergeClusters(chain, 1000, 200, CLUSTERXYZ);
+	printf("chain of 1000 vectors 100 mm apart: %d left\n", chainN);
+	return (chainN > 1)? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Compares invertMatrix and invertRigidMatrix to the former cofactor inversion, and multiplyMatrix to matrix4DMultiply.
+ * General matrices are made of 4 random points as during calibration, rigid ones are random rotations and translations.
+ */
+int benchmarkMatrix(){
+	#define NBMATRICES 1000
+	#define REPEAT 1000
+	static TMatrix4D general[NBMATRICES], rigid[NBMATRICES], invert[NBMATRICES];
+	struct timespec start, end;
+	int i, j, r, nbRejected = 0, nbRigid = 0;
+	srand(0);
+	for(i=0; i<NBMATRICES; i++){
+		//affine transformations, random linear part and translation in mm as given by a calibration
+		general[i] = translationRotationZMatrix(rand()%8000 - 4000, rand()%8000, rand()%2000 - 1000, 0);
+		for(j=0; j<12; j++){
+			if(j%4 != 3){ general[i].m[j] = 2.0f*rand()/RAND_MAX - 1; }
+		}
+		rigid[i] = translationRotationZMatrix(rand()%8000 - 4000, rand()%8000, rand()%2000 - 1000, rand()*6.283/RAND_MAX);
+	}
+	//accuracy, the product of a matrix by its inverse should be the identity
+	float cofactorError = 0, generalError = 0, rigidError = 0, cofactorRigidError = 0, multiplyError = 0;
+	for(i=0; i<NBMATRICES; i++){
+		//ill-conditioned matrices are left out of the comparison
+		if(invertMatrix(&(invert[i]), &(general[i]))){
+			nbRejected++;
+		}else{
+			generalError = fmaxf(generalError, identityError(&(general[i]), &(invert[i])));
+			invertCofactor(&(invert[i]), &(general[i]));
+			cofactorError = fmaxf(cofactorError, identityError(&(general[i]), &(invert[i])));
+		}
+		nbRigid += !invertRigidMatrix(&(invert[i]), &(rigid[i]));
+		rigidError = fmaxf(rigidError, identityError(&(rigid[i]), &(invert[i])));
+		invertCofactor(&(invert[i]), &(rigid[i]));
+		cofactorRigidError = fmaxf(cofactorRigidError, identityError(&(rigid[i]), &(invert[i])));
+		TMatrix4D product = multiplyMatrix(&(rigid[i]), &(general[i])), reference;
+		for(j=0; j<16; j++){
+			reference.m[j] = rigid[i].m[j & ~3]*general[i].m[j & 3] + rigid[i].m[(j & ~3)+1]*general[i].m[4+(j & 3)] + rigid[i].m[(j & ~3)+2]*general[i].m[8+(j & 3)] + rigid[i].m[(j & ~3)+3]*general[i].m[12+(j & 3)];
+			multiplyError = fmaxf(multiplyError, fabsf(product.m[j] - reference.m[j]));
+		}
+	}
+	//singular matrices must be rejected
+	TMatrix4D singular = general[0];
+	for(j=0; j<4; j++){ singular.m[8+j] = singular.m[j]*2; }
+	int singularRejected = invertMatrix(&(invert[0]), &singular);
+	int singularCofactor = invertCofactor(&(invert[0]), &singular);
+	//the condition does not depend on the distance between the cameras
+	TMatrix4D far = translationRotationZMatrix(5000, 2500, 200, 0.7);
+	far.m[0] *= 1.01f;
+	int farRejected = invertMatrix(&(invert[0]), &far);
+	float farError = identityError(&far, &(invert[0]));
+	//a tilted floor of camera 0 converted to a camera 5.6 m away gives the same distances
+	TPlane tilted = {0.1f, -0.05f, 0.9937f, 900}, converted = transformPlane(&tilted, &far);
+	float planeError = 0;
+	for(i=0; i<NBMATRICES; i++){
+		TVec4D v = {rand()%8000 - 4000, rand()%8000, rand()%2000 - 1000, 1}, w = v;
+		transformVec4D(&w, &far);
+		planeError = fmaxf(planeError, fabsf(planeDistance(&converted, &v) - planeDistance(&tilted, &w)/sqrtf(converted.a*converted.a + converted.b*converted.b + converted.c*converted.c)));
+	}
+	//speed
+	double cofactorTime, generalTime, rigidTime;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(r=0; r<REPEAT; r++){
+		for(i=0; i<NBMATRICES; i++){ invertCofactor(&(invert[i]), &(general[i])); }
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	cofactorTime = elapsedTime(&start, &end);
+	for(r=0; r<REPEAT; r++){
+		for(i=0; i<NBMATRICES; i++){ invertMatrix(&(invert[i]), &(general[i])); }
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	generalTime = elapsedTime(&end, &start);
+	for(r=0; r<REPEAT; r++){
+		for(i=0; i<NBMATRICES; i++){ invertRigidMatrix(&(invert[i]), &(rigid[i])); }
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	rigidTime = elapsedTime(&start, &end);
+	printf("Cofactors: %8.1f ns/matrix (error %g general, %g rigid)\n", cofactorTime*1e9/(REPEAT*NBMATRICES), cofactorError, cofactorRigidError);
+	printf("General:   %8.1f ns/matrix (error %g, %d ill-conditioned)\n", generalTime*1e9/(REPEAT*NBMATRICES), generalError, nbRejected);
+	printf("Rigid:     %8.1f ns/matrix (error %g, %d of %d rigid)\n", rigidTime*1e9/(REPEAT*NBMATRICES), rigidError, nbRigid, NBMATRICES);
+	printf("Multiply:  error %g\n", multiplyError);
+	printf("Singular matrix: %s, %s by the cofactors\n", singularRejected? "rejected" : "accepted", singularCofactor? "rejected" : "accepted");
+	printf("Affine matrix translated by 5.6 m: %s (error %g)\n", farRejected? "rejected" : "accepted", farError);
+	printf("Plane converted to its base: error %g mm\n", planeError);
+	return (singularRejected && !farRejected && farError < 1e-3f)? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Measures the error of calibrateRigid on positions of a target seen by two cameras with a known transformation.
+ * The positions are noisy and a part of them are replaced by outliers, as when a camera detects another object.
+ */
+int benchmarkCalibration(){
+	int outliers[4] = {0, 10, 30, 50};
+	int o, i, j;
+	TRandom random;
+	TCorrespondences corr;
+	struct timespec start, end;
+	seedRandom(&random, 1, 0);
+	if(createCorrespondences(&corr, CALIBRATIONFRAMES)){ return EXIT_FAILURE; }
+	//second camera on the other side of the room, slightly tilted
+	TMatrix4D tilt = identityMatrix(), truth, toCamera;
+	tilt.m[5] = tilt.m[10] = cos(0.1);
+	tilt.m[9] = sin(0.1);
+	tilt.m[6] = -tilt.m[9];
+	TMatrix4D turn = translationRotationZMatrix(500, 6000, 300, 2.8);
+	truth = multiplyMatrix(&turn, &tilt);
+	invertRigidMatrix(&toCamera, &truth);
+	for(o=0; o<4; o++){
+		corr.n = 0;
+		for(i=0; i<CALIBRATIONFRAMES; i++){
+			//random position in a 4m x 4m x 2m flight area, seen with 10 mm of noise by each camera
+			TVec4D reference = {(int)randomRange(&random, 4000) - 2000.0f, randomRange(&random, 4000) + 1000.0f, (int)randomRange(&random, 2000) - 1000.0f, 1};
+			TVec4D point = reference;
+			transformVec4D(&point, &toCamera);
+			point.x += (int)randomRange(&random, 21) - 10;
+			point.y += (int)randomRange(&random, 21) - 10;
+			point.z += (int)randomRange(&random, 21) - 10;
+			if((int)randomRange(&random, 100) < outliers[o]){
+				point.x += (int)randomRange(&random, 2000) - 1000;
+				point.y += (int)randomRange(&random, 2000) - 1000;
+			}
+			addCorrespondence(&corr, &point, &reference);
+		}
+		TMatrix4D transform;
+		TCalibrationError error;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		int failed = calibrateRigid(&corr, CALIBRATIONTHRESHOLD, CALIBRATIONITERATIONS, &random, &transform, &error);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		//distance to the true transformation over the flight area
+		float maxDistance = 0;
+		for(j=0; !failed && j<8; j++){
+			TVec4D corner = {(j & 1)? 2000 : -2000, (j & 2)? 5000 : 1000, (j & 4)? 1000 : -1000, 1}, expected = corner;
+			transformVec4D(&corner, &transform);
+			transformVec4D(&expected, &truth);
+			maxDistance = fmaxf(maxDistance, vec3DDistance(&corner, &expected));
+		}
+		printf("%2d%% outliers: %6.2f ms, %d inliers of %d, residual %.1f mm rms %.1f mm max, %.1f mm from the true transformation%s\n", outliers[o], elapsedTime(&start, &end)*1000, error.nbInliers, error.nbPoints, error.rmsError, error.maxError, maxDistance, failed? " (failed)" : "");
+	}
+	freeCorrespondences(&corr);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Measures the cost of sending a position packet to a growing number of subscribers on the loopback interface,
+ * with one sendmmsg by publishPacket and with one sendto per subscriber as the *2IP programs did.
+ */
+int benchmarkPublisher(){
+	#define NBPACKETS 10000
+	int counts[5] = {1, 2, 8, 32, MAXSUBSCRIBERS};
+	int receiver[MAXSUBSCRIBERS];
+	struct sockaddr_in addr[MAXSUBSCRIBERS];
+	socklen_t length = sizeof(struct sockaddr_in);
+	char packet[8] = {'k'}, address[32];
+	struct timespec start, end;
+	int k, i, r;
+	TPublisher pub;
+	if(openPublisher(&pub)){ return EXIT_FAILURE; }
+	//one bound socket per subscriber, so that the packets are actually delivered
+	for(i=0; i<MAXSUBSCRIBERS; i++){
+		memset(&(addr[i]), 0, sizeof(struct sockaddr_in));
+		addr[i].sin_family = AF_INET;
+		addr[i].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		receiver[i] = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if(receiver[i] == -1 || bind(receiver[i], (struct sockaddr*)&(addr[i]), length) || getsockname(receiver[i], (struct sockaddr*)&(addr[i]), &length)){
+			return EXIT_FAILURE;
+		}
+	}
+	for(k=0; k<5; k++){
+		while(subscriberCount(&pub) < counts[k]){
+			sprintf(address, "127.0.0.1:%d", ntohs(addr[subscriberCount(&pub)].sin_port));
+			if(addSubscriber(&pub, address)){ return EXIT_FAILURE; }
+		}
+		//every subscriber must receive the packet once
+		int reached = 0;
+		publishPacket(&pub, packet, sizeof(packet));
+		for(i=0; i<counts[k]; i++){
+			while(recv(receiver[i], address, sizeof(address), MSG_DONTWAIT) > 0){ reached++; }
+		}
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(r=0; r<NBPACKETS; r++){
+			publishPacket(&pub, packet, sizeof(packet));
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double publishTime = elapsedTime(&start, &end);
+		for(r=0; r<NBPACKETS; r++){
+			for(i=0; i<counts[k]; i++){
+				sendto(pub.socket, packet, sizeof(packet), 0, (struct sockaddr*)&(addr[i]), sizeof(struct sockaddr_in));
+			}
+		}
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		double sendtoTime = elapsedTime(&end, &start);
+		printf("%2d subscribers: sendmmsg %7.2f us/packet, sendto %7.2f us/packet, %d reached\n", counts[k], publishTime*1e6/NBPACKETS, sendtoTime*1e6/NBPACKETS, reached);
+		//empty the receive buffers before the next count
+		for(i=0; i<counts[k]; i++){
+			while(recv(receiver[i], address, sizeof(address), MSG_DONTWAIT) > 0);
+		}
+	}
+	printf("%ld packets published, %ld errors\n", pub.nbPackets, pub.nbErrors);
+	for(i=0; i<MAXSUBSCRIBERS; i++){
+		close(receiver[i]);
+	}
+	closePublisher(&pub);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Measures the time taken by queuePacket for 63 loopback subscribers and an unreachable one, the errors being counted.
+ * Packets are first queued every 500 us, then as fast as possible so that the network thread cannot keep up
+ * and the queue drops the oldest packets. The time taken by publishPacket is given for comparison.
+ */
+int benchmarkNetwork(){
+	int receiver[MAXSUBSCRIBERS];
+	struct sockaddr_in addr;
+	socklen_t length = sizeof(struct sockaddr_in);
+	char packet[8] = {'k'}, address[32];
+	struct timespec start, end;
+	int i, r;
+	TPublisher pub;
+	TNetworkThread net;
+	THistogram queueTime, publishTime;
+	initHistogram(&queueTime, "queuePacket");
+	initHistogram(&publishTime, "publishPacket");
+	if(openPublisher(&pub)){ return EXIT_FAILURE; }
+	for(i=0; i<MAXSUBSCRIBERS-1; i++){
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		receiver[i] = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if(receiver[i] == -1 || bind(receiver[i], (struct sockaddr*)&addr, length) || getsockname(receiver[i], (struct sockaddr*)&addr, &length)){
+			return EXIT_FAILURE;
+		}
+		sprintf(address, "127.0.0.1:%d", ntohs(addr.sin_port));
+		addSubscriber(&pub, address);
+	}
+	//broadcast without SO_BROADCAST, every packet sent to it fails
+	addSubscriber(&pub, "255.255.255.255");
+	for(r=0; r<NBPACKETS; r++){
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		publishPacket(&pub, packet, sizeof(packet));
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		recordLatency(&publishTime, (end.tv_sec - start.tv_sec)*1000000000L + (end.tv_nsec - start.tv_nsec));
+	}
+	long blockingErrors = pub.nbErrors;
+	pub.nbErrors = 0;
+	if(startNetworkThread(&net, &pub)){ return EXIT_FAILURE; }
+	for(r=0; r<2*NBPACKETS; r++){
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		queuePacket(&net, packet, sizeof(packet));
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		recordLatency(&queueTime, (end.tv_sec - start.tv_sec)*1000000000L + (end.tv_nsec - start.tv_nsec));
+		if(r < NBPACKETS/10){
+			usleep(500);
+		}else if(r == NBPACKETS/10){
+			//let the thread empty the queue
+			usleep(100000);
+			printf("Paced:  ");
+			displayNetworkThread(stdout, &net);
+		}
+	}
+	usleep(100000);
+	stopNetworkThread(&net);
+	printf("Burst:  ");
+	displayNetworkThread(stdout, &net);
+	printf("publishPacket: %d packets, %ld errors\n", NBPACKETS, blockingErrors);
+	displayHistogram(stdout, &publishTime);
+	displayHistogram(stdout, &queueTime);
+	for(i=0; i<MAXSUBSCRIBERS-1; i++){
+		close(receiver[i]);
+	}
+	closePublisher(&pub);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Sends commands to a control channel on the loopback interface and checks the replies,
+ * then measures getDetectionParams while the control thread publishes parameters as fast as it is allowed to.
+ * Each published block has the same value for the number of iterations and the cluster tolerance, so that a block
+ * read while it is being replaced would be seen.
+ */
+int benchmarkControl(){
+	const char* commands[] = {"get", "set iterations=2000 maxdepth=5000", "set fusion=150 floor=0,0,1,-900", "get",
+		"set iterations=0", "set mindepth=6000", "set floor=0,0,0,1", "set speed=2", "jump", "subscribe 127.0.0.1:6000", "get"};
+	int nbCommands = sizeof(commands)/sizeof(commands[0]);
+	char reply[CONTROLREPLY];
+	struct sockaddr_in addr;
+	struct timeval timeout = {1, 0};
+	struct timespec start, end;
+	TControlChannel control;
+	TPublisher pub;
+	TDetectionParams params;
+	int i, n, s, inconsistent = 0, versions = 0;
+	unsigned int lastVersion = 0;
+	long reads = 0;
+	if(openPublisher(&pub) || startControlChannel(&control, "127.0.0.1:5906", &pub)){
+		printf("Could not open the control channel.\n");
+		return EXIT_FAILURE;
+	}
+	s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(5906);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	for(i=0; i<nbCommands; i++){
+		sendto(s, commands[i], strlen(commands[i]), 0, (struct sockaddr*)&addr, sizeof(addr));
+		n = recv(s, reply, sizeof(reply)-1, 0);
+		reply[(n > 0)? n : 0] = '\0';
+		printf("%-36s -> %s\n", commands[i], reply);
+	}
+	//a remote client may only subscribe itself
+	struct sockaddr_in remote = addr;
+	inet_aton("10.0.0.9", &(remote.sin_addr));
+	int thirdParty = executeControlCommand("subscribe 10.0.0.5", reply, &pub, &remote);
+	printf("%-36s -> %s\n", "subscribe 10.0.0.5 from 10.0.0.9", reply);
+	int itself = executeControlCommand("subscribe 10.0.0.9:7000", reply, &pub, &remote);
+	printf("%-36s -> %s\n", "subscribe 10.0.0.9:7000 from 10.0.0.9", reply);
+	if(!thirdParty || itself){
+		printf("Remote subscriptions are not checked.\n");
+		return EXIT_FAILURE;
+	}
+	//reader against a writer publishing as fast as possible, iterations and cluster are always equal in a block
+	//the blocks published by the commands above are left out by their version
+	getDetectionParams(&params);
+	unsigned int commandVersion = params.version;
+	lastVersion = commandVersion;
+	atomic_long writes;
+	pthread_t writer;
+	atomic_init(&writes, 0);
+	if(pthread_create(&writer, NULL, publishLoop, &writes)){
+		printf("Could not start the writer.\n");
+		return EXIT_FAILURE;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do{
+		for(i=0; i<100000; i++){
+			getDetectionParams(&params);
+			if(params.version > commandVersion && params.nbIterations != (int)params.clusterTolerance){ inconsistent++; }
+			if(params.version != lastVersion){ versions++; lastVersion = params.version; }
+		}
+		reads += i;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+	}while(elapsedTime(&start, &end) < 1);
+	long nbWrites = atomic_load(&writes);
+	atomic_store(&writes, -1);
+	pthread_join(writer, NULL);
+	printf("getDetectionParams: %.1f ns per read, %ld reads, %ld writes, %d versions seen, %d inconsistent blocks\n", elapsedTime(&start, &end)*1e9/reads, reads, nbWrites, versions, inconsistent);
+	printf("control: %ld commands, %ld rejected\n", atomic_load(&(control.nbCommands)), atomic_load(&(control.nbRejected)));
+	stopControlChannel(&control);
+	closePublisher(&pub);
+	close(s);
+	return (inconsistent == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Function executed by a thread to publish parameters as fast as possible, with as many iterations as the cluster tolerance.
+ * Counts the publications until the counter is set to -1.
+ *
+ * @param Pointer to the counter of publications
+ */
+void* publishLoop(void* arg){
+	atomic_long* writes = arg;
+	TDetectionParams params;
+	long n = 0;
+	getDetectionParams(&params);
+	do{
+		params.nbIterations = 100 + n%1000;
+		params.clusterTolerance = params.nbIterations;
+		setDetectionParams(&params);
+		//fails once the counter is set to -1
+	}while(atomic_compare_exchange_strong(writes, &n, n+1) && ++n);
+	return NULL;
+}
+
+/**
+ * Learns the background of a wall at 3000 mm, then parks an object at 2000 mm over half of the depth map
+ * and checks that it stays in the foreground at first, then becomes part of the background.
+ * Returns EXIT_SUCCESS if the object is absorbed after BACKGROUNDPERSISTENCE updates.
+ */
+int benchmarkBackground(){
+	TBackground background;
+	TChangeMask change;
+	short* data = malloc(DEPTHSIZE*sizeof(short));
+	short* foreground = malloc(DEPTHSIZE*sizeof(short));
+	int i, frame, parked = 0, absorbed = -1, failures = 0;
+	int maxFrames = (BACKGROUNDPERSISTENCE + 2)*BACKGROUNDUPDATE;
+	if(data == NULL || foreground == NULL || createBackground(&background, BACKGROUNDFRAMES, BACKGROUNDUPDATE) || createChangeMask(&change, CHANGETHRESHOLD)){
+		printf("Could not allocate the background model.\n");
+		return EXIT_FAILURE;
+	}
+	for(i=0; i<DEPTHSIZE; i++){ data[i] = 3000; }
+	for(frame=0; frame<BACKGROUNDFRAMES; frame++){
+		updateChangeMask(&change, data);
+		subtractBackground(&background, data, foreground, &change);
+	}
+	for(i=0; i<DEPTHSIZE/2; i++){ data[i] = 2000; }
+	for(frame=0; frame<maxFrames && absorbed < 0; frame++){
+		updateChangeMask(&change, data);
+		subtractBackground(&background, data, foreground, &change);
+		if(frame == 0){ parked = background.nbForeground; }
+		if(background.nbForeground == 0){ absorbed = frame; }
+	}
+	printf("Parked object: %d foreground pixels when it stops, ", parked);
+	if(absorbed >= 0){
+		printf("none after %d depth maps (background %d mm)\n", absorbed+1, background.depth[0]);
+	}else{
+		printf("still %d after %d depth maps (background %d mm)\n", background.nbForeground, maxFrames, background.depth[0]);
+	}
+	if(parked != DEPTHSIZE/2 || absorbed < 0 || background.depth[0] != 2000 || background.depth[DEPTHSIZE-1] != 3000){
+		failures++;
+	}
+	freeBackground(&background);
+	freeChangeMask(&change);
+	free(data);
+	free(foreground);
+	return failures? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * Replays a recorded file through a detection pool of one camera, one new depth map per step, without budget
+ * then with each deadline. Gives the mean number of samples, the p50, p99 and max times, the missed deadlines
+ * and the depth maps without room for the minimum number of samples. Without deadlines, fractions of the p99 time without budget are used.
+ *
+ * @param Number of steps of the pool
+ * @param Name of the recorded file
+ * @param Number of deadlines
+ * @param Deadlines in milliseconds
+ */
+int benchmarkBudget(int nbFrames, const char* fileName, int nbDeadlines, char* deadlines[]){
+	const double fractions[] = {2, 1, 0.5, 0.25, 0.05};
+	double deadline[16];
+	TDepthCamera cam;
+	TDetectionPool pool;
+	TVecList fusedList;
+	TFrameSource source;
+	int d, i;
+	if(nbDeadlines > 16){ nbDeadlines = 16; }
+	for(d=-1; d<nbDeadlines; d++){
+		createPrimaryCamera(&cam, 0);
+		if(openReplaySource(&source, fileName, REPLAYFAST | REPLAYLOOP)){
+			printf("Could not open %s.\n", fileName);
+			return EXIT_FAILURE;
+		}
+		setCameraSource(&cam, &source);
+		if(startDetectionPool(&pool, &cam, 1, 200, &vec3DDistance)){
+			printf("Could not start the detection pool.\n");
+			return EXIT_FAILURE;
+		}
+		seedDetectionPool(&pool, 1);
+		if(d >= 0){
+			enableBudget(&pool, deadline[d], BUDGETMINSAMPLES);
+		}
+		long nbSamples = 0;
+		for(i=0; i<nbFrames; i++){
+			//each step detects in a new depth map
+			int status;
+			while((status = runDetectionPool(&pool, &fusedList)) == 1){
+				usleep(100);
+			}
+			if(status == -1){
+				printf("Could not read %s.\n", fileName);
+				return EXIT_FAILURE;
+			}
+			nbSamples += (d >= 0)? pool.window[0].nbSamples : nbIterations;
+		}
+		stopDetectionPool(&pool);
+		double p99 = histogramPercentile(&(pool.detectTime[0]), 0.99)/1e6;
+		if(d < 0){
+			printf("no budget:        ");
+			//deadlines relative to the time without budget
+			if(nbDeadlines == 0){
+				nbDeadlines = sizeof(fractions)/sizeof(fractions[0]);
+				for(i=0; i<nbDeadlines; i++){ deadline[i] = fractions[i]*p99; }
+			}else{
+				for(i=0; i<nbDeadlines; i++){ deadline[i] = atof(deadlines[i]); }
+			}
+		}else{
+			printf("deadline %6.3f ms:", deadline[d]);
+		}
+		printf(" %6ld samples, p50 %6.3f ms, p99 %6.3f ms, max %6.3f ms", nbSamples/nbFrames,
+			histogramPercentile(&(pool.detectTime[0]), 0.5)/1e6, p99, atomic_load(&(pool.detectTime[0].max))/1e6);
+		if(d >= 0){
+			printf(", %ld missed, %ld without room for %d samples", pool.budget[0].nbMissed, pool.budget[0].nbFloor, BUDGETMINSAMPLES);
+		}
+		printf("\n");
+		freeCamera(&cam);
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Inverts a matrix the same way as matrix4DInvert did before invertMatrix, with 16 cofactors.
+ * Returns 0 if inversion is a success and 1 if the determinant is 0.
+ *
+ * @param Pointer to the inverted matrix
+ * @param Pointer to the matrix to invert
+ */
+int invertCofactor(TMatrix4D* invert, const TMatrix4D* m){
+	int i, j;
+	float det = 0;
+	for(i=0; i<4; i++){
+		for(j=0;j<4; j++){
+			invert->m[j+4*i] = (((i+j)%2 == 0)? 1 : -1)*matrix4DCofactor(m, i, j);
+		}
+		det += m->m[i]*invert->m[4*i];
+	}
+	if(det == 0){
+		return 1;
+	}
+	for(i=0; i<16; i++){
+		invert->m[i] /= det;
+	}
+	return 0;
+}
+
+/**
+ * Returns the largest difference between the product of a matrix by its inverse and the identity.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the inverse of the matrix
+ */
+float identityError(const TMatrix4D* m, const TMatrix4D* invert){
+	TMatrix4D product = multiplyMatrix(m, invert);
+	float error = 0;
+	int i;
+	for(i=0; i<16; i++){
+		error = fmaxf(error, fabsf(product.m[i] - (i%5 == 0)));
+	}
+	return error;
+}
+
+/**
+ * Fuses close clusters the same way as simplifyPointList did before mergeClusters.
+ * Returns the new number of clusters.
+ *
+ * @param Pointer to the clusters
+ * @param Number of clusters
+ * @param Tolerance for fusing two clusters
+ */
+int simplifyLinear(TCluster* clusters, int n, float tolerance){
+	int i, j, k, ret;
+	do{
+		ret = 0;
+		for(i=0; i<n; i++){
+			for(j=i+1; j<n; j++){
+				float dx = clusters[i].x - clusters[j].x;
+				float dy = clusters[i].y - clusters[j].y;
+				float dz = clusters[i].z - clusters[j].z;
+				if(sqrt(dx*dx + dy*dy + dz*dz) < tolerance){
+					//fuse both clusters
+					int weight = clusters[i].weight + clusters[j].weight;
+					clusters[i].x = (clusters[i].x*clusters[i].weight + clusters[j].x*clusters[j].weight)/weight;
+					clusters[i].y = (clusters[i].y*clusters[i].weight + clusters[j].y*clusters[j].weight)/weight;
+					clusters[i].z = (clusters[i].z*clusters[i].weight + clusters[j].z*clusters[j].weight)/weight;
+					clusters[i].weight = weight;
+					//remove the second cluster
+					for(k=j+1; k<n; k++){
+						clusters[k-1] = clusters[k];
+					}
+					n--;
+					ret = 1;
+					j--;
+				}
+			}
+		}
+	}while(ret);
+	return n;
+}
+
+/**
+ * Returns the distance between the main vectors of two lists, or the tolerance of the detection if the first list is empty.
+ *
+ * @param Pointer to the vector list
+ * @param Pointer to the reference vector list
+ */
+float maxPointError(TVecList* list, TVecList* reference){
+	TVec4D* v = maxPointList(list);
+	if(v == NULL){ return 300; }
+	return vec3DDistance(v, maxPointList(reference));
+}
+
+/**
+ * Returns the time elapsed between two time stamps in seconds.
+ *
+ * @param Pointer to the first time stamp
+ * @param Pointer to the second time stamp
+ */
+double elapsedTime(const struct timespec* start, const struct timespec* end){
+	return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec)*1e-9;
+}
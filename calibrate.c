@@ -1,38 +1,70 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <time.h>
 #include <libfreenect_sync.h>
 #include "kinectDetectionUtil.h"
+#include "kinectCalibration.h"
+#include "kinectPlane.h"
+#include "kinectBackground.h"
 
 ///functions
-int main()
+int main(int argc, char* argv[])
 {
+	//input parameters
+	int nbCams = 2;
+	if(argc == 2){
+		nbCams = atoi(argv[1]);
+	}
+	if(argc > 2 || nbCams < 2 || nbCams > MAXCAMERAS){
+		printf("usage: %s [<number of Kinects, 2 to %d>]\n", argv[0], MAXCAMERAS);
+		return EXIT_FAILURE;
+	}
 	//set kinect angles to 0 & set LED color
-	if(freenect_sync_set_tilt_degs(0, 0)){
-        printf("Could not tilt device 0.\n");
-        return EXIT_FAILURE;
+	int c;
+	for(c=0; c<nbCams; c++){
+		if(freenect_sync_set_tilt_degs(0, c)){
+			printf("Could not tilt device %d.\n", c);
+			return EXIT_FAILURE;
+		}
+		if(freenect_sync_set_led((c == 0)? LED_GREEN : LED_YELLOW, c)){
+			printf("Could not change LED of device %d.\n", c);
+			return EXIT_FAILURE;
+		}
 	}
-	if(freenect_sync_set_led(LED_GREEN, 0)){
-        printf("Could not change LED of device 0.\n");
-        return EXIT_FAILURE;
+	//set cameras
+	TDepthCamera cams[MAXCAMERAS];
+	for(c=0; c<nbCams; c++){
+		createPrimaryCamera(&(cams[c]), c);
 	}
-	if(freenect_sync_set_tilt_degs(0, 1)){
-        printf("Could not tilt device 1.\n");
-        return EXIT_FAILURE;
+	TVecList list;
+	TVec4D positions[MAXCAMERAS];
+	TCorrespondences corr[MAXCAMERAS];
+	TMatrix4D transformMatrix[MAXCAMERAS-1];
+	TRandom random;
+	seedRandom(&random, time(NULL), 0);
+	TPointCloud cloud;
+	if(createPointCloud(&cloud, DEPTHSIZE)){
+		printf("Could not allocate the point cloud.\n");
+		return EXIT_FAILURE;
 	}
-	if(freenect_sync_set_led(LED_YELLOW, 1)){
-       	printf("Could not change LED of device 1.\n");
-        return EXIT_FAILURE;
+	for(c=1; c<nbCams; c++){
+		if(createCorrespondences(&(corr[c]), CALIBRATIONFRAMES)){
+			printf("Could not allocate the correspondences.\n");
+			return EXIT_FAILURE;
+		}
 	}
-	//increase precision for detection
-	nbIterations = 200000;
-	//set cameras
-	TDepthCamera mainCam, secCam;
-	createPrimaryCamera(&mainCam, 0);
-	createPrimaryCamera(&secCam, 1);
-	TVecList mainList, secList;
-	TVec4D mainPoints[4], secPoints[4];
-	int timestamp;
+	//only the moving target is detected, not the walls and the furniture
+	TBackground backgrounds[MAXCAMERAS];
+	short* foregrounds[MAXCAMERAS];
+	for(c=0; c<nbCams; c++){
+		foregrounds[c] = malloc(DEPTHSIZE*sizeof(short));
+		if(foregrounds[c] == NULL || createBackground(&(backgrounds[c]), BACKGROUNDFRAMES, BACKGROUNDUPDATE)){
+			printf("Could not allocate the background models.\n");
+			return EXIT_FAILURE;
+		}
+	}
+	unsigned int timestamp;
 	char exLoop;
 	///calibration
 	do{
@@ -40,182 +72,96 @@ int main()
 		char k;
 		do{
 			system("clear");
-			puts("Calibration:\nStep 1: Environment\nPlace the Kinects at the desired locations.\nBe careful that nothing is within view of both devices.\n\n");
+			puts("Calibration:\nStep 1: Environment\nPlace the Kinects at the desired locations.\nBe careful that nothing is within view of the devices.\n\n");
 		    puts("Press any key when you wish to capture the environment.\n");
 		    getchar();
-		    //get the depth map + get floor and ceiling for main camera
-		    int i;
-		    updateCamera(&mainCam, &timestamp);
-		    detectDrone(mainCam.data, &mainList, &vecHeightDifference);
-			//for all points in main list, check if max or min.
-		    for(i=0; i<mainList.n; i++){
-                if(mainList.vector[i].z >= 0){
-                    if(mainList.vector[i].z < maxZ){
-                        maxZ = mainList.vector[i].z;
-                    }
-                }else{
-                    if(mainList.vector[i].z > minZ){
-                        minZ = mainList.vector[i].z;
-                    }
-                }
-		    }
-			//get the depth map + get floor and ceiling for secondary camera
-		    updateCamera(&secCam, &timestamp);
-		    detectDrone(secCam.data, &secList, &vecHeightDifference);
-			//for all points in secondary list, check if max or min.
-		    for(i=0; i<secList.n; i++){
-                if(secList.vector[i].z >= 0){
-                    if(secList.vector[i].z < maxZ){
-                        maxZ = secList.vector[i].z;
-                    }
-                }else{
-                    if(secList.vector[i].z > minZ){
-                        minZ = secList.vector[i].z;
-                    }
-                }
-		    }
+			//floor and ceiling planes of the main camera, used by all cameras
+			updateCamera(&(cams[0]), &timestamp);
+			int notFound = findFlightArea(cams[0].data, &cloud, &random);
 		    //display values
 		    puts("\nEnvironment captured.\n");
-		    printf("Ceiling: %d, Floor: %d\n\n", maxZ, minZ);
+			printf("Floor: ");
+			displayPlane(&floorPlane);
+			printf("\nCeiling: ");
+			displayPlane(&ceilingPlane);
+			puts(notFound? "\nThe floor or the ceiling was not found." : "\n");
 			//suggest new capture
 		    puts("\nCapture again? [Y/N] ");
 		    k = getchar();
 		}while(k == 'y' || k == 'Y');
-		//adjust min and max for safety
-		minZ += 100;
-		maxZ -= 100;
-		//capture point 0
+		//follow a target moving through the flight area with all cameras
+		int f;
 		do{
 			system("clear");
-			puts("Calibration:\nStep 2: Kinect Position\n");
-		    puts("\nPlace a thin but tall object within view of both Kinects.\n\n");
-		    puts("Press any key when you wish to capture the environment.\n");
-		    getchar();
-		    //get the depth map + get P0
-		    updateCamera(&mainCam, &timestamp);
-		    detectDrone(mainCam.data, &mainList, &vec2DDistance);
-		    updateCamera(&secCam, &timestamp);
-		    detectDrone(secCam.data, &secList, &vec2DDistance);
-		    puts("\nEnvironment captured.\n");
-		    //extract most significant point + display values
-		    if(getMaxVectorFromList(&(mainPoints[0]), &mainList)){
-                puts("Failed to acquire a point for main camera.\n");
-		    }else{
-                puts("main P0:");
-                displayVec4(&(mainPoints[0]));
-		    }
-		    if(getMaxVectorFromList(&(secPoints[0]), &secList)){
-                puts("Failed to acquire a point for secondary camera.\n");
-		    }else{
-                puts("\n\nsec P0:");
-                displayVec4(&(secPoints[0]));
-		    }
+			puts("Calibration:\nStep 2: Kinect Position\n\n\nClear the view of all Kinects, hold the small object out of view.\n");
+			puts("Press any key when the view is clear, the background is learned during one second.\n");
+			getchar();
+			for(c=0; c<nbCams; c++){
+				resetBackground(&(backgrounds[c]));
+				do{
+					updateCamera(&(cams[c]), &timestamp);
+				}while(subtractBackground(&(backgrounds[c]), cams[c].data, foregrounds[c], NULL));
+			}
+			puts("\nMove the small object slowly through the flight area, within view of all Kinects.\nChange its height too.\n");
+			puts("Press any key when you wish to start the capture, it lasts a few seconds.\n");
+			getchar();
+			for(c=1; c<nbCams; c++){
+				corr[c].n = 0;
+			}
+			//the floor and the ceiling are in the base of the main camera, which is not known yet for the others
+			TPlane floorP = floorPlane, ceilingP = ceilingPlane;
+			setFlightArea(-1e9, 1e9);
+			for(f=0; f<CALIBRATIONFRAMES; f++){
+				//only keep the positions seen by all cameras
+				int seen = 1;
+				for(c=0; c<nbCams; c++){
+					updateCamera(&(cams[c]), &timestamp);
+					subtractBackground(&(backgrounds[c]), cams[c].data, foregrounds[c], NULL);
+					detectDroneWindow(foregrounds[c], &list, &vec3DDistance, NULL, &random, NULL);
+					seen &= !getMaxVectorFromList(&(positions[c]), &list);
+				}
+				for(c=1; seen && c<nbCams; c++){
+					addCorrespondence(&(corr[c]), &(positions[c]), &(positions[0]));
+				}
+			}
+			floorPlane = floorP;
+			ceilingPlane = ceilingP;
+			printf("\n%d positions seen by all Kinects.\n", corr[1].n);
 			//suggest new capture
-		    puts("\nCapture again? [Y/N] ");
-		    k = getchar();
-		}while(k == 'y' || k == 'Y');
-		//capture point 1
-		do{
-		    system("clear");
-			puts("Move the object by about a meter in any direction.\nThe object must remain within view of both Kinects\n\n");
-		    puts("Press any key when you wish to capture the environment.\n");
-		    getchar();
-		    //get the depth map + get P1
-		    updateCamera(&mainCam, &timestamp);
-		    detectDrone(mainCam.data, &mainList, &vec2DDistance);
-		    updateCamera(&secCam, &timestamp);
-		    detectDrone(secCam.data, &secList, &vec2DDistance);
-		    puts("\nEnvironment captured.\n");
-		    //extract most significant point + display values
-		    if(getMaxVectorFromList(&(mainPoints[1]), &mainList)){
-                puts("Failed to acquire a point for main camera.\n");
-		    }else{
-                puts("main P1:");
-                displayVec4(&(mainPoints[1]));
-		    }
-		    if(getMaxVectorFromList(&(secPoints[1]), &secList)){
-                puts("Failed to acquire a point for secondary camera.\n");
-		    }else{
-                puts("\n\nsec P1:");
-                displayVec4(&(secPoints[1]));
-		    }
-		    //suggest new capture
-		    puts("\nCapture again? [Y/N] ");
-		    k = getchar();
-		}while(k == 'y' || k == 'Y');
-		//capture point 2
-		do{
-		    system("clear");
-			puts("Move the object by about a meter in an other direction.\nThe object must remain within view of both Kinects\n\n");
-		    puts("Press any key when you wish to capture the environment.\n");
-		    getchar();
-		    //get the depth map + get P2
-		    updateCamera(&mainCam, &timestamp);
-		    detectDrone(mainCam.data, &mainList, &vec2DDistance);
-		    updateCamera(&secCam, &timestamp);
-		    detectDrone(secCam.data, &secList, &vec2DDistance);
-		    puts("\nEnvironment captured.\n");
-		    //extract most significant point + display values
-		    if(getMaxVectorFromList(&(mainPoints[2]), &mainList)){
-                puts("Failed to acquire a point for main camera.\n");
-		    }else{
-                puts("main P2:\n");
-                displayVec4(&(mainPoints[2]));
-		    }
-		    if(getMaxVectorFromList(&(secPoints[2]), &secList)){
-                puts("Failed to acquire a point for secondary camera.\n");
-		    }else{
-                puts("\n\nsec P2:");
-                displayVec4(&(secPoints[2]));
-		    }
-		    //suggest new capture
-		    puts("\nCapture again? [Y/N] ");
-		    k = getchar();
+			puts("\nCapture again? [Y/N] ");
+			k = getchar();
 		}while(k == 'y' || k == 'Y');
-		//adjust P1 and P2
-		mainPoints[1].z = mainPoints[0].z;
-		mainPoints[2].z = mainPoints[0].z;
-		secPoints[1].z = secPoints[0].z;
-		secPoints[2].z = secPoints[0].z;
-		//calculate P3
-		mainPoints[3].x = mainPoints[0].x;
-		mainPoints[3].y = mainPoints[0].y;
-		mainPoints[3].z = mainPoints[0].z + 1000;
-		mainPoints[3].w = mainPoints[0].w;
-		secPoints[3].x = secPoints[0].x;
-		secPoints[3].y = secPoints[0].y;
-		secPoints[3].z = secPoints[0].z + 1000;
-		secPoints[3].w = secPoints[0].w;
-		//get M0 and M1
-		TMatrix4D M0, M1, invM1, transformMatrix;
-		matrix4DGetFromVectors(&M0, mainPoints);
-		matrix4DGetFromVectors(&M1, secPoints);
-		//invert M1
-        if(matrix4DInvert(&invM1, &M1)){
-            puts("Failed to create transformation matrix.");
-        }else{
-            //get transformation matrix
-            matrix4DMultiply(&transformMatrix, &M0, &invM1);
-            //display matrix
-            puts("Transformation Matrix:\n");
-            displayMatrix4(&transformMatrix);
-			FILE* pFile = NULL;
-			pFile = fopen("calibrationValues.cal", "w");
-			if(pFile != NULL){
-                fwrite(&minZ, sizeof(int), 1, pFile);
-                fwrite(&maxZ, sizeof(int), 1, pFile);
-				fwrite(&transformMatrix, sizeof(TMatrix4D), 1, pFile);
-				fclose(pFile);
-				puts("Calibration data saved.");
+		//get the rigid transformation from each secondary camera to the main camera
+		int failed = 0;
+		for(c=1; c<nbCams; c++){
+			TCalibrationError error;
+			if(calibrateRigid(&(corr[c]), CALIBRATIONTHRESHOLD, CALIBRATIONITERATIONS, &random, &(transformMatrix[c-1]), &error)){
+				printf("Failed to create transformation matrix of camera %d (%d inliers of %d positions).\n", c, error.nbInliers, error.nbPoints);
+				failed = 1;
+			}else{
+				//display matrix and residual error
+				printf("Transformation Matrix of camera %d:\n\n", c);
+				displayMatrix4(&(transformMatrix[c-1]));
+				printf("%d inliers of %d positions, error %.1f mm rms, %.1f mm max\n\n", error.nbInliers, error.nbPoints, error.rmsError, error.maxError);
 			}
-        }
+		}
+		if(!failed && writeCalibration("calibrationValues.cal", transformMatrix, nbCams-1) == 0){
+			puts("Calibration data saved.");
+		}
 		//suggest new calibration
 		puts("\nCalibrate again? [Y/N] ");
 		exLoop = getchar();
 	}while(exLoop == 'y' || exLoop == 'Y');
 	//free data
-	freeCamera(&mainCam);
-	freeCamera(&secCam);
+	freePointCloud(&cloud);
+	for(c=0; c<nbCams; c++){
+		freeCamera(&(cams[c]));
+		freeBackground(&(backgrounds[c]));
+		free(foregrounds[c]);
+		if(c > 0){
+			freeCorrespondences(&(corr[c]));
+		}
+	}
 	//stop kinects
 	freenect_sync_stop();
 	return EXIT_SUCCESS;
@@ -1,8 +1,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <time.h>
 #include <libfreenect_sync.h>
 #include "kinectDetectionUtil.h"
+#include "kinectPlane.h"
 
 ///functions
 int main()
@@ -16,13 +18,17 @@ int main()
         printf("Could not change LED of device 0.\n");
         return EXIT_FAILURE;
 	}
-	//increase precision for detection
-	nbIterations = 200000;
 	//set cameras
 	TDepthCamera mainCam;
 	createPrimaryCamera(&mainCam, 0);
-	TVecList mainList;
-	int timestamp;
+	TPointCloud cloud;
+	TRandom random;
+	seedRandom(&random, time(NULL), 0);
+	if(createPointCloud(&cloud, DEPTHSIZE)){
+		printf("Could not allocate the point cloud.\n");
+		return EXIT_FAILURE;
+	}
+	unsigned int timestamp;
 	char exLoop;
 	///calibration
 	do{
@@ -33,38 +39,21 @@ int main()
 			puts("Calibration:\nStep 1: Environment\nPlace the Kinects at the desired locations.\nBe careful that nothing is within view of both devices.\n\n");
 		    puts("Press any key when you wish to capture the environment.\n");
 		    getchar();
-		    //get the depth map + get floor and ceiling for main camera
-		    int i;
+		    //get the depth map + get floor and ceiling planes for main camera
 		    updateCamera(&mainCam, &timestamp);
-		    detectDrone(mainCam.data, &mainList, &vecHeightDifference);
-			//for all points in main list, check if max or min.
-		    for(i=0; i<mainList.n; i++){
-                if(mainList.vector[i].z >= 0){
-                    if(mainList.vector[i].z < maxZ){
-                        maxZ = mainList.vector[i].z;
-                    }
-                }else{
-                    if(mainList.vector[i].z > minZ){
-                        minZ = mainList.vector[i].z;
-                    }
-                }
-		    }
+			int notFound = findFlightArea(mainCam.data, &cloud, &random);
 		    //display values
 		    puts("\nEnvironment captured.\n");
-		    printf("Ceiling: %d, Floor: %d\n\n", maxZ, minZ);
+			printf("Floor: ");
+			displayPlane(&floorPlane);
+			printf("\nCeiling: ");
+			displayPlane(&ceilingPlane);
+			puts(notFound? "\nThe floor or the ceiling was not found." : "\n");
 			//suggest new capture
 		    puts("\nCapture again? [Y/N] ");
 		    k = getchar();
 		}while(k == 'y' || k == 'Y');
-		//adjust min and max for safety
-		minZ += 100;
-		maxZ -= 100;
-		FILE* pFile = NULL;
-		pFile = fopen("calibrationValuesOne.cal", "w");
-		if(pFile != NULL){
-			fwrite(&minZ, sizeof(int), 1, pFile);
-			fwrite(&maxZ, sizeof(int), 1, pFile);
-			fclose(pFile);
+		if(writeCalibration("calibrationValuesOne.cal", NULL, 0) == 0){
 			puts("Calibration data saved.");
 		}
 		//suggest new calibration
@@ -73,6 +62,7 @@ int main()
 	}while(exLoop == 'y' || exLoop == 'Y');
 	//free data
 	freeCamera(&mainCam);
+	freePointCloud(&cloud);
 	//stop kinects
 	freenect_sync_stop();
 	return EXIT_SUCCESS;
@@ -1,16 +1,16 @@
 //Compiler instructions for one kinect
-gcc calibrateOneKinect.c kinectDetectionUtil.c -o calibrateOne -lm -lfreenect_sync;
-gcc detectOneKinect.c kinectDetectionUtil.c -o detectOne -lm -lfreenect_sync -pthread
+gcc calibrateOneKinect.c kinectDetectionUtil.c kinectMatrix.c kinectPlane.c kinectFrameSource.c kinectRecording.c kinectCluster.c kinectDense.c -o calibrateOne -lm -lfreenect_sync -pthread;
+gcc detectOneKinect.c kinectDetectionUtil.c kinectMatrix.c kinectFrameSource.c kinectRecording.c kinectCluster.c kinectDense.c kinectChange.c kinectBackground.c kinectProfile.c kinectStatus.c kinectExchange.c kinectTracking.c kinectPublisher.c kinectNetwork.c kinectControl.c kinectPacket.c kinectBudget.c -o detectOne -lm -lfreenect_sync -pthread
 
 //Compiler instructions for two kinects
-gcc calibrate.c kinectDetectionUtil.c -o calibrate -lm -lfreenect_sync;
-gcc detect.c kinectDetectionUtil.c -o detect -lm -lfreenect_sync -pthread;
+gcc calibrate.c kinectDetectionUtil.c kinectCalibration.c kinectPlane.c kinectMatrix.c kinectFrameSource.c kinectRecording.c kinectCluster.c kinectDense.c kinectChange.c kinectBackground.c -o calibrate -lm -lfreenect_sync -pthread;
+gcc detect.c kinectDetectionUtil.c kinectMatrix.c kinectFrameSource.c kinectRecording.c kinectCluster.c kinectDense.c kinectChange.c kinectBackground.c kinectProfile.c kinectStatus.c kinectExchange.c kinectTracking.c kinectCapture.c kinectPipeline.c kinectBudget.c kinectPublisher.c kinectNetwork.c kinectControl.c kinectPacket.c -o detect -lm -lfreenect_sync -pthread;
 
 
-//Compiler instructions for one kinect to 2 IPs
-gcc detectOneKinect2IP.c kinectDetectionUtil.c -o detectOne2IP -lm -lfreenect_sync -pthread
-
-//Compiler instructions for two kinects to IPs
-gcc detect2IP.c kinectDetectionUtil.c -o detect2IP -lm -lfreenect_sync -pthread;
+//Compiler instructions for the reference receiver, which does not need libfreenect
+gcc receive.c kinectPacket.c -o receive -pthread;
 
 
+//Compiler instructions for recording and offline benchmarking
+gcc record.c kinectDetectionUtil.c kinectMatrix.c kinectFrameSource.c kinectRecording.c kinectCluster.c kinectDense.c -o record -lm -lfreenect_sync -pthread;
+gcc benchmark.c kinectDetectionUtil.c kinectCalibration.c kinectPlane.c kinectMatrix.c kinectFrameSource.c kinectRecording.c kinectCluster.c kinectDense.c kinectChange.c kinectBackground.c kinectTracking.c kinectCapture.c kinectExchange.c kinectPipeline.c kinectBudget.c kinectProfile.c kinectPublisher.c kinectNetwork.c kinectControl.c -o benchmark -lm -lfreenect_sync -pthread;
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <stdio.h>
@@ -10,13 +11,19 @@
 #include <time.h>
 #include <libfreenect_sync.h>
 #include <pthread.h>
+#include <signal.h>
 #include "kinectDetectionUtil.h"
-
-#define BUFLEN 8
-#define PORT 5005
+#include "kinectPipeline.h"
+#include "kinectMatrix.h"
+#include "kinectTracking.h"
+#include "kinectProfile.h"
+#include "kinectStatus.h"
+#include "kinectPublisher.h"
+#include "kinectNetwork.h"
+#include "kinectControl.h"
+#include "kinectPacket.h"
 
 ///prototypes
-void writePacket(char* packet, char type, short data1, short data2, short data3);
 void *readAsync(void *threadid);
 
 ///global variables
@@ -25,64 +32,93 @@ int contLoop;
 ///functions
 int main(int argc, char* argv[])
 {
-	//input parameters
-	if(argc != 2){
-		printf("usage: %s <ip>\n", argv[0]);
-        return EXIT_FAILURE;
-	}
-	//set Kinect angles to 0 & set LED colour
-	if(freenect_sync_set_tilt_degs(0, 0)){
-        printf("Could not tilt device 0.\n");
-        return EXIT_FAILURE;
-	}
-	if(freenect_sync_set_led(LED_GREEN, 0)){
-        printf("Could not change LED of device 0.\n");
-        return EXIT_FAILURE;
+	//input parameters, the subscribers are given as addresses or listed in files
+	TPublisher publisher;
+	float rate = STATUSRATE;
+	int i, protocol = 0;
+	const char* controlAddress = NULL;
+	double deadline = 0;
+	char buf[POSITIONPACKETSIZE];
+	if(openPublisher(&publisher)){
+		fprintf(stderr, "socket() failed\n");
+		return 1;
 	}
-	if(freenect_sync_set_tilt_degs(0, 1)){
-        printf("Could not tilt device 1.\n");
-        return EXIT_FAILURE;
+	for(i=1; i<argc; i++){
+		if(strcmp(argv[i], "-r") == 0 && i+1 < argc){
+			rate = atof(argv[++i]);
+		}else if(strcmp(argv[i], "-p") == 0 && i+1 < argc){
+			protocol = atoi(argv[++i]);
+			if(protocol != 0 && protocol != POSITIONPACKETVERSION){
+				fprintf(stderr, "Unknown protocol version %d\n", protocol);
+				return 1;
+			}
+		}else if(strcmp(argv[i], "-b") == 0 && i+1 < argc){
+			deadline = atof(argv[++i]);
+			if(deadline <= 0){
+				fprintf(stderr, "Invalid deadline %s\n", argv[i]);
+				return 1;
+			}
+		}else if(strcmp(argv[i], "-c") == 0 && i+1 < argc){
+			controlAddress = argv[++i];
+		}else if(strcmp(argv[i], "-f") == 0 && i+1 < argc){
+			if(loadSubscribers(&publisher, argv[++i]) < 0){
+				fprintf(stderr, "Could not read the subscribers of %s\n", argv[i]);
+				return 1;
+			}
+		}else if(addSubscriber(&publisher, argv[i])){
+			fprintf(stderr, "Invalid subscriber %s\n", argv[i]);
+			return 1;
+		}
 	}
-	if(freenect_sync_set_led(LED_YELLOW, 1)){
-        printf("Could not change LED of device 1.\n");
+	if(subscriberCount(&publisher) == 0){
+		printf("usage: %s <ip[:port]>... [-f <subscriber file>] [-r <display rate, 0 for none>] [-p <protocol version, 0 for legacy>] [-c <[ip:]control port>] [-b <deadline of a depth map in ms>]\n", argv[0]);
         return EXIT_FAILURE;
 	}
-	//set UDP socket
-	struct sockaddr_in si_other;
-	int s, i, slen=sizeof(si_other);
-	char buf[BUFLEN];
-	if ((s=socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP))==-1){
-		fprintf(stderr, "socket() failed\n");
-		return 1;
-	}
-	memset((char *) &si_other, 0, sizeof(si_other));
-	si_other.sin_family = AF_INET;
-	si_other.sin_port = htons(PORT);
-	if (inet_aton(argv[1], &si_other.sin_addr)==0) {
-		fprintf(stderr, "inet_aton() failed\n");
+	//packets are sent by a separate thread, detection never waits for the network
+	TNetworkThread network;
+	if(startNetworkThread(&network, &publisher)){
+		fprintf(stderr, "Could not start the network thread.\n");
 		return 1;
 	}
-	//set cameras
-	TDepthCamera mainCam, secCam;
-	createPrimaryCamera(&mainCam, 0);
-	createPrimaryCamera(&secCam, 1);
-	//get calibration values acquired by calibration program.
-	FILE* pFile = NULL;
-	pFile = fopen("calibrationValues.cal", "r");
-	if(pFile == NULL){
+	//get calibration values acquired by calibration program, one matrix per secondary Kinect
+	TMatrix4D bases[MAXCAMERAS-1];
+	int c, nbCams, nbBases = readCalibration("calibrationValues.cal", bases, MAXCAMERAS-1);
+	if(nbBases < 0){
 		puts("Could not get calibration data.");
+		nbBases = 0;
+		nbCams = 2;
 	}else{
-		fread(&minZ, sizeof(int), 1, pFile);
-		fread(&maxZ, sizeof(int), 1, pFile);
-		fread(secCam.base, sizeof(TMatrix4D), 1, pFile);
+		nbCams = nbBases + 1;
+	}
+	//set cameras
+	TDepthCamera cams[MAXCAMERAS];
+	for(c=0; c<nbCams; c++){
+		//set Kinect angles to 0 & set LED colour
+		if(freenect_sync_set_tilt_degs(0, c)){
+			printf("Could not tilt device %d.\n", c);
+			return EXIT_FAILURE;
+		}
+		if(freenect_sync_set_led((c == 0)? LED_GREEN : LED_YELLOW, c)){
+			printf("Could not change LED of device %d.\n", c);
+			return EXIT_FAILURE;
+		}
+		createPrimaryCamera(&(cams[c]), c);
+		if(c > 0 && c <= nbBases){
+			*(cams[c].base) = bases[c-1];
+		}
 	}
-	fclose(pFile);
-	TVecList mainList, secList;
-	unsigned int timestamp;
+	TVecList fusedList;
 	contLoop = 1;
 	//show current calibration values.
-	printf("Current calibration values:\nCeiling: %d, Floor: %d\nTransformation matrix:\n", maxZ, minZ);
-	displayMatrix4(secCam.base);
+	printf("Current calibration values:\nFloor: ");
+	displayPlane(&floorPlane);
+	printf("\nCeiling: ");
+	displayPlane(&ceilingPlane);
+	printf("\n");
+	for(c=1; c<nbCams; c++){
+		printf("Transformation matrix of device %d:\n", c);
+		displayMatrix4(cams[c].base);
+	}
 	puts("\n\nAre those values correct? [Y/N]");
 	char tmpChar = getchar();
 	if(tmpChar == 'N' || tmpChar == 'n'){
@@ -99,53 +135,142 @@ int main(int argc, char* argv[])
 		printf("ERROR; return code from pthread_create() is %d\n", rc);
 		exit(-1);
 	}
+	//start acquisition and detection threads for all Kinects
+	TDetectionPool pool;
+	if(startDetectionPool(&pool, cams, nbCams, fusionTolerance, &vec3DDistance)){
+		printf("Could not start the threads of the Kinects.");
+		return EXIT_FAILURE;
+	}
+	//only detect what is not part of the room, learned during the first depth maps
+	if(enableBackground(&pool, BACKGROUNDFRAMES, BACKGROUNDUPDATE)){
+		printf("Could not allocate the background models.");
+		return EXIT_FAILURE;
+	}
+	//adapt the number of samples of each Kinect to the deadline
+	if(deadline > 0){
+		enableBudget(&pool, deadline, BUDGETMINSAMPLES);
+	}
+	//track the drone to focus sampling around its last position
+	TRegionTracker tracker;
+	TMatrix4D inverses[MAXCAMERAS];
+	initRegionTracker(&tracker, TRACKRATIO);
+	//filter the detected position over time
+	TKalmanTracker kalman;
+	TVec4D position;
+	TPositionPacket packet;
+	uint32_t sequence = 0;
+	struct timespec now, lastUpdate;
+	initKalmanTracker(&kalman, KALMANACCELNOISE, KALMANMEASURENOISE);
+	clock_gettime(CLOCK_MONOTONIC, &lastUpdate);
+	//time each stage of the main loop, displayed on SIGUSR1 and on exit
+	TProfile profile;
+	initProfile(&profile);
+	int detectStage = addProfileStage(&profile, "detect");
+	int simplifyStage = addProfileStage(&profile, "simplify");
+	int trackStage = addProfileStage(&profile, "track");
+	int displayStage = addProfileStage(&profile, "display");
+	int sendStage = addProfileStage(&profile, "send");
+	watchProfileSignal(SIGUSR1);
+	//display the status from a separate thread
+	TStatusDisplay display;
+	TStatus status;
+	status.frame = 0;
+	if(startStatusDisplay(&display, rate)){
+		printf("Could not start the status display.");
+		return EXIT_FAILURE;
+	}
+	//clients may change the parameters of the detection while it runs
+	TControlChannel control;
+	if(controlAddress != NULL && startControlChannel(&control, controlAddress, &publisher)){
+		printf("Could not open the control channel on %s.", controlAddress);
+		return EXIT_FAILURE;
+	}
+	for(c=1; c<nbCams; c++){
+		//rigid transformations are inverted directly, calibrations with scale or shear in general
+		if(invertRigidMatrix(&(inverses[c]), cams[c].base) && invertMatrix(&(inverses[c]), cams[c].base)){
+			printf("Could not invert the transformation of device %d.", c);
+			return EXIT_FAILURE;
+		}
+	}
 	//main loop
 	while(contLoop){
-		//acquire data for main Kinect & process data
-		if(updateCamera(&mainCam, &timestamp)){
-            printf("Could not update feed for device 0.");
-            return EXIT_FAILURE;
-		}
-		if(detectDrone(mainCam.data, &mainList, &vec3DDistance)){
-            printf("Could not process data for for device 0.");
-            return EXIT_FAILURE;
+		if(profileSignalled()){
+			displayProfile(stdout, &profile);
+			displayNetworkThread(stdout, &network);
+			displayDetectionPool(stdout, &pool);
 		}
-		//acquire data for secondary Kinect & process data
-		if(updateCamera(&secCam, &timestamp)){
-            printf("Could not update feed for device 1.");
-            return EXIT_FAILURE;
+		profileStart(&profile);
+		//detect in the newest data of each Kinect & fuse all lists
+		for(c=0; c<nbCams; c++){
+			trackerWindow(&tracker, kinectIntrinsics(), (c == 0)? NULL : &(inverses[c]), &(pool.window[c]));
 		}
-		if(detectDrone(secCam.data, &secList, &vec3DDistance)){
-            printf("Could not process data for for device 1.");
+		int poolStatus = runDetectionPool(&pool, &fusedList);
+		if(poolStatus == -1){
+            printf("Could not update feed of a device.");
             return EXIT_FAILURE;
 		}
-		//convert main points to secondary base
-		int i;
-		for(i=0; i<secList.n; i++){
-            transformVec4D(&(secList.vector[i]), secCam.base);
+		//wait for new data from any Kinect
+		if(poolStatus == 1){
+			usleep(1000);
+			continue;
 		}
-		//match both lists
-		fusePointList(&mainList, &secList, 200, &vec3DDistance);
-		simplifyPointList(&mainList, 200, &vec3DDistance);
-		//display list
-		system("clear");
-		puts("Press Enter to exit.\n\n---------------\nLIST:");
-		displayVecList(&mainList);
-		//send position to the given IP address
-		TVec4D* maxVect = maxPointList(&mainList);
-		if(maxVect != NULL){
-            writePacket(buf, 'k', maxVect->x, maxVect->y, maxVect->z);
-			if (sendto(s, buf, BUFLEN, 0, &si_other, slen)==-1){
-				fprintf(stderr, "sendto() failed\n");
-				return 1;
+		profileStage(&profile, detectStage);
+		for(c=0; c<nbCams; c++){
+			if(pool.floorMask & (1 << c)){
+				fprintf(stderr, "Device %d cannot detect with %d samples in %.1f ms.\n", c, BUDGETMINSAMPLES, deadline);
+				displaySampleBudget(stderr, pool.detectName[c], &(pool.budget[c]));
 			}
 		}
+		simplifyPointList(&fusedList, pool.tolerance, &vec3DDistance);
+		profileStage(&profile, simplifyStage);
+		//filter the position, the tracking window follows the accepted positions
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		float dt = (now.tv_sec - lastUpdate.tv_sec) + (now.tv_nsec - lastUpdate.tv_nsec)*1e-9;
+		lastUpdate = now;
+		if(updateKalmanTracker(&kalman, &fusedList, dt) == 0 && kalmanPosition(&kalman, 0, &position) == 0){
+			updateRegionTracker(&tracker, &position);
+		}else{
+			updateRegionTracker(&tracker, NULL);
+		}
+		profileStage(&profile, trackStage);
+		//publish the status for the display thread
+		status.list = fusedList;
+		status.tracked = (kalmanPosition(&kalman, 0, &(status.position)) == 0);
+		status.confidence = kalman.confidence;
+		status.frame++;
+		publishStatus(&display, &status);
+		profileStage(&profile, displayStage);
+		//send position to all the subscribers, position packets are also sent while the track is lost
+		int length = 0;
+		if(protocol == POSITIONPACKETVERSION){
+			fillPositionPacket(&packet, &kalman, &fusedList, pool.timestamp[0], pool.cameraMask);
+			packet.sequence = sequence++;
+			length = encodePositionPacket(buf, &packet);
+		}else if(kalmanPosition(&kalman, 0, &position) == 0){
+            writePacket(buf, LEGACYPACKETTYPE, position.x, position.y, position.z);
+			length = LEGACYPACKETSIZE;
+		}
+		if(length > 0){
+			queuePacket(&network, buf, length);
+		}
+		profileStage(&profile, sendStage);
+	}
+	stopStatusDisplay(&display);
+	if(controlAddress != NULL){
+		stopControlChannel(&control);
 	}
-	//close socket
-	close(s);
+	//stop acquisition and detection threads
+	stopDetectionPool(&pool);
+	displayProfile(stdout, &profile);
+	displayDetectionPool(stdout, &pool);
+	//stop network thread & close socket
+	stopNetworkThread(&network);
+	displayNetworkThread(stdout, &network);
+	closePublisher(&publisher);
 	//free all data
-	freeCamera(&mainCam);
-	freeCamera(&secCam);
+	for(c=0; c<nbCams; c++){
+		freeCamera(&(cams[c]));
+	}
 	//stop kinects
 	freenect_sync_stop();
 	//stop pthread
@@ -153,29 +278,6 @@ int main(int argc, char* argv[])
 	return EXIT_SUCCESS;
 }
 
-/**
- * Writes data to a packet which will then be sent via the UDP socket.
- * A 8 bit checksum is written at the end of the packet.
- *
- * @param Pointer to the packet. The packet must be at least 8 bytes long.
- * @param Type of data transmitted.
- * @param First variable to transmit.
- * @param Second variable to transmit.
- * @param Third variable to transmit.
- */
-void writePacket(char* packet, char type, short data1, short data2, short data3){
-	int i;
-	char crc8 = type;
-	packet[0] = type;
-	*((short*)&packet[1]) = data1;
-	*((short*)&packet[3]) = data2;
-	*((short*)&packet[5]) = data3;
-	for(i=1; i<7; i++){
-		crc8 += packet[i];
-	}
-	packet[7] = crc8;
-}
-
 /**
  * Function executed in a thread to asynchronously end the infinite loop.
  *
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <stdio.h>
@@ -10,13 +11,20 @@
 #include <time.h>
 #include <libfreenect_sync.h>
 #include <pthread.h>
+#include <signal.h>
 #include "kinectDetectionUtil.h"
-
-#define BUFLEN 8
-#define PORT 5005
+#include "kinectTracking.h"
+#include "kinectProfile.h"
+#include "kinectStatus.h"
+#include "kinectPublisher.h"
+#include "kinectNetwork.h"
+#include "kinectControl.h"
+#include "kinectPacket.h"
+#include "kinectBackground.h"
+#include "kinectBudget.h"
+#include "kinectCluster.h"
 
 ///prototypes
-void writePacket(char* packet, char type, short data1, short data2, short data3);
 void *readAsync(void *threadid);
 
 ///global variables
@@ -25,11 +33,54 @@ int contLoop;
 ///functions
 int main(int argc, char* argv[])
 {
-	//input parameters
-	if(argc != 2){
-		printf("usage: %s <ip>\n", argv[0]);
+	//input parameters, the subscribers are given as addresses or listed in files
+	TPublisher publisher;
+	float rate = STATUSRATE;
+	int i, protocol = 0;
+	const char* controlAddress = NULL;
+	double deadline = 0;
+	char buf[POSITIONPACKETSIZE];
+	if(openPublisher(&publisher)){
+		fprintf(stderr, "socket() failed\n");
+		return 1;
+	}
+	for(i=1; i<argc; i++){
+		if(strcmp(argv[i], "-r") == 0 && i+1 < argc){
+			rate = atof(argv[++i]);
+		}else if(strcmp(argv[i], "-p") == 0 && i+1 < argc){
+			protocol = atoi(argv[++i]);
+			if(protocol != 0 && protocol != POSITIONPACKETVERSION){
+				fprintf(stderr, "Unknown protocol version %d\n", protocol);
+				return 1;
+			}
+		}else if(strcmp(argv[i], "-b") == 0 && i+1 < argc){
+			deadline = atof(argv[++i]);
+			if(deadline <= 0){
+				fprintf(stderr, "Invalid deadline %s\n", argv[i]);
+				return 1;
+			}
+		}else if(strcmp(argv[i], "-c") == 0 && i+1 < argc){
+			controlAddress = argv[++i];
+		}else if(strcmp(argv[i], "-f") == 0 && i+1 < argc){
+			if(loadSubscribers(&publisher, argv[++i]) < 0){
+				fprintf(stderr, "Could not read the subscribers of %s\n", argv[i]);
+				return 1;
+			}
+		}else if(addSubscriber(&publisher, argv[i])){
+			fprintf(stderr, "Invalid subscriber %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if(subscriberCount(&publisher) == 0){
+		printf("usage: %s <ip[:port]>... [-f <subscriber file>] [-r <display rate, 0 for none>] [-p <protocol version, 0 for legacy>] [-c <[ip:]control port>] [-b <deadline of a depth map in ms>]\n", argv[0]);
         return EXIT_FAILURE;
 	}
+	//packets are sent by a separate thread, detection never waits for the network
+	TNetworkThread network;
+	if(startNetworkThread(&network, &publisher)){
+		fprintf(stderr, "Could not start the network thread.\n");
+		return 1;
+	}
 	//set Kinect angles to 0 & set LED colour
 	if(freenect_sync_set_tilt_degs(0, 0)){
         printf("Could not tilt device 0.\n");
@@ -39,39 +90,22 @@ int main(int argc, char* argv[])
         printf("Could not change LED of device 0.\n");
         return EXIT_FAILURE;
 	}
-	//set UDP socket
-	struct sockaddr_in si_other;
-	int s, i, slen=sizeof(si_other);
-	char buf[BUFLEN];
-	if ((s=socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP))==-1){
-		fprintf(stderr, "socket() failed\n");
-		return 1;
-	}
-	memset((char *) &si_other, 0, sizeof(si_other));
-	si_other.sin_family = AF_INET;
-	si_other.sin_port = htons(PORT);
-	if (inet_aton(argv[1], &si_other.sin_addr)==0) {
-		fprintf(stderr, "inet_aton() failed\n");
-		return 1;
-	}
 	//set cameras
 	TDepthCamera mainCam;
 	createPrimaryCamera(&mainCam, 0);
 	//get calibration values acquired by calibration program.
-	FILE* pFile = NULL;
-	pFile = fopen("calibrationValuesOne.cal", "r");
-	if(pFile == NULL){
+	if(readCalibration("calibrationValuesOne.cal", NULL, 0) < 0){
 		puts("Could not get calibration data.");
-	}else{
-		fread(&minZ, sizeof(int), 1, pFile);
-		fread(&maxZ, sizeof(int), 1, pFile);
 	}
-	fclose(pFile);
 	TVecList mainList;
 	unsigned int timestamp;
 	contLoop = 1;
 	//show current calibration values.
-	printf("Current calibration values:\nCeiling: %d, Floor: %d\n", maxZ, minZ);
+	printf("Current calibration values:\nFloor: ");
+	displayPlane(&floorPlane);
+	printf("\nCeiling: ");
+	displayPlane(&ceilingPlane);
+	printf("\n");
 	puts("\n\nAre those values correct? [Y/N]");
 	char tmpChar = getchar();
 	if(tmpChar == 'N' || tmpChar == 'n'){
@@ -89,34 +123,145 @@ int main(int argc, char* argv[])
 		exit(-1);
 	}
 	//main loop
+	//only detect what is not part of the room, learned during the first depth maps
+	//the foreground is only extracted again where the depth map changed
+	TBackground background;
+	TChangeMask change;
+	TClusterGrid grid;
+	short* foreground = malloc(DEPTHSIZE*sizeof(short));
+	if(foreground == NULL || createBackground(&background, BACKGROUNDFRAMES, BACKGROUNDUPDATE) || createChangeMask(&change, CHANGETHRESHOLD)
+		|| createClusterGrid(&grid, clusterTolerance, CLUSTERXYZ, 64)){
+		printf("Could not allocate the background model.");
+		return EXIT_FAILURE;
+	}
+	//track the drone to focus sampling around its last position
+	TRegionTracker tracker;
+	TSamplingWindow window;
+	initRegionTracker(&tracker, TRACKRATIO);
+	//adapt the number of samples to the deadline
+	TSampleBudget budget;
+	TDetectionParams params;
+	struct timespec start, middle, end;
+	window.nbSamples = 0;
+	window.base = NULL;
+	initSampleBudget(&budget, deadline, BUDGETMINSAMPLES);
+	//filter the detected position over time
+	TKalmanTracker kalman;
+	TVec4D position;
+	TPositionPacket packet;
+	uint32_t sequence = 0;
+	struct timespec now, lastUpdate;
+	initKalmanTracker(&kalman, KALMANACCELNOISE, KALMANMEASURENOISE);
+	clock_gettime(CLOCK_MONOTONIC, &lastUpdate);
+	//time each stage of the main loop, displayed on SIGUSR1 and on exit
+	TProfile profile;
+	initProfile(&profile);
+	int grabStage = addProfileStage(&profile, "grab 0");
+	int backgroundStage = addProfileStage(&profile, "background 0");
+	int detectStage = addProfileStage(&profile, "detect 0");
+	int trackStage = addProfileStage(&profile, "track");
+	int displayStage = addProfileStage(&profile, "display");
+	int sendStage = addProfileStage(&profile, "send");
+	watchProfileSignal(SIGUSR1);
+	//display the status from a separate thread
+	TStatusDisplay display;
+	TStatus status;
+	status.frame = 0;
+	if(startStatusDisplay(&display, rate)){
+		printf("Could not start the status display.");
+		return EXIT_FAILURE;
+	}
+	//clients may change the parameters of the detection while it runs
+	TControlChannel control;
+	if(controlAddress != NULL && startControlChannel(&control, controlAddress, &publisher)){
+		printf("Could not open the control channel on %s.", controlAddress);
+		return EXIT_FAILURE;
+	}
 	while(contLoop){
+		if(profileSignalled()){
+			displayProfile(stdout, &profile);
+			displayNetworkThread(stdout, &network);
+			if(deadline > 0){ displaySampleBudget(stdout, "detect 0", &budget); }
+		}
+		profileStart(&profile);
 		//acquire data for main Kinect & process data
 		if(updateCamera(&mainCam, &timestamp)){
             printf("Could not update feed for device 0.");
             return EXIT_FAILURE;
 		}
-		if(detectDrone(mainCam.data, &mainList, &vec3DDistance)){
+		profileStage(&profile, grabStage);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		updateChangeMask(&change, mainCam.data);
+		subtractBackground(&background, mainCam.data, foreground, &change);
+		profileStage(&profile, backgroundStage);
+		trackerWindow(&tracker, kinectIntrinsics(), NULL, &window);
+		if(deadline > 0){
+			getDetectionParams(&params);
+			window.nbSamples = budgetSamples(&budget, params.nbIterations);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &middle);
+		if(detectDroneWindow(foreground, &mainList, &vec3DDistance, &window, NULL, &grid)){
             printf("Could not process data for for device 0.");
             return EXIT_FAILURE;
 		}
-		//display list
-		system("clear");
-		puts("Press Enter to exit.\n\n---------------\nLIST:");
-		displayVecList(&mainList);
-		//send position to the given IP address
-		TVec4D* maxVect = maxPointList(&mainList);
-		if(maxVect != NULL){
-            writePacket(buf, 'k', maxVect->x, maxVect->y, maxVect->z);
-			if (sendto(s, buf, BUFLEN, 0, &si_other, slen)==-1){
-				fprintf(stderr, "sendto() failed\n");
-				return 1;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		profileStage(&profile, detectStage);
+		if(deadline > 0){
+			long fixedTime = (middle.tv_sec - start.tv_sec)*1000000000L + (middle.tv_nsec - start.tv_nsec);
+			long sampleTime = (end.tv_sec - middle.tv_sec)*1000000000L + (end.tv_nsec - middle.tv_nsec);
+			if(updateSampleBudget(&budget, fixedTime, sampleTime, window.nbSamples)){
+				fprintf(stderr, "Device 0 cannot detect with %d samples in %.1f ms.\n", BUDGETMINSAMPLES, deadline);
+				displaySampleBudget(stderr, "detect 0", &budget);
 			}
 		}
+		//filter the position, the tracking window follows the accepted positions
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		float dt = (now.tv_sec - lastUpdate.tv_sec) + (now.tv_nsec - lastUpdate.tv_nsec)*1e-9;
+		lastUpdate = now;
+		if(updateKalmanTracker(&kalman, &mainList, dt) == 0 && kalmanPosition(&kalman, 0, &position) == 0){
+			updateRegionTracker(&tracker, &position);
+		}else{
+			updateRegionTracker(&tracker, NULL);
+		}
+		profileStage(&profile, trackStage);
+		//publish the status for the display thread
+		status.list = mainList;
+		status.tracked = (kalmanPosition(&kalman, 0, &(status.position)) == 0);
+		status.confidence = kalman.confidence;
+		status.frame++;
+		publishStatus(&display, &status);
+		profileStage(&profile, displayStage);
+		//send position to all the subscribers, position packets are also sent while the track is lost
+		int length = 0;
+		if(protocol == POSITIONPACKETVERSION){
+			fillPositionPacket(&packet, &kalman, &mainList, timestamp, (mainList.n > 0));
+			packet.sequence = sequence++;
+			length = encodePositionPacket(buf, &packet);
+		}else if(kalmanPosition(&kalman, 0, &position) == 0){
+            writePacket(buf, LEGACYPACKETTYPE, position.x, position.y, position.z);
+			length = LEGACYPACKETSIZE;
+		}
+		if(length > 0){
+			queuePacket(&network, buf, length);
+		}
+		profileStage(&profile, sendStage);
+	}
+	stopStatusDisplay(&display);
+	if(controlAddress != NULL){
+		stopControlChannel(&control);
 	}
-	//close socket
-	close(s);
+	displayProfile(stdout, &profile);
+	if(deadline > 0){ displaySampleBudget(stdout, "detect 0", &budget); }
+	//stop network thread & close socket
+	stopNetworkThread(&network);
+	displayNetworkThread(stdout, &network);
+	closePublisher(&publisher);
 	//free all data
 	freeCamera(&mainCam);
+	freeBackground(&background);
+	freeChangeMask(&change);
+	freeClusterGrid(&grid);
+	free(foreground);
 	//stop kinects
 	freenect_sync_stop();
 	//stop pthread
@@ -124,29 +269,6 @@ int main(int argc, char* argv[])
 	return EXIT_SUCCESS;
 }
 
-/**
- * Writes data to a packet which will then be sent via the UDP socket.
- * A 8 bit checksum is written at the end of the packet.
- *
- * @param Pointer to the packet. The packet must be at least 8 bytes long.
- * @param Type of data transmitted.
- * @param First variable to transmit.
- * @param Second variable to transmit.
- * @param Third variable to transmit.
- */
-void writePacket(char* packet, char type, short data1, short data2, short data3){
-	int i;
-	char crc8 = type;
-	packet[0] = type;
-	*((short*)&packet[1]) = data1;
-	*((short*)&packet[3]) = data2;
-	*((short*)&packet[5]) = data3;
-	for(i=1; i<7; i++){
-		crc8 += packet[i];
-	}
-	packet[7] = crc8;
-}
-
 /**
  * Function executed in a thread to asynchronously end the infinite loop.
  *
@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <string.h>
+#include "kinectBackground.h"
+
+/**
+ * Keeps the foreground pixels of a run of consecutive pixels, the others are set to 0.
+ * Returns the number of foreground pixels.
+ *
+ * @param Pointer to the background depth of the first pixel
+ * @param Pointer to the depth of the first pixel
+ * @param Pointer to the foreground depth of the first pixel
+ * @param Number of pixels
+ */
+static int extractForeground(const short* depth, const short* data, short* foreground, int length){
+	int i, n = 0;
+	for(i=0; i<length; i++){
+		int d = data[i], b = depth[i];
+		//closer than the background by more than the tolerance
+		int tolerance = (d*31 >> 10) > BACKGROUNDTOLERANCE? d*31 >> 10 : BACKGROUNDTOLERANCE;
+		int isForeground = (d > 0) & ((b == 0) | (d < b - tolerance));
+		foreground[i] = isForeground? d : 0;
+		n += isForeground;
+	}
+	return n;
+}
+
+/**
+ * Allocates a background model.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the background model
+ * @param Number of depth maps used to learn the background
+ * @param Number of depth maps between two updates of the background
+ */
+int createBackground(TBackground* background, int learnFrames, int updateInterval){
+	background->depth = malloc(DEPTHSIZE*sizeof(short));
+	background->persistence = malloc(DEPTHSIZE);
+	if(background->depth == NULL || background->persistence == NULL){
+		free(background->depth);
+		free(background->persistence);
+		return 1;
+	}
+	background->learnFrames = learnFrames;
+	background->updateInterval = (updateInterval > 0)? updateInterval : 1;
+	resetBackground(background);
+	return 0;
+}
+
+/**
+ * Forgets the background, it is learned again from the next depth maps.
+ *
+ * @param Pointer to the background model
+ */
+void resetBackground(TBackground* background){
+	int i;
+	memset(background->depth, 0, DEPTHSIZE*sizeof(short));
+	memset(background->persistence, 0, DEPTHSIZE);
+	background->nbFrames = 0;
+	background->nbForeground = DEPTHSIZE;
+	for(i=0; i<NBTILES; i++){
+		background->tileForeground[i] = TILESIZE*TILESIZE;
+	}
+}
+
+/**
+ * Frees a background model.
+ *
+ * @param Pointer to the background model
+ */
+void freeBackground(TBackground* background){
+	free(background->depth);
+	free(background->persistence);
+	background->depth = NULL;
+	background->persistence = NULL;
+}
+
+/**
+ * Updates the background model with a depth map and keeps only its foreground pixels, the others are set to 0.
+ * While the background is learned, the depth map is copied unchanged.
+ * With a change mask, the foreground of the unchanged tiles is kept from the previous call,
+ * except every updateInterval depth maps when the whole background is updated.
+ * Returns 0 if the foreground was extracted and 1 if the background is still learned.
+ *
+ * @param Pointer to the background model
+ * @param Pointer to the depth map
+ * @param Pointer to the foreground depth map, the same for every call
+ * @param Pointer to the change mask of the depth map, NULL to process every tile
+ */
+int subtractBackground(TBackground* background, const short* data, short* foreground, const TChangeMask* mask){
+	short* depth = background->depth;
+	int i, n;
+	if(background->nbFrames < background->learnFrames){
+		//keep the farthest valid depth of each pixel
+		for(i=0; i<DEPTHSIZE; i++){
+			depth[i] = (data[i] > depth[i])? data[i] : depth[i];
+		}
+		memcpy(foreground, data, DEPTHSIZE*sizeof(short));
+		background->nbFrames++;
+		background->nbForeground = DEPTHSIZE;
+		return 1;
+	}
+	//every tile is processed when the background is updated, only the dirty ones otherwise
+	int update = (background->nbFrames - background->learnFrames)%background->updateInterval == 0;
+	int tx, ty, y;
+	n = background->nbForeground;
+	for(ty=0; ty<TILESY; ty++){
+		for(tx=0; tx<TILESX; tx++){
+			if(mask != NULL && !update && !tileChanged(mask, tx, ty)){ continue; }
+			int tile = tx + ty*TILESX, m = 0;
+			for(y=0; y<TILESIZE; y++){
+				i = (ty*TILESIZE + y)*DEPTHWIDTH + tx*TILESIZE;
+				m += extractForeground(depth + i, data + i, foreground + i, TILESIZE);
+			}
+			n += m - background->tileForeground[tile];
+			background->tileForeground[tile] = m;
+		}
+	}
+	//move the background towards the median, pixels in the foreground for too long take their depth as background
+	if(update){
+		unsigned char* persistence = background->persistence;
+		for(i=0; i<DEPTHSIZE; i++){
+			int d = data[i], b = depth[i];
+			if(d > 0 && foreground[i] == 0){
+				depth[i] = b + (d > b) - (d < b);
+				persistence[i] = 0;
+			}else if(d > 0 && ++(persistence[i]) >= BACKGROUNDPERSISTENCE){
+				depth[i] = d;
+				persistence[i] = 0;
+				foreground[i] = 0;
+				background->tileForeground[(i/DEPTHWIDTH/TILESIZE)*TILESX + (i%DEPTHWIDTH)/TILESIZE]--;
+				n--;
+			}
+		}
+	}
+	background->nbFrames++;
+	background->nbForeground = n;
+	return 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "kinectDetectionUtil.h"
+#include "kinectChange.h"
+
+#define BACKGROUNDFRAMES 30
+#define BACKGROUNDUPDATE 8
+#define BACKGROUNDTOLERANCE 80
+#define BACKGROUNDPERSISTENCE 225
+
+/// Structure containing the background depth of each pixel of a camera, 0 if unknown.
+/// The background is the farthest depth seen during the first learnFrames depth maps.
+/// Then it follows the median depth of each pixel by 1 mm every updateInterval depth maps.
+/// A pixel which stays in the foreground during BACKGROUNDPERSISTENCE updates takes its current depth as background,
+/// so objects which stop moving become part of the background (after 60 s at 30 depth maps/s with the defaults).
+/// A pixel is in the foreground if it is closer than its background by more than
+/// BACKGROUNDTOLERANCE or 3% of its depth, or if its background is unknown.
+/// The number of foreground pixels of each tile is kept so that unchanged tiles can be skipped.
+typedef struct{
+	short* depth;
+	unsigned char* persistence;
+	int nbFrames;
+	int learnFrames;
+	int updateInterval;
+	int nbForeground;
+	int tileForeground[NBTILES];
+}TBackground;
+
+
+/**
+ * Allocates a background model.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the background model
+ * @param Number of depth maps used to learn the background
+ * @param Number of depth maps between two updates of the background
+ */
+int createBackground(TBackground* background, int learnFrames, int updateInterval);
+
+/**
+ * Forgets the background, it is learned again from the next depth maps.
+ *
+ * @param Pointer to the background model
+ */
+void resetBackground(TBackground* background);
+
+/**
+ * Frees a background model.
+ *
+ * @param Pointer to the background model
+ */
+void freeBackground(TBackground* background);
+
+/**
+ * Updates the background model with a depth map and keeps only its foreground pixels, the others are set to 0.
+ * While the background is learned, the depth map is copied unchanged.
+ * With a change mask, the foreground of the unchanged tiles is kept from the previous call,
+ * except every updateInterval depth maps when the whole background is updated.
+ * Returns 0 if the foreground was extracted and 1 if the background is still learned.
+ *
+ * @param Pointer to the background model
+ * @param Pointer to the depth map
+ * @param Pointer to the foreground depth map, the same for every call
+ * @param Pointer to the change mask of the depth map, NULL to process every tile
+ */
+int subtractBackground(TBackground* background, const short* data, short* foreground, const TChangeMask* mask);
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include "kinectBudget.h"
+
+/**
+ * Initializes the budget of a camera, the first depth map uses the minimum number of samples.
+ *
+ * @param Pointer to the budget
+ * @param Deadline of the processing of a depth map in milliseconds
+ * @param Minimum number of samples of a depth map
+ */
+void initSampleBudget(TSampleBudget* budget, double deadline, int minSamples){
+	budget->deadline = deadline*1e6;
+	budget->fixedCost = 0;
+	budget->sampleCost = 0;
+	budget->minSamples = (minSamples > 0)? minSamples : 1;
+	budget->samples = budget->minSamples;
+	budget->floor = 0;
+	budget->nbFrames = 0;
+	budget->nbMissed = 0;
+	budget->nbFloor = 0;
+}
+
+/**
+ * Returns the number of samples of the next depth map.
+ *
+ * @param Pointer to the budget
+ * @param Maximum number of samples, the number of iterations of the detection parameters
+ */
+int budgetSamples(TSampleBudget* budget, int maxSamples){
+	double n = budget->samples;
+	//nothing measured yet, start low
+	if(budget->sampleCost > 0){
+		n = (BUDGETMARGIN*budget->deadline - budget->fixedCost)/budget->sampleCost;
+		if(n > budget->samples*BUDGETGROWTH){
+			n = budget->samples*BUDGETGROWTH;
+		}
+	}
+	if(n < budget->minSamples){ n = budget->minSamples; }
+	if(n > maxSamples){ n = maxSamples; }
+	budget->samples = (n >= 1)? n : 1;
+	return budget->samples;
+}
+
+/**
+ * Adds the measured times of a depth map to the model of a budget.
+ * Returns 1 if the minimum number of samples stopped fitting in the deadline with this depth map, 0 otherwise.
+ *
+ * @param Pointer to the budget
+ * @param Time spent outside the sampling, in nanoseconds
+ * @param Time spent in the sampling, in nanoseconds
+ * @param Number of samples of the depth map
+ */
+int updateSampleBudget(TSampleBudget* budget, long fixedTime, long sampleTime, int samples){
+	int wasFloor = budget->floor;
+	budget->nbFrames++;
+	if(fixedTime + sampleTime > budget->deadline){
+		budget->nbMissed++;
+	}
+	//the cost per sample includes the part of the sampling which does not depend on the number of samples,
+	//so the model is exact at the current number of samples and pessimistic below it
+	if(samples > 0){
+		double cost = (double)sampleTime/samples;
+		budget->sampleCost = (budget->nbFrames == 1)? cost : budget->sampleCost + BUDGETSMOOTHING*(cost - budget->sampleCost);
+	}
+	budget->fixedCost = (budget->nbFrames == 1)? fixedTime : budget->fixedCost + BUDGETSMOOTHING*(fixedTime - budget->fixedCost);
+	budget->floor = (budget->fixedCost + budget->minSamples*budget->sampleCost > BUDGETMARGIN*budget->deadline);
+	if(budget->floor){
+		budget->nbFloor++;
+	}
+	return budget->floor && !wasFloor;
+}
+
+/**
+ * Displays the current number of samples, the model and the missed deadlines of a budget.
+ *
+ * @param Pointer to the output file
+ * @param Name of the budget
+ * @param Pointer to the budget
+ */
+void displaySampleBudget(FILE* pFile, const char* name, const TSampleBudget* budget){
+	fprintf(pFile, "%-16s %6d samples, %7.1f ns/sample, fixed %7.3f ms, deadline %6.2f ms, %ld/%ld missed, %ld without room for %d samples\n",
+		name, budget->samples, budget->sampleCost, budget->fixedCost/1e6, budget->deadline/1e6,
+		budget->nbMissed, budget->nbFrames, budget->nbFloor, budget->minSamples);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdio.h>
+
+#define BUDGETPERIOD 33.0
+#define BUDGETMINSAMPLES 500
+#define BUDGETMARGIN 0.9
+#define BUDGETSMOOTHING 0.2
+#define BUDGETGROWTH 1.25
+
+/// Structure adapting the number of samples of the detection of one camera to a deadline per depth map.
+/// The time of a depth map is modelled as a fixed time (background subtraction, change of base) plus a cost
+/// per sample, both measured and smoothed over the previous depth maps. The next number of samples fills
+/// BUDGETMARGIN of the deadline, between the minimum number of samples and the number of iterations of the
+/// parameters, and grows by at most BUDGETGROWTH per depth map so that one fast depth map does not cause a miss.
+/// When even the minimum number of samples does not fit in the deadline, the budget is in the floor state
+/// and the minimum is used anyway. Times are in nanoseconds.
+typedef struct{
+	double deadline;
+	double fixedCost;
+	double sampleCost;
+	int samples;
+	int minSamples;
+	int floor;
+	long nbFrames;
+	long nbMissed;
+	long nbFloor;
+}TSampleBudget;
+
+
+/**
+ * Initializes the budget of a camera, the first depth map uses the minimum number of samples.
+ *
+ * @param Pointer to the budget
+ * @param Deadline of the processing of a depth map in milliseconds
+ * @param Minimum number of samples of a depth map
+ */
+void initSampleBudget(TSampleBudget* budget, double deadline, int minSamples);
+
+/**
+ * Returns the number of samples of the next depth map.
+ *
+ * @param Pointer to the budget
+ * @param Maximum number of samples, the number of iterations of the detection parameters
+ */
+int budgetSamples(TSampleBudget* budget, int maxSamples);
+
+/**
+ * Adds the measured times of a depth map to the model of a budget.
+ * Returns 1 if the minimum number of samples stopped fitting in the deadline with this depth map, 0 otherwise.
+ *
+ * @param Pointer to the budget
+ * @param Time spent outside the sampling, in nanoseconds
+ * @param Time spent in the sampling, in nanoseconds
+ * @param Number of samples of the depth map
+ */
+int updateSampleBudget(TSampleBudget* budget, long fixedTime, long sampleTime, int samples);
+
+/**
+ * Displays the current number of samples, the model and the missed deadlines of a budget.
+ *
+ * @param Pointer to the output file
+ * @param Name of the budget
+ * @param Pointer to the budget
+ */
+void displaySampleBudget(FILE* pFile, const char* name, const TSampleBudget* budget);
@@ -0,0 +1,249 @@
+#include <stdlib.h>
+#include <math.h>
+#include "kinectCalibration.h"
+
+/**
+ * Allocates a list of correspondences.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the correspondences
+ * @param Maximum number of correspondences
+ */
+int createCorrespondences(TCorrespondences* corr, int capacity){
+	corr->points = calloc(capacity, sizeof(TVec4D));
+	corr->reference = calloc(capacity, sizeof(TVec4D));
+	corr->n = 0;
+	corr->capacity = capacity;
+	if(corr->points == NULL || corr->reference == NULL){
+		freeCorrespondences(corr);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Frees a list of correspondences.
+ *
+ * @param Pointer to the correspondences
+ */
+void freeCorrespondences(TCorrespondences* corr){
+	free(corr->points);
+	free(corr->reference);
+	corr->points = corr->reference = NULL;
+	corr->n = corr->capacity = 0;
+}
+
+/**
+ * Adds a correspondence to a list.
+ * Returns 0 if the operation is a success and 1 if the list is full.
+ *
+ * @param Pointer to the correspondences
+ * @param Pointer to the position seen by the camera
+ * @param Pointer to the position seen by the reference camera
+ */
+int addCorrespondence(TCorrespondences* corr, const TVec4D* point, const TVec4D* reference){
+	if(corr->n >= corr->capacity){ return 1; }
+	corr->points[corr->n] = *point;
+	corr->reference[corr->n] = *reference;
+	corr->n++;
+	return 0;
+}
+
+/**
+ * Computes the singular value decomposition A = U S V^T of a 3x3 matrix with one-sided Jacobi rotations.
+ * The singular values are not sorted. If one of them is 0, its column of U completes the others.
+ *
+ * @param Matrix A, row by row, replaced by U
+ * @param Pointer to the 3 singular values
+ * @param Matrix V, row by row
+ */
+static void svd3(double a[3][3], double s[3], double v[3][3]){
+	int i, j, k, sweep, m = 0;
+	for(i=0; i<3; i++){
+		for(j=0; j<3; j++){ v[i][j] = (i == j); }
+	}
+	//rotate pairs of columns until they are orthogonal
+	for(sweep=0; sweep<30; sweep++){
+		int rotated = 0;
+		for(i=0; i<2; i++){
+			for(j=i+1; j<3; j++){
+				double alpha = 0, beta = 0, gamma = 0;
+				for(k=0; k<3; k++){
+					alpha += a[k][i]*a[k][i];
+					beta += a[k][j]*a[k][j];
+					gamma += a[k][i]*a[k][j];
+				}
+				if(fabs(gamma) <= 1e-15*sqrt(alpha*beta)){ continue; }
+				rotated = 1;
+				double zeta = (beta - alpha)/(2*gamma);
+				double t = ((zeta >= 0)? 1 : -1)/(fabs(zeta) + sqrt(1 + zeta*zeta));
+				double c = 1/sqrt(1 + t*t), sn = c*t;
+				for(k=0; k<3; k++){
+					double ai = a[k][i], aj = a[k][j];
+					a[k][i] = c*ai - sn*aj;
+					a[k][j] = sn*ai + c*aj;
+					double vi = v[k][i], vj = v[k][j];
+					v[k][i] = c*vi - sn*vj;
+					v[k][j] = sn*vi + c*vj;
+				}
+			}
+		}
+		if(!rotated){ break; }
+	}
+	//singular values are the norms of the columns, U the normalized columns
+	for(j=0; j<3; j++){
+		s[j] = sqrt(a[0][j]*a[0][j] + a[1][j]*a[1][j] + a[2][j]*a[2][j]);
+		if(s[j] < s[m]){ m = j; }
+	}
+	for(j=0; j<3; j++){
+		for(k=0; j != m && k<3; k++){ a[k][j] /= s[j]; }
+	}
+	//the smallest column is rebuilt from the two others, it may be degenerate
+	i = (m+1)%3;
+	j = (m+2)%3;
+	a[0][m] = a[1][i]*a[2][j] - a[2][i]*a[1][j];
+	a[1][m] = a[2][i]*a[0][j] - a[0][i]*a[2][j];
+	a[2][m] = a[0][i]*a[1][j] - a[1][i]*a[0][j];
+}
+
+/**
+ * Finds the rigid transformation moving points onto their references with the least squared error (Kabsch).
+ * The rotation comes from the SVD of the cross-covariance of the centred points.
+ * Returns 0 if the operation is a success and 1 if there are less than 3 points or if they are aligned.
+ *
+ * @param Pointer to the points
+ * @param Pointer to the reference points
+ * @param Number of points
+ * @param Pointer to the transformation
+ */
+int fitRigidTransform(const TVec4D* points, const TVec4D* reference, int n, TMatrix4D* transform){
+	double p[3] = {0, 0, 0}, q[3] = {0, 0, 0}, h[3][3] = {{0}}, s[3], v[3][3];
+	int i, j, k, m = 0;
+	if(n < 3){ return 1; }
+	//centroids
+	for(i=0; i<n; i++){
+		p[0] += points[i].x; p[1] += points[i].y; p[2] += points[i].z;
+		q[0] += reference[i].x; q[1] += reference[i].y; q[2] += reference[i].z;
+	}
+	for(k=0; k<3; k++){
+		p[k] /= n;
+		q[k] /= n;
+	}
+	//cross-covariance H = sum (p - pc)(q - qc)^T
+	for(i=0; i<n; i++){
+		double dp[3] = {points[i].x - p[0], points[i].y - p[1], points[i].z - p[2]};
+		double dq[3] = {reference[i].x - q[0], reference[i].y - q[1], reference[i].z - q[2]};
+		for(j=0; j<3; j++){
+			for(k=0; k<3; k++){ h[j][k] += dp[j]*dq[k]; }
+		}
+	}
+	//H = U S V^T, R = V D U^T where D flips the smallest axis if needed to avoid a reflection
+	svd3(h, s, v);
+	for(k=1; k<3; k++){
+		if(s[k] < s[m]){ m = k; }
+	}
+	//aligned points leave a single non zero singular value
+	if(fmin(s[(m+1)%3], s[(m+2)%3]) <= 1e-9*fmax(s[(m+1)%3], s[(m+2)%3])){ return 1; }
+	double r[3][3], det;
+	for(i=0; i<3; i++){
+		for(j=0; j<3; j++){
+			r[i][j] = v[i][0]*h[j][0] + v[i][1]*h[j][1] + v[i][2]*h[j][2];
+		}
+	}
+	det = r[0][0]*(r[1][1]*r[2][2] - r[1][2]*r[2][1]) - r[0][1]*(r[1][0]*r[2][2] - r[1][2]*r[2][0]) + r[0][2]*(r[1][0]*r[2][1] - r[1][1]*r[2][0]);
+	if(det < 0){
+		for(i=0; i<3; i++){
+			for(j=0; j<3; j++){ r[i][j] -= 2*v[i][m]*h[j][m]; }
+		}
+	}
+	//translation moves the centroid of the points onto the centroid of the references
+	for(i=0; i<3; i++){
+		for(j=0; j<3; j++){ transform->m[4*i+j] = r[i][j]; }
+		transform->m[4*i+3] = q[i] - (r[i][0]*p[0] + r[i][1]*p[1] + r[i][2]*p[2]);
+	}
+	transform->m[12] = transform->m[13] = transform->m[14] = 0;
+	transform->m[15] = 1;
+	return 0;
+}
+
+/**
+ * Returns the distance between a transformed point and its reference.
+ *
+ * @param Pointer to the transformation
+ * @param Pointer to the point
+ * @param Pointer to the reference point
+ */
+static float transformedDistance(const TMatrix4D* transform, const TVec4D* point, const TVec4D* reference){
+	const float* m = transform->m;
+	float dx = m[0]*point->x + m[1]*point->y + m[2]*point->z + m[3] - reference->x;
+	float dy = m[4]*point->x + m[5]*point->y + m[6]*point->z + m[7] - reference->y;
+	float dz = m[8]*point->x + m[9]*point->y + m[10]*point->z + m[11] - reference->z;
+	return sqrtf(dx*dx + dy*dy + dz*dz);
+}
+
+/**
+ * Finds the rigid transformation from a camera to the reference camera, ignoring outliers with RANSAC.
+ * Transformations fitted on 3 random correspondences are scored by their number of inliers,
+ * closer than a threshold to their reference, then the best one is fitted again on all its inliers.
+ * Returns 0 if the operation is a success and 1 if less than CALIBRATIONMINPOINTS inliers were found.
+ *
+ * @param Pointer to the correspondences
+ * @param Largest distance of an inlier to its reference, in mm
+ * @param Number of random transformations
+ * @param Pointer to the pseudo-random number generator
+ * @param Pointer to the transformation
+ * @param Pointer to the quality of the calibration
+ */
+int calibrateRigid(const TCorrespondences* corr, float threshold, int iterations, TRandom* random, TMatrix4D* transform, TCalibrationError* error){
+	TVec4D points[3], reference[3];
+	TMatrix4D candidate;
+	int i, j, it, best = 0;
+	error->nbPoints = corr->n;
+	error->nbInliers = 0;
+	error->rmsError = error->maxError = 0;
+	if(corr->n < CALIBRATIONMINPOINTS){ return 1; }
+	for(it=0; it<iterations; it++){
+		for(j=0; j<3; j++){
+			i = randomRange(random, corr->n);
+			points[j] = corr->points[i];
+			reference[j] = corr->reference[i];
+		}
+		//points too close to each other give no rotation
+		if(vec3DDistance(&(reference[0]), &(reference[1])) < threshold || vec3DDistance(&(reference[0]), &(reference[2])) < threshold || vec3DDistance(&(reference[1]), &(reference[2])) < threshold){
+			continue;
+		}
+		if(fitRigidTransform(points, reference, 3, &candidate)){ continue; }
+		int nbInliers = 0;
+		for(i=0; i<corr->n; i++){
+			nbInliers += transformedDistance(&candidate, &(corr->points[i]), &(corr->reference[i])) < threshold;
+		}
+		if(nbInliers > best){
+			best = nbInliers;
+			*transform = candidate;
+		}
+	}
+	if(best < CALIBRATIONMINPOINTS){ return 1; }
+	//fit again on all the inliers
+	TCorrespondences inliers;
+	if(createCorrespondences(&inliers, best)){ return 1; }
+	for(i=0; i<corr->n; i++){
+		if(transformedDistance(transform, &(corr->points[i]), &(corr->reference[i])) < threshold){
+			addCorrespondence(&inliers, &(corr->points[i]), &(corr->reference[i]));
+		}
+	}
+	if(fitRigidTransform(inliers.points, inliers.reference, inliers.n, transform)){
+		freeCorrespondences(&inliers);
+		return 1;
+	}
+	//residuals of the inliers
+	double sum = 0;
+	for(i=0; i<inliers.n; i++){
+		float d = transformedDistance(transform, &(inliers.points[i]), &(inliers.reference[i]));
+		sum += d*d;
+		error->maxError = fmaxf(error->maxError, d);
+	}
+	error->nbInliers = inliers.n;
+	error->rmsError = sqrt(sum/inliers.n);
+	freeCorrespondences(&inliers);
+	return 0;
+}
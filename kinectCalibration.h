@@ -0,0 +1,79 @@
+#pragma once
+
+#include "kinectDetectionUtil.h"
+
+#define CALIBRATIONTHRESHOLD 100
+#define CALIBRATIONITERATIONS 500
+#define CALIBRATIONMINPOINTS 10
+#define CALIBRATIONFRAMES 300
+
+/// Structure containing pairs of positions of the same target seen by a camera and by the reference camera.
+typedef struct{
+	TVec4D* points;
+	TVec4D* reference;
+	int n;
+	int capacity;
+}TCorrespondences;
+
+/// Structure containing the quality of a calibration.
+/// The residuals are the distances in mm between the transformed positions and the reference positions of the inliers.
+typedef struct{
+	int nbInliers;
+	int nbPoints;
+	float rmsError;
+	float maxError;
+}TCalibrationError;
+
+
+/**
+ * Allocates a list of correspondences.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the correspondences
+ * @param Maximum number of correspondences
+ */
+int createCorrespondences(TCorrespondences* corr, int capacity);
+
+/**
+ * Frees a list of correspondences.
+ *
+ * @param Pointer to the correspondences
+ */
+void freeCorrespondences(TCorrespondences* corr);
+
+/**
+ * Adds a correspondence to a list.
+ * Returns 0 if the operation is a success and 1 if the list is full.
+ *
+ * @param Pointer to the correspondences
+ * @param Pointer to the position seen by the camera
+ * @param Pointer to the position seen by the reference camera
+ */
+int addCorrespondence(TCorrespondences* corr, const TVec4D* point, const TVec4D* reference);
+
+/**
+ * Finds the rigid transformation moving points onto their references with the least squared error (Kabsch).
+ * The rotation comes from the SVD of the cross-covariance of the centred points.
+ * Returns 0 if the operation is a success and 1 if there are less than 3 points or if they are aligned.
+ *
+ * @param Pointer to the points
+ * @param Pointer to the reference points
+ * @param Number of points
+ * @param Pointer to the transformation
+ */
+int fitRigidTransform(const TVec4D* points, const TVec4D* reference, int n, TMatrix4D* transform);
+
+/**
+ * Finds the rigid transformation from a camera to the reference camera, ignoring outliers with RANSAC.
+ * Transformations fitted on 3 random correspondences are scored by their number of inliers,
+ * closer than a threshold to their reference, then the best one is fitted again on all its inliers.
+ * Returns 0 if the operation is a success and 1 if less than CALIBRATIONMINPOINTS inliers were found.
+ *
+ * @param Pointer to the correspondences
+ * @param Largest distance of an inlier to its reference, in mm
+ * @param Number of random transformations
+ * @param Pointer to the pseudo-random number generator
+ * @param Pointer to the transformation
+ * @param Pointer to the quality of the calibration
+ */
+int calibrateRigid(const TCorrespondences* corr, float threshold, int iterations, TRandom* random, TMatrix4D* transform, TCalibrationError* error);
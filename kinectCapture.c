@@ -0,0 +1,94 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "kinectCapture.h"
+
+/**
+ * Function executed in a thread to acquire depth maps until the capture is stopped.
+ *
+ * @param Pointer to the capture thread
+ */
+static void *captureLoop(void *pArg){
+	TCaptureThread* pCapture = pArg;
+	TTripleBuffer* pBuffer = pCapture->buffer;
+	TBufferExchange* exchange = &(pBuffer->exchange);
+	unsigned int timestamp;
+	struct timespec start, end;
+	while(atomic_load(&(pCapture->running))){
+		//acquire data
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if(updateCamera(pCapture->camera, &timestamp)){
+			atomic_store(&(pCapture->error), 1);
+			break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		recordLatency(&(pCapture->grabTime), (end.tv_sec - start.tv_sec)*1000000000L + (end.tv_nsec - start.tv_nsec));
+		//copy data to the back buffer
+		memcpy(pBuffer->data[exchange->back], pCapture->camera->data, sizeof(pBuffer->data[0]));
+		pBuffer->timestamp[exchange->back] = timestamp;
+		//publish back buffer as the newest one
+		publishBuffer(exchange);
+	}
+	pthread_exit(NULL);
+}
+
+/**
+ * Starts a thread continuously acquiring the depth map of a camera.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the capture thread
+ * @param Pointer to the camera
+ */
+int startCapture(TCaptureThread* pCapture, TDepthCamera* pCamera){
+	//Allocation of space for the buffers
+	pCapture->buffer = malloc(sizeof(TTripleBuffer));
+	if(pCapture->buffer == NULL){ return 1; }
+	initBufferExchange(&(pCapture->buffer->exchange));
+	//start thread
+	pCapture->camera = pCamera;
+	atomic_init(&(pCapture->running), 1);
+	atomic_init(&(pCapture->error), 0);
+	snprintf(pCapture->grabName, sizeof(pCapture->grabName), "grab %d", pCamera->id);
+	initHistogram(&(pCapture->grabTime), pCapture->grabName);
+	if(pthread_create(&(pCapture->thread), NULL, captureLoop, pCapture)){
+		free(pCapture->buffer);
+		pCapture->buffer = NULL;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Gets the newest depth map acquired by a capture thread.
+ * The depth map stays valid until the next call for the same capture thread.
+ * Returns 0 if a new depth map was acquired, 1 if no new depth map is available yet and -1 if the capture failed.
+ *
+ * @param Pointer to the capture thread
+ * @param Pointer to the depth map
+ * @param Pointer to the time stamp
+ */
+int acquireFrame(TCaptureThread* pCapture, short** data, unsigned int* timestamp){
+	TTripleBuffer* pBuffer = pCapture->buffer;
+	//nothing new since last call
+	if(takeBuffer(&(pBuffer->exchange))){
+		return atomic_load(&(pCapture->error))? -1 : 1;
+	}
+	*data = pBuffer->data[pBuffer->exchange.front];
+	if(timestamp != NULL){
+		*timestamp = pBuffer->timestamp[pBuffer->exchange.front];
+	}
+	return 0;
+}
+
+/**
+ * Stops a capture thread and frees its buffers.
+ *
+ * @param Pointer to the capture thread
+ */
+void stopCapture(TCaptureThread* pCapture){
+	if(pCapture->buffer == NULL){ return; }
+	atomic_store(&(pCapture->running), 0);
+	pthread_join(pCapture->thread, NULL);
+	free(pCapture->buffer);
+	pCapture->buffer = NULL;
+}
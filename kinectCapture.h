@@ -0,0 +1,55 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "kinectDetectionUtil.h"
+#include "kinectProfile.h"
+#include "kinectExchange.h"
+
+/// Structure exchanging depth maps between a capture thread and the processing loop (see kinectExchange.h).
+typedef struct{
+	short data[3][DEPTHSIZE];
+	unsigned int timestamp[3];
+	TBufferExchange exchange;
+}TTripleBuffer;
+
+/// Structure representing the acquisition thread of a camera.
+/// The error is set when the camera cannot be updated, the thread then stops.
+/// The grab histogram contains the time taken by each update of the camera.
+typedef struct{
+	TDepthCamera* camera;
+	TTripleBuffer* buffer;
+	atomic_int running;
+	atomic_int error;
+	pthread_t thread;
+	THistogram grabTime;
+	char grabName[16];
+}TCaptureThread;
+
+
+/**
+ * Starts a thread continuously acquiring the depth map of a camera.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the capture thread
+ * @param Pointer to the camera
+ */
+int startCapture(TCaptureThread* pCapture, TDepthCamera* pCamera);
+
+/**
+ * Gets the newest depth map acquired by a capture thread.
+ * The depth map stays valid until the next call for the same capture thread.
+ * Returns 0 if a new depth map was acquired, 1 if no new depth map is available yet and -1 if the capture failed.
+ *
+ * @param Pointer to the capture thread
+ * @param Pointer to the depth map
+ * @param Pointer to the time stamp
+ */
+int acquireFrame(TCaptureThread* pCapture, short** data, unsigned int* timestamp);
+
+/**
+ * Stops a capture thread and frees its buffers.
+ *
+ * @param Pointer to the capture thread
+ */
+void stopCapture(TCaptureThread* pCapture);
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "kinectChange.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHANGESIMD
+#endif
+
+///kernel used by updateChangeMask, returns for each tile column of a band of tiles whether it changed
+typedef void (*TCompareKernel)(const short*, const short*, int, int*);
+static void compareBandScalar(const short* previous, const short* data, int threshold, int* changed);
+static TCompareKernel compareKernel = compareBandScalar;
+static pthread_once_t compareKernelOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Compares a band of TILESIZE rows of two depth maps, one pixel at a time.
+ *
+ * @param Pointer to the first row of the band in the reference
+ * @param Pointer to the first row of the band in the depth map
+ * @param Difference of depth above which a pixel changed
+ * @param Pointer to the TILESX results, non zero if the tile changed
+ */
+static void compareBandScalar(const short* previous, const short* data, int threshold, int* changed){
+	int y, x;
+	for(x=0; x<TILESX; x++){ changed[x] = 0; }
+	for(y=0; y<TILESIZE; y++){
+		for(x=0; x<DEPTHWIDTH; x++){
+			int diff = data[y*DEPTHWIDTH + x] - previous[y*DEPTHWIDTH + x];
+			changed[x/TILESIZE] |= diff > threshold || diff < -threshold;
+		}
+	}
+}
+
+#ifdef CHANGESIMD
+
+/**
+ * Compares a band of TILESIZE rows of two depth maps, half a row of a tile at a time with SSE4.1.
+ * Must only be called if the CPU supports SSE4.1.
+ *
+ * @param Pointer to the first row of the band in the reference
+ * @param Pointer to the first row of the band in the depth map
+ * @param Difference of depth above which a pixel changed
+ * @param Pointer to the TILESX results, non zero if the tile changed
+ */
+__attribute__((target("sse4.1")))
+static void compareBandSSE(const short* previous, const short* data, int threshold, int* changed){
+	const __m128i vThreshold = _mm_set1_epi16(threshold);
+	int y, x, i;
+	for(x=0; x<TILESX; x++){
+		__m128i acc = _mm_setzero_si128();
+		for(y=0; y<TILESIZE; y++){
+			for(i=0; i<TILESIZE; i+=8){
+				__m128i a = _mm_loadu_si128((const __m128i*)(previous + y*DEPTHWIDTH + x*TILESIZE + i));
+				__m128i b = _mm_loadu_si128((const __m128i*)(data + y*DEPTHWIDTH + x*TILESIZE + i));
+				__m128i diff = _mm_abs_epi16(_mm_subs_epi16(b, a));
+				acc = _mm_or_si128(acc, _mm_cmpgt_epi16(diff, vThreshold));
+			}
+		}
+		changed[x] = !_mm_testz_si128(acc, acc);
+	}
+}
+
+/**
+ * Compares a band of TILESIZE rows of two depth maps, one row of a tile at a time with AVX2.
+ * Must only be called if the CPU supports AVX2.
+ *
+ * @param Pointer to the first row of the band in the reference
+ * @param Pointer to the first row of the band in the depth map
+ * @param Difference of depth above which a pixel changed
+ * @param Pointer to the TILESX results, non zero if the tile changed
+ */
+__attribute__((target("avx2")))
+static void compareBandAVX2(const short* previous, const short* data, int threshold, int* changed){
+	const __m256i vThreshold = _mm256_set1_epi16(threshold);
+	int y, x;
+	for(x=0; x<TILESX; x++){
+		__m256i acc = _mm256_setzero_si256();
+		for(y=0; y<TILESIZE; y++){
+			__m256i a = _mm256_loadu_si256((const __m256i*)(previous + y*DEPTHWIDTH + x*TILESIZE));
+			__m256i b = _mm256_loadu_si256((const __m256i*)(data + y*DEPTHWIDTH + x*TILESIZE));
+			__m256i diff = _mm256_abs_epi16(_mm256_subs_epi16(b, a));
+			acc = _mm256_or_si256(acc, _mm256_cmpgt_epi16(diff, vThreshold));
+		}
+		changed[x] = !_mm256_testz_si256(acc, acc);
+	}
+}
+
+#endif
+
+/**
+ * Selects the fastest kernel supported by the CPU.
+ */
+static void initCompareKernel(){
+#ifdef CHANGESIMD
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")){
+		compareKernel = compareBandAVX2;
+	}else if(__builtin_cpu_supports("sse4.1")){
+		compareKernel = compareBandSSE;
+	}
+#endif
+}
+
+/**
+ * Allocates a change mask, all tiles of the first depth map are dirty.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the change mask
+ * @param Difference of depth above which a pixel changed, in mm
+ */
+int createChangeMask(TChangeMask* mask, int threshold){
+	mask->previous = malloc(DEPTHSIZE*sizeof(short));
+	if(mask->previous == NULL){ return 1; }
+	memset(mask->dirty, 0xff, sizeof(mask->dirty));
+	mask->nbDirty = NBTILES;
+	mask->threshold = threshold;
+	mask->nbFrames = 0;
+	return 0;
+}
+
+/**
+ * Frees a change mask.
+ *
+ * @param Pointer to the change mask
+ */
+void freeChangeMask(TChangeMask* mask){
+	free(mask->previous);
+	mask->previous = NULL;
+}
+
+/**
+ * Compares a depth map to the reference of a change mask and finds the dirty tiles.
+ * The fastest kernel supported by the CPU is used.
+ * Returns the number of dirty tiles.
+ *
+ * @param Pointer to the change mask
+ * @param Pointer to the depth map
+ */
+int updateChangeMask(TChangeMask* mask, const short* data){
+	pthread_once(&compareKernelOnce, initCompareKernel);
+	int tx, ty, y, changed[TILESX];
+	//everything changed in the first depth map
+	if(mask->nbFrames++ == 0){
+		memcpy(mask->previous, data, DEPTHSIZE*sizeof(short));
+		memset(mask->dirty, 0xff, sizeof(mask->dirty));
+		mask->nbDirty = NBTILES;
+		return NBTILES;
+	}
+	memset(mask->dirty, 0, sizeof(mask->dirty));
+	mask->nbDirty = 0;
+	for(ty=0; ty<TILESY; ty++){
+		int offset = ty*TILESIZE*DEPTHWIDTH;
+		compareKernel(mask->previous + offset, data + offset, mask->threshold, changed);
+		for(tx=0; tx<TILESX; tx++){
+			if(!changed[tx]){ continue; }
+			//mark the tile and update its reference
+			int tile = tx + ty*TILESX;
+			mask->dirty[tile/64] |= 1ULL << (tile%64);
+			mask->nbDirty++;
+			for(y=0; y<TILESIZE; y++){
+				memcpy(mask->previous + offset + y*DEPTHWIDTH + tx*TILESIZE, data + offset + y*DEPTHWIDTH + tx*TILESIZE, TILESIZE*sizeof(short));
+			}
+		}
+	}
+	return mask->nbDirty;
+}
+
+/**
+ * Returns 1 if a tile is dirty, 0 otherwise.
+ *
+ * @param Pointer to the change mask
+ * @param Column of the tile
+ * @param Row of the tile
+ */
+int tileChanged(const TChangeMask* mask, int tx, int ty){
+	int tile = tx + ty*TILESX;
+	return (mask->dirty[tile/64] >> (tile%64)) & 1;
+}
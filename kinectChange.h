@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include "kinectDetectionUtil.h"
+
+#define TILESIZE 16
+#define TILESX (DEPTHWIDTH/TILESIZE)
+#define TILESY (DEPTHHEIGHT/TILESIZE)
+#define NBTILES (TILESX*TILESY)
+#define CHANGETHRESHOLD 30
+
+/// Structure detecting the tiles of TILESIZE x TILESIZE pixels which changed between two depth maps.
+/// Tile (tx, ty) is dirty if bit tx + ty*TILESX of dirty is set.
+/// A tile is dirty if one of its pixels differs from the reference by more than the threshold.
+/// The reference of a tile is only updated when the tile is dirty, so slow drifts are detected too.
+typedef struct{
+	short* previous;
+	uint64_t dirty[(NBTILES+63)/64];
+	int nbDirty;
+	int threshold;
+	int nbFrames;
+}TChangeMask;
+
+
+/**
+ * Allocates a change mask, all tiles of the first depth map are dirty.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the change mask
+ * @param Difference of depth above which a pixel changed, in mm
+ */
+int createChangeMask(TChangeMask* mask, int threshold);
+
+/**
+ * Frees a change mask.
+ *
+ * @param Pointer to the change mask
+ */
+void freeChangeMask(TChangeMask* mask);
+
+/**
+ * Compares a depth map to the reference of a change mask and finds the dirty tiles.
+ * The fastest kernel supported by the CPU is used.
+ * Returns the number of dirty tiles.
+ *
+ * @param Pointer to the change mask
+ * @param Pointer to the depth map
+ */
+int updateChangeMask(TChangeMask* mask, const short* data);
+
+/**
+ * Returns 1 if a tile is dirty, 0 otherwise.
+ *
+ * @param Pointer to the change mask
+ * @param Column of the tile
+ * @param Row of the tile
+ */
+int tileChanged(const TChangeMask* mask, int tx, int ty);
@@ -0,0 +1,531 @@
+#include <stdlib.h>
+#include <math.h>
+#include <limits.h>
+#include "kinectCluster.h"
+
+#define SMALLMERGE 32
+
+/**
+ * Returns the bucket of a cell.
+ *
+ * @param Pointer to the cluster grid
+ * @param Coordinates of the cell
+ */
+static int cellBucket(const TClusterGrid* grid, const int* cell){
+	unsigned int h = (unsigned int)cell[0]*73856093u ^ (unsigned int)cell[1]*19349663u ^ (unsigned int)cell[2]*83492791u;
+	return h & (grid->nbBuckets-1);
+}
+
+/**
+ * Computes the cell containing a position.
+ * The coordinate of an axis which is not taken into account is always 0.
+ *
+ * @param Pointer to the cluster grid
+ * @param Pointer to the coordinates of the cell
+ * @param x coordinate of the position
+ * @param y coordinate of the position
+ * @param z coordinate of the position
+ */
+static void positionCell(const TClusterGrid* grid, int* cell, float x, float y, float z){
+	float scale = 0.5f/grid->tolerance;
+	cell[0] = grid->axes & CLUSTERX? (int)floorf(x*scale) : 0;
+	cell[1] = grid->axes & CLUSTERY? (int)floorf(y*scale) : 0;
+	cell[2] = grid->axes & CLUSTERZ? (int)floorf(z*scale) : 0;
+}
+
+/**
+ * Adds a cluster at the beginning of the bucket of its cell.
+ *
+ * @param Pointer to the cluster grid
+ * @param Index of the cluster
+ */
+static void linkCluster(TClusterGrid* grid, int k){
+	int bucket = cellBucket(grid, grid->clusters[k].cell);
+	grid->clusters[k].next = grid->buckets[bucket];
+	grid->buckets[bucket] = k;
+}
+
+/**
+ * Removes a cluster from the bucket of its cell.
+ *
+ * @param Pointer to the cluster grid
+ * @param Index of the cluster
+ */
+static void unlinkCluster(TClusterGrid* grid, int k){
+	int* pIndex = &(grid->buckets[cellBucket(grid, grid->clusters[k].cell)]);
+	while(*pIndex != k){
+		pIndex = &(grid->clusters[*pIndex].next);
+	}
+	*pIndex = grid->clusters[k].next;
+}
+
+/**
+ * Doubles the number of buckets and redistributes the clusters.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the cluster grid
+ */
+static int growBuckets(TClusterGrid* grid){
+	int* buckets = realloc(grid->buckets, 2*grid->nbBuckets*sizeof(int));
+	if(buckets == NULL){ return 1; }
+	grid->buckets = buckets;
+	grid->nbBuckets *= 2;
+	int i;
+	for(i=0; i<grid->nbBuckets; i++){
+		grid->buckets[i] = -1;
+	}
+	for(i=0; i<grid->n; i++){
+		linkCluster(grid, i);
+	}
+	return 0;
+}
+
+/**
+ * Allocates a cluster grid.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the cluster grid
+ * @param Tolerance for fusing two vectors
+ * @param Axes taken into account by the distance (CLUSTERXYZ, CLUSTERXY or CLUSTERZ)
+ * @param Expected number of clusters
+ */
+int createClusterGrid(TClusterGrid* grid, float tolerance, int axes, int capacity){
+	grid->tolerance = tolerance;
+	grid->axes = axes;
+	grid->nbBuckets = 16;
+	while(grid->nbBuckets < capacity){
+		grid->nbBuckets *= 2;
+	}
+	grid->capacity = grid->nbBuckets;
+	grid->buckets = malloc(grid->nbBuckets*sizeof(int));
+	grid->clusters = malloc(grid->capacity*sizeof(TCluster));
+	if(grid->buckets == NULL || grid->clusters == NULL){
+		freeClusterGrid(grid);
+		return 1;
+	}
+	resetClusterGrid(grid);
+	return 0;
+}
+
+/**
+ * Removes all the clusters of a grid.
+ *
+ * @param Pointer to the cluster grid
+ */
+void resetClusterGrid(TClusterGrid* grid){
+	int i;
+	for(i=0; i<grid->nbBuckets; i++){
+		grid->buckets[i] = -1;
+	}
+	grid->n = 0;
+}
+
+/**
+ * Frees a cluster grid.
+ *
+ * @param Pointer to the cluster grid
+ */
+void freeClusterGrid(TClusterGrid* grid){
+	free(grid->buckets);
+	free(grid->clusters);
+	grid->buckets = NULL;
+	grid->clusters = NULL;
+	grid->n = 0;
+	grid->capacity = 0;
+}
+
+/**
+ * Adds a vector to a cluster grid.
+ * If the vector is close enough to a cluster, it is fused with the oldest such cluster.
+ * Returns 1 if the vector was fused, 0 if a new cluster was created and -1 in case of a failure.
+ *
+ * @param Pointer to the cluster grid
+ * @param x coordinate of the vector
+ * @param y coordinate of the vector
+ * @param z coordinate of the vector
+ * @param Weight of the vector
+ */
+int addToClusterGrid(TClusterGrid* grid, float x, float y, float z, int weight){
+	int cell[3], neighbour[3], side[3];
+	float tolerance2 = grid->tolerance*grid->tolerance;
+	float cellSize = 2*grid->tolerance;
+	int i, j, k, c, best = -1;
+	positionCell(grid, cell, x, y, z);
+	//a close cluster is either in the same cell or in the neighbouring cell on the side of the nearest face
+	side[0] = grid->axes & CLUSTERX? (x < (cell[0]+0.5f)*cellSize? -1 : 1) : 0;
+	side[1] = grid->axes & CLUSTERY? (y < (cell[1]+0.5f)*cellSize? -1 : 1) : 0;
+	side[2] = grid->axes & CLUSTERZ? (z < (cell[2]+0.5f)*cellSize? -1 : 1) : 0;
+	for(i=0; i<=(side[0]!=0); i++){
+		neighbour[0] = cell[0] + i*side[0];
+		for(j=0; j<=(side[1]!=0); j++){
+			neighbour[1] = cell[1] + j*side[1];
+			for(k=0; k<=(side[2]!=0); k++){
+				neighbour[2] = cell[2] + k*side[2];
+				for(c=grid->buckets[cellBucket(grid, neighbour)]; c!=-1; c=grid->clusters[c].next){
+					const TCluster* cluster = &(grid->clusters[c]);
+					float dx = grid->axes & CLUSTERX? cluster->x - x : 0;
+					float dy = grid->axes & CLUSTERY? cluster->y - y : 0;
+					float dz = grid->axes & CLUSTERZ? cluster->z - z : 0;
+					if(dx*dx + dy*dy + dz*dz < tolerance2 && (best == -1 || c < best)){
+						best = c;
+					}
+				}
+			}
+		}
+	}
+	//fuse both vectors
+	if(best != -1){
+		TCluster* cluster = &(grid->clusters[best]);
+		int total = cluster->weight + weight;
+		cluster->x = (cluster->x*cluster->weight + x*weight)/total;
+		cluster->y = (cluster->y*cluster->weight + y*weight)/total;
+		cluster->z = (cluster->z*cluster->weight + z*weight)/total;
+		cluster->weight = total;
+		//move cluster if it changed cell
+		positionCell(grid, cell, cluster->x, cluster->y, cluster->z);
+		if(cell[0] != cluster->cell[0] || cell[1] != cluster->cell[1] || cell[2] != cluster->cell[2]){
+			unlinkCluster(grid, best);
+			cluster->cell[0] = cell[0];
+			cluster->cell[1] = cell[1];
+			cluster->cell[2] = cell[2];
+			linkCluster(grid, best);
+		}
+		return 1;
+	}
+	//make room for a new cluster
+	if(grid->n == grid->capacity){
+		TCluster* clusters = realloc(grid->clusters, 2*grid->capacity*sizeof(TCluster));
+		if(clusters == NULL){ return -1; }
+		grid->clusters = clusters;
+		grid->capacity *= 2;
+	}
+	if(grid->n >= grid->nbBuckets && growBuckets(grid)){ return -1; }
+	//add new cluster
+	TCluster* cluster = &(grid->clusters[grid->n]);
+	cluster->x = x;
+	cluster->y = y;
+	cluster->z = z;
+	cluster->weight = weight;
+	cluster->cell[0] = cell[0];
+	cluster->cell[1] = cell[1];
+	cluster->cell[2] = cell[2];
+	linkCluster(grid, grid->n);
+	grid->n++;
+	return 0;
+}
+
+/**
+ * Returns the representative of the set of a cluster and compresses the path to it.
+ *
+ * @param Parent of each cluster
+ * @param Index of the cluster
+ */
+static int findRoot(int* parent, int k){
+	int root = k;
+	while(parent[root] != root){
+		root = parent[root];
+	}
+	while(parent[k] != root){
+		int next = parent[k];
+		parent[k] = root;
+		k = next;
+	}
+	return root;
+}
+
+/**
+ * Makes each cluster a set of its own, with the weighted sum of its position and its weight.
+ *
+ * @param Pointer to the clusters
+ * @param Number of clusters
+ * @param Parent of each cluster
+ * @param Space for 4 sums per cluster
+ */
+static void initSets(const TCluster* clusters, int n, int* parent, double* sum){
+	int i;
+	for(i=0; i<n; i++){
+		parent[i] = i;
+		sum[4*i] = (double)clusters[i].x*clusters[i].weight;
+		sum[4*i+1] = (double)clusters[i].y*clusters[i].weight;
+		sum[4*i+2] = (double)clusters[i].z*clusters[i].weight;
+		sum[4*i+3] = clusters[i].weight;
+	}
+}
+
+/**
+ * Joins the sets of two clusters if their weighted averages are closer than the tolerance.
+ * Comparing the averages instead of the clusters bounds the size of a set, a chain of close clusters is not joined.
+ * The first member of a set is its representative and keeps the sums of the set.
+ *
+ * @param Parent of each cluster
+ * @param Sums of each set
+ * @param Index of the first cluster
+ * @param Index of the second cluster
+ * @param Square of the tolerance
+ * @param Weights of the x, y and z axes in the distance, 0 or 1
+ */
+static void joinSets(int* parent, double* sum, int a, int b, float tolerance2, const float* axis){
+	int r1 = findRoot(parent, a), r2 = findRoot(parent, b);
+	if(r1 == r2){ return; }
+	double d2 = 0;
+	int i;
+	for(i=0; i<3; i++){
+		double d = (sum[4*r1+i]/sum[4*r1+3] - sum[4*r2+i]/sum[4*r2+3])*axis[i];
+		d2 += d*d;
+	}
+	if(d2 >= tolerance2){ return; }
+	if(r2 < r1){
+		int tmp = r1;
+		r1 = r2;
+		r2 = tmp;
+	}
+	parent[r2] = r1;
+	for(i=0; i<4; i++){
+		sum[4*r1+i] += sum[4*r2+i];
+	}
+}
+
+/**
+ * Replaces each set of clusters by its weighted average, in place of its first member.
+ * Returns the number of sets.
+ *
+ * @param Pointer to the clusters
+ * @param Number of clusters
+ * @param Parent of each cluster, the first member of a set is its representative
+ * @param Sums of each set
+ */
+static int averageSets(TCluster* clusters, int n, const int* parent, const double* sum){
+	int i, m = 0;
+	for(i=0; i<n; i++){
+		if(parent[i] != i){ continue; }
+		clusters[m] = clusters[i];
+		clusters[m].x = sum[4*i]/sum[4*i+3];
+		clusters[m].y = sum[4*i+1]/sum[4*i+3];
+		clusters[m].z = sum[4*i+2]/sum[4*i+3];
+		clusters[m].weight = sum[4*i+3];
+		m++;
+	}
+	return m;
+}
+
+/**
+ * Merges the clusters of an array which are closer than the tolerance, in a single pass.
+ * Close clusters are joined with a union-find structure and replaced by their weighted average.
+ * Two sets are only joined while their weighted averages are closer than the tolerance,
+ * so that a dense chain of clusters is not merged into a single cluster.
+ * Arrays of at most SMALLMERGE clusters, such as vector lists, are compared pair by pair without the union-find:
+ * each cluster is fused with the first previous cluster whose average is closer than the tolerance.
+ * Merged clusters take the place of their first member, the order is kept.
+ * Returns the new number of clusters, or -1 in case of a failure.
+ *
+ * @param Pointer to the clusters
+ * @param Number of clusters
+ * @param Tolerance for fusing two clusters
+ * @param Axes taken into account by the distance (CLUSTERXYZ, CLUSTERXY or CLUSTERZ)
+ */
+int mergeClusters(TCluster* clusters, int n, float tolerance, int axes){
+	if(n < 2){ return n; }
+	int i, j, k, c, other;
+	float tolerance2 = tolerance*tolerance;
+	float axis[3] = {axes & CLUSTERX? 1 : 0, axes & CLUSTERY? 1 : 0, axes & CLUSTERZ? 1 : 0};
+	float mx = axis[0], my = axis[1], mz = axis[2];
+	//small arrays skip the union-find: each cluster is fused with the first kept cluster whose average is close enough
+	if(n <= SMALLMERGE){
+		int m = 0;
+		for(c=0; c<n; c++){
+			for(other=0; other<m; other++){
+				float dx = (clusters[other].x - clusters[c].x)*mx;
+				float dy = (clusters[other].y - clusters[c].y)*my;
+				float dz = (clusters[other].z - clusters[c].z)*mz;
+				if(dx*dx + dy*dy + dz*dz < tolerance2){ break; }
+			}
+			if(other == m){
+				clusters[m++] = clusters[c];
+				continue;
+			}
+			TCluster* cluster = &(clusters[other]);
+			int weight = cluster->weight + clusters[c].weight;
+			cluster->x = (cluster->x*cluster->weight + clusters[c].x*clusters[c].weight)/weight;
+			cluster->y = (cluster->y*cluster->weight + clusters[c].y*clusters[c].weight)/weight;
+			cluster->z = (cluster->z*cluster->weight + clusters[c].z*clusters[c].weight)/weight;
+			cluster->weight = weight;
+		}
+		return m;
+	}
+	//cells of the clusters, stored in a temporary grid
+	TClusterGrid grid;
+	grid.tolerance = tolerance;
+	grid.axes = axes;
+	grid.nbBuckets = 16;
+	while(grid.nbBuckets < n){
+		grid.nbBuckets *= 2;
+	}
+	//the clusters are sorted by bucket so that each bucket is a contiguous range
+	int* start = calloc(grid.nbBuckets+1, sizeof(int));
+	int* order = malloc(n*sizeof(int));
+	int* parent = malloc(n*sizeof(int));
+	float* sorted = malloc(3*n*sizeof(float));
+	double* sum = malloc(4*n*sizeof(double));
+	if(start == NULL || order == NULL || parent == NULL || sorted == NULL || sum == NULL){
+		free(start);
+		free(order);
+		free(parent);
+		free(sorted);
+		free(sum);
+		return -1;
+	}
+	for(c=0; c<n; c++){
+		positionCell(&grid, clusters[c].cell, clusters[c].x, clusters[c].y, clusters[c].z);
+		start[cellBucket(&grid, clusters[c].cell)+1]++;
+	}
+	initSets(clusters, n, parent, sum);
+	for(i=0; i<grid.nbBuckets; i++){
+		start[i+1] += start[i];
+	}
+	for(c=0; c<n; c++){
+		int pos = start[cellBucket(&grid, clusters[c].cell)]++;
+		order[pos] = c;
+		sorted[3*pos] = clusters[c].x;
+		sorted[3*pos+1] = clusters[c].y;
+		sorted[3*pos+2] = clusters[c].z;
+	}
+	for(i=grid.nbBuckets; i>0; i--){
+		start[i] = start[i-1];
+	}
+	start[0] = 0;
+	//join each cluster with the close clusters of the neighbouring cells
+	float cellSize = 2*tolerance;
+	for(c=0; c<n; c++){
+		const TCluster* cluster = &(clusters[c]);
+		int neighbour[3], side[3];
+		side[0] = axes & CLUSTERX? (cluster->x < (cluster->cell[0]+0.5f)*cellSize? -1 : 1) : 0;
+		side[1] = axes & CLUSTERY? (cluster->y < (cluster->cell[1]+0.5f)*cellSize? -1 : 1) : 0;
+		side[2] = axes & CLUSTERZ? (cluster->z < (cluster->cell[2]+0.5f)*cellSize? -1 : 1) : 0;
+		for(i=0; i<=(side[0]!=0); i++){
+			neighbour[0] = cluster->cell[0] + i*side[0];
+			for(j=0; j<=(side[1]!=0); j++){
+				neighbour[1] = cluster->cell[1] + j*side[1];
+				for(k=0; k<=(side[2]!=0); k++){
+					neighbour[2] = cluster->cell[2] + k*side[2];
+					int bucket = cellBucket(&grid, neighbour);
+					for(other=start[bucket]; other<start[bucket+1]; other++){
+						float dx = (sorted[3*other] - cluster->x)*mx;
+						float dy = (sorted[3*other+1] - cluster->y)*my;
+						float dz = (sorted[3*other+2] - cluster->z)*mz;
+						if(dx*dx + dy*dy + dz*dz < tolerance2 && order[other] > c){
+							joinSets(parent, sum, c, order[other], tolerance2, axis);
+						}
+					}
+				}
+			}
+		}
+	}
+	int m = averageSets(clusters, n, parent, sum);
+	free(start);
+	free(order);
+	free(parent);
+	free(sorted);
+	free(sum);
+	return m;
+}
+
+/**
+ * Fuses the clusters of a grid which are closer than its tolerance.
+ * Returns 1 if clusters were fused, 0 if not and -1 in case of a failure.
+ *
+ * @param Pointer to the cluster grid
+ */
+int simplifyClusterGrid(TClusterGrid* grid){
+	int n = mergeClusters(grid->clusters, grid->n, grid->tolerance, grid->axes);
+	if(n == -1){ return -1; }
+	if(n == grid->n){ return 0; }
+	//rebuild buckets
+	int i;
+	grid->n = n;
+	for(i=0; i<grid->nbBuckets; i++){
+		grid->buckets[i] = -1;
+	}
+	for(i=0; i<n; i++){
+		positionCell(grid, grid->clusters[i].cell, grid->clusters[i].x, grid->clusters[i].y, grid->clusters[i].z);
+		linkCluster(grid, i);
+	}
+	return 1;
+}
+
+/**
+ * Adds all the points of a point cloud to a cluster grid with a weight of 1.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the cluster grid
+ * @param Pointer to the point cloud
+ */
+int clusterPointCloud(TClusterGrid* grid, const TPointCloud* cloud){
+	int i;
+	for(i=0; i<cloud->n; i++){
+		if(addToClusterGrid(grid, cloud->x[i], cloud->y[i], cloud->z[i], 1) == -1){ return 1; }
+	}
+	return 0;
+}
+
+/**
+ * Copies the MAXVECTORS clusters with the highest weight to a vector list, heaviest first.
+ * Weights are limited to the range of the vector list.
+ *
+ * @param Pointer to the cluster grid
+ * @param Pointer to the vector list
+ */
+void clusterGridToVecList(const TClusterGrid* grid, TVecList* list){
+	int best[MAXVECTORS];
+	int i, j, n = 0;
+	//keep the heaviest clusters sorted
+	for(i=0; i<grid->n; i++){
+		int weight = grid->clusters[i].weight;
+		if(n == MAXVECTORS && weight <= grid->clusters[best[n-1]].weight){ continue; }
+		if(n < MAXVECTORS){ n++; }
+		for(j=n-1; j>0 && grid->clusters[best[j-1]].weight < weight; j--){
+			best[j] = best[j-1];
+		}
+		best[j] = i;
+	}
+	//copy them to the list
+	resetVecList(list);
+	for(i=0; i<n; i++){
+		const TCluster* cluster = &(grid->clusters[best[i]]);
+		list->vector[i].x = cluster->x;
+		list->vector[i].y = cluster->y;
+		list->vector[i].z = cluster->z;
+		list->vector[i].w = 1;
+		list->weight[i] = cluster->weight < SHRT_MAX? cluster->weight : SHRT_MAX;
+	}
+	list->n = n;
+}
+
+/**
+ * Processes every pixel of a depth map to generate a list of vectors.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud used for the conversion, with a capacity of at least DEPTHSIZE
+ * @param Pointer to the cluster grid, its tolerance and axes are used for clustering
+ * @param Pointer to the vector list
+ */
+int detectDroneDense(const short* data, TPointCloud* cloud, TClusterGrid* grid, TVecList* list){
+	if(data == NULL || list == NULL){ return 1; }
+	depthToPointCloud(kinectIntrinsics(), data, cloud);
+	resetClusterGrid(grid);
+	if(clusterPointCloud(grid, cloud)){ return 1; }
+	clusterGridToVecList(grid, list);
+	return 0;
+}
+
+/**
+ * Returns the axes corresponding to a distance function of kinectDetectionUtil.h, 0 for any other function.
+ *
+ * @param Function used to determine the distance between two vectors
+ */
+int clusterAxes(float vecDistance(const TVec4D*, const TVec4D*)){
+	if(vecDistance == vec3DDistance){ return CLUSTERXYZ; }
+	if(vecDistance == vec2DDistance){ return CLUSTERXY; }
+	if(vecDistance == vecHeightDifference){ return CLUSTERZ; }
+	return 0;
+}
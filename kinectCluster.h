@@ -0,0 +1,136 @@
+#pragma once
+
+#include "kinectDetectionUtil.h"
+#include "kinectDense.h"
+
+///axes taken into account by the distance between two vectors
+#define CLUSTERX 1
+#define CLUSTERY 2
+#define CLUSTERZ 4
+#define CLUSTERXY (CLUSTERX | CLUSTERY)
+#define CLUSTERXYZ (CLUSTERX | CLUSTERY | CLUSTERZ)
+
+/// Structure representing a cluster of fused vectors.
+/// The position is the weighted average of the fused vectors.
+/// The cell is the cell of the grid containing the position, next is the following cluster of the same bucket.
+typedef struct{
+	float x, y, z;
+	int weight;
+	int cell[3];
+	int next;
+}TCluster;
+
+/// Structure containing clusters indexed by a uniform 3D hash grid.
+/// The size of a cell is twice the tolerance: a cluster closer than the tolerance to a position is either in its cell
+/// or in the neighbouring cell on the side of its nearest face along each axis, so only 2^d cells (8 in 3D) are checked
+/// instead of the 3^d neighbouring cells of a grid whose cells equal the tolerance.
+/// Each bucket contains the index of its first cluster, -1 if empty.
+typedef struct TClusterGrid{
+	float tolerance;
+	int axes;
+	int* buckets;
+	int nbBuckets;
+	TCluster* clusters;
+	int n;
+	int capacity;
+}TClusterGrid;
+
+
+/**
+ * Allocates a cluster grid.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the cluster grid
+ * @param Tolerance for fusing two vectors
+ * @param Axes taken into account by the distance (CLUSTERXYZ, CLUSTERXY or CLUSTERZ)
+ * @param Expected number of clusters
+ */
+int createClusterGrid(TClusterGrid* grid, float tolerance, int axes, int capacity);
+
+/**
+ * Removes all the clusters of a grid.
+ *
+ * @param Pointer to the cluster grid
+ */
+void resetClusterGrid(TClusterGrid* grid);
+
+/**
+ * Frees a cluster grid.
+ *
+ * @param Pointer to the cluster grid
+ */
+void freeClusterGrid(TClusterGrid* grid);
+
+/**
+ * Adds a vector to a cluster grid.
+ * If the vector is close enough to a cluster, it is fused with the oldest such cluster.
+ * Returns 1 if the vector was fused, 0 if a new cluster was created and -1 in case of a failure.
+ *
+ * @param Pointer to the cluster grid
+ * @param x coordinate of the vector
+ * @param y coordinate of the vector
+ * @param z coordinate of the vector
+ * @param Weight of the vector
+ */
+int addToClusterGrid(TClusterGrid* grid, float x, float y, float z, int weight);
+
+/**
+ * Merges the clusters of an array which are closer than the tolerance, in a single pass.
+ * Close clusters are joined with a union-find structure and replaced by their weighted average.
+ * Two sets are only joined while their weighted averages are closer than the tolerance,
+ * so that a dense chain of clusters is not merged into a single cluster.
+ * Arrays of at most SMALLMERGE clusters, such as vector lists, are compared pair by pair without the union-find:
+ * each cluster is fused with the first previous cluster whose average is closer than the tolerance.
+ * Merged clusters take the place of their first member, the order is kept.
+ * Returns the new number of clusters, or -1 in case of a failure.
+ *
+ * @param Pointer to the clusters
+ * @param Number of clusters
+ * @param Tolerance for fusing two clusters
+ * @param Axes taken into account by the distance (CLUSTERXYZ, CLUSTERXY or CLUSTERZ)
+ */
+int mergeClusters(TCluster* clusters, int n, float tolerance, int axes);
+
+/**
+ * Fuses the clusters of a grid which are closer than its tolerance.
+ * Returns 1 if clusters were fused, 0 if not and -1 in case of a failure.
+ *
+ * @param Pointer to the cluster grid
+ */
+int simplifyClusterGrid(TClusterGrid* grid);
+
+/**
+ * Adds all the points of a point cloud to a cluster grid with a weight of 1.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the cluster grid
+ * @param Pointer to the point cloud
+ */
+int clusterPointCloud(TClusterGrid* grid, const TPointCloud* cloud);
+
+/**
+ * Copies the MAXVECTORS clusters with the highest weight to a vector list, heaviest first.
+ * Weights are limited to the range of the vector list.
+ *
+ * @param Pointer to the cluster grid
+ * @param Pointer to the vector list
+ */
+void clusterGridToVecList(const TClusterGrid* grid, TVecList* list);
+
+/**
+ * Processes every pixel of a depth map to generate a list of vectors.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud used for the conversion, with a capacity of at least DEPTHSIZE
+ * @param Pointer to the cluster grid, its tolerance and axes are used for clustering
+ * @param Pointer to the vector list
+ */
+int detectDroneDense(const short* data, TPointCloud* cloud, TClusterGrid* grid, TVecList* list);
+
+/**
+ * Returns the axes corresponding to a distance function of kinectDetectionUtil.h, 0 for any other function.
+ *
+ * @param Function used to determine the distance between two vectors
+ */
+int clusterAxes(float vecDistance(const TVec4D*, const TVec4D*));
@@ -0,0 +1,290 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "kinectControl.h"
+
+/**
+ * Reads an integer in a range.
+ * Returns 0 if the operation is a success and 1 if the text is not an integer of the range.
+ *
+ * @param Text to read
+ * @param Minimum value
+ * @param Maximum value
+ * @param Pointer to the value
+ */
+static int parseInt(const char* text, int min, int max, int* value){
+	char* end;
+	long v = strtol(text, &end, 10);
+	if(end == text || *end != '\0' || v < min || v > max){
+		return 1;
+	}
+	*value = v;
+	return 0;
+}
+
+/**
+ * Reads a positive float, at most CONTROLMAXDEPTH.
+ * Returns 0 if the operation is a success and 1 if the text is not a valid tolerance.
+ *
+ * @param Text to read
+ * @param Pointer to the value
+ */
+static int parseTolerance(const char* text, float* value){
+	char* end;
+	float v = strtof(text, &end);
+	if(end == text || *end != '\0' || !(v > 0 && v <= CONTROLMAXDEPTH)){
+		return 1;
+	}
+	*value = v;
+	return 0;
+}
+
+/**
+ * Reads a plane given as a,b,c,d with a normal which is not null.
+ * Returns 0 if the operation is a success and 1 if the text is not a valid plane.
+ *
+ * @param Text to read
+ * @param Pointer to the plane
+ */
+static int parsePlane(const char* text, TPlane* plane){
+	TPlane p;
+	int length = 0;
+	if(sscanf(text, "%f,%f,%f,%f%n", &(p.a), &(p.b), &(p.c), &(p.d), &length) != 4 || text[length] != '\0'){
+		return 1;
+	}
+	if(!isfinite(p.d) || !(p.a*p.a + p.b*p.b + p.c*p.c > 0)){
+		return 1;
+	}
+	*plane = p;
+	return 0;
+}
+
+/**
+ * Returns 1 if an address given as "ip" or "ip:port" is the one of a client, 0 otherwise.
+ *
+ * @param Address to check
+ * @param Pointer to the address of the client
+ */
+static int isClientAddress(const char* address, const struct sockaddr_in* client){
+	char ip[INET_ADDRSTRLEN];
+	struct in_addr addr;
+	size_t length = strcspn(address, ":");
+	if(length >= INET_ADDRSTRLEN){ return 0; }
+	memcpy(ip, address, length);
+	ip[length] = '\0';
+	return inet_aton(ip, &addr) != 0 && addr.s_addr == client->sin_addr.s_addr;
+}
+
+/**
+ * Applies the assignments of a set command to a copy of the parameters.
+ * Returns 0 if the operation is a success and 1 if an assignment is invalid, the reply then gives the reason.
+ *
+ * @param Assignments separated by spaces, modified
+ * @param Pointer to the parameters
+ * @param Pointer to the reply
+ */
+static int parseAssignments(char* assignments, TDetectionParams* params, char* reply){
+	char* save;
+	char* token;
+	int n = 0;
+	for(token = strtok_r(assignments, " \t\r\n", &save); token != NULL; token = strtok_r(NULL, " \t\r\n", &save)){
+		char* value = strchr(token, '=');
+		int failed;
+		if(value == NULL){
+			snprintf(reply, CONTROLREPLY, "error expected <name>=<value> instead of %.64s", token);
+			return 1;
+		}
+		*(value++) = '\0';
+		if(strcmp(token, "iterations") == 0){
+			failed = parseInt(value, 1, CONTROLMAXITERATIONS, &(params->nbIterations));
+		}else if(strcmp(token, "mindepth") == 0){
+			failed = parseInt(value, 0, CONTROLMAXDEPTH, &(params->minDepth));
+		}else if(strcmp(token, "maxdepth") == 0){
+			failed = parseInt(value, 0, CONTROLMAXDEPTH, &(params->maxDepth));
+		}else if(strcmp(token, "floor") == 0){
+			failed = parsePlane(value, &(params->floor));
+		}else if(strcmp(token, "ceiling") == 0){
+			failed = parsePlane(value, &(params->ceiling));
+		}else if(strcmp(token, "cluster") == 0){
+			failed = parseTolerance(value, &(params->clusterTolerance));
+		}else if(strcmp(token, "fusion") == 0){
+			failed = parseTolerance(value, &(params->fusionTolerance));
+		}else{
+			snprintf(reply, CONTROLREPLY, "error unknown parameter %.64s", token);
+			return 1;
+		}
+		if(failed){
+			snprintf(reply, CONTROLREPLY, "error invalid value %.64s for %s", value, token);
+			return 1;
+		}
+		n++;
+	}
+	if(n == 0){
+		snprintf(reply, CONTROLREPLY, "error nothing to set");
+		return 1;
+	}
+	if(params->minDepth >= params->maxDepth){
+		snprintf(reply, CONTROLREPLY, "error mindepth must be below maxdepth");
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Executes one command and writes its reply, which starts with "ok" or "error".
+ * A remote client may only subscribe or unsubscribe its own address, so that the channel cannot be used
+ * to send the positions to a third party.
+ * Returns 0 if the command was executed and 1 if it was rejected.
+ *
+ * @param Text of the command
+ * @param Pointer to the reply, at least CONTROLREPLY bytes long
+ * @param Pointer to the publisher changed by subscribe and unsubscribe, NULL for none
+ * @param Pointer to the address of a remote client, NULL for a local client which may subscribe any address
+ */
+int executeControlCommand(const char* command, char* reply, TPublisher* pub, const struct sockaddr_in* client){
+	char copy[CONTROLREPLY];
+	TDetectionParams params;
+	getDetectionParams(&params);
+	//split the name of the command from its arguments
+	snprintf(copy, sizeof(copy), "%s", command);
+	char* args = copy + strcspn(copy, " \t\r\n");
+	if(*args != '\0'){
+		*(args++) = '\0';
+	}
+	args += strspn(args, " \t");
+	args[strcspn(args, "\r\n")] = '\0';
+	if(strcmp(copy, "get") == 0){
+		snprintf(reply, CONTROLREPLY, "ok version=%u iterations=%d mindepth=%d maxdepth=%d floor=%g,%g,%g,%g ceiling=%g,%g,%g,%g cluster=%g fusion=%g",
+			params.version, params.nbIterations, params.minDepth, params.maxDepth,
+			params.floor.a, params.floor.b, params.floor.c, params.floor.d,
+			params.ceiling.a, params.ceiling.b, params.ceiling.c, params.ceiling.d,
+			params.clusterTolerance, params.fusionTolerance);
+		return 0;
+	}
+	if(strcmp(copy, "set") == 0){
+		if(parseAssignments(args, &params, reply)){
+			return 1;
+		}
+		setDetectionParams(&params);
+		getDetectionParams(&params);
+		snprintf(reply, CONTROLREPLY, "ok version=%u", params.version);
+		return 0;
+	}
+	if(strcmp(copy, "subscribe") == 0 || strcmp(copy, "unsubscribe") == 0){
+		int failed;
+		if(pub == NULL){
+			snprintf(reply, CONTROLREPLY, "error no publisher");
+			return 1;
+		}
+		if(client != NULL && !isClientAddress(args, client)){
+			snprintf(reply, CONTROLREPLY, "error remote clients may only %.16s their own address", copy);
+			return 1;
+		}
+		failed = (copy[0] == 's')? addSubscriber(pub, args) : removeSubscriber(pub, args);
+		if(failed){
+			snprintf(reply, CONTROLREPLY, "error cannot %.16s %.64s", copy, args);
+			return 1;
+		}
+		snprintf(reply, CONTROLREPLY, "ok %d subscribers", subscriberCount(pub));
+		return 0;
+	}
+	snprintf(reply, CONTROLREPLY, "error unknown command %.64s", copy);
+	return 1;
+}
+
+/**
+ * Function executed by the control thread: answers each datagram received on the control socket.
+ *
+ * @param Pointer to the control channel
+ */
+static void* controlLoop(void* arg){
+	TControlChannel* control = arg;
+	char command[CONTROLREPLY], reply[CONTROLREPLY];
+	struct sockaddr_in client;
+	while(atomic_load(&(control->running))){
+		socklen_t length = sizeof(client);
+		//the socket has a receive timeout, so that the thread sees when it has to stop
+		int n = recvfrom(control->socket, command, sizeof(command)-1, 0, (struct sockaddr*)&client, &length);
+		if(n <= 0){
+			continue;
+		}
+		command[n] = '\0';
+		atomic_fetch_add(&(control->nbCommands), 1);
+		if(executeControlCommand(command, reply, control->publisher, control->local? NULL : &client)){
+			atomic_fetch_add(&(control->nbRejected), 1);
+		}
+		sendto(control->socket, reply, strlen(reply), 0, (struct sockaddr*)&client, length);
+	}
+	return NULL;
+}
+
+/**
+ * Opens the control socket and starts the thread answering the commands.
+ * The current parameters (the global variables of kinectDetectionUtil.h) are published first.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the control channel
+ * @param Address to listen on, "port" for the loopback interface only or "ip:port"
+ * @param Pointer to the publisher changed by subscribe and unsubscribe, NULL for none
+ */
+int startControlChannel(TControlChannel* control, const char* address, TPublisher* pub){
+	struct sockaddr_in addr;
+	struct timeval timeout = {0, 200000};
+	char ip[INET_ADDRSTRLEN] = "127.0.0.1";
+	const char* colon = strchr(address, ':');
+	int port;
+	TDetectionParams params;
+	//address of the socket
+	if(colon != NULL){
+		if(colon - address >= INET_ADDRSTRLEN){ return 1; }
+		memcpy(ip, address, colon - address);
+		ip[colon - address] = '\0';
+		address = colon + 1;
+	}
+	if(parseInt(address, 1, 65535, &port)){
+		return 1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if(inet_aton(ip, &(addr.sin_addr)) == 0){
+		return 1;
+	}
+	control->publisher = pub;
+	control->local = (ntohl(addr.sin_addr.s_addr) >> 24) == 127;
+	atomic_init(&(control->nbCommands), 0);
+	atomic_init(&(control->nbRejected), 0);
+	atomic_init(&(control->running), 1);
+	control->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if(control->socket == -1){
+		return 1;
+	}
+	if(bind(control->socket, (struct sockaddr*)&addr, sizeof(addr)) || setsockopt(control->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout))){
+		close(control->socket);
+		return 1;
+	}
+	//from now on the detection reads the published parameters
+	getDetectionParams(&params);
+	setDetectionParams(&params);
+	if(pthread_create(&(control->thread), NULL, controlLoop, control)){
+		close(control->socket);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Stops the control thread and closes its socket. The published parameters stay in use.
+ *
+ * @param Pointer to the control channel
+ */
+void stopControlChannel(TControlChannel* control){
+	atomic_store(&(control->running), 0);
+	pthread_join(control->thread, NULL);
+	close(control->socket);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <netinet/in.h>
+#include "kinectDetectionUtil.h"
+#include "kinectPublisher.h"
+
+#define CONTROLPORT 5006
+#define CONTROLMAXITERATIONS 100000
+#define CONTROLMAXDEPTH 10000
+#define CONTROLREPLY 512
+
+/// Structure representing the thread answering the commands of the control clients.
+/// Each UDP datagram is one text command, the reply is sent back to the client:
+///   get                                   gives the current parameters
+///   set <name>=<value> [<name>=<value>]   changes parameters, all of them or none
+///   subscribe <ip[:port]>                 adds a subscriber to the publisher
+///   unsubscribe <ip[:port]>               removes a subscriber from the publisher
+/// When the channel listens on another interface than the loopback, clients may only subscribe their own IP.
+/// The names are iterations, mindepth, maxdepth, floor, ceiling (a,b,c,d), cluster and fusion (tolerances).
+/// Changed parameters are published with setDetectionParams, the detection never waits for the control thread.
+typedef struct{
+	int socket;
+	int local;
+	TPublisher* publisher;
+	atomic_int running;
+	pthread_t thread;
+	atomic_long nbCommands;
+	atomic_long nbRejected;
+}TControlChannel;
+
+
+/**
+ * Opens the control socket and starts the thread answering the commands.
+ * The current parameters (the global variables of kinectDetectionUtil.h) are published first.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the control channel
+ * @param Address to listen on, "port" for the loopback interface only or "ip:port"
+ * @param Pointer to the publisher changed by subscribe and unsubscribe, NULL for none
+ */
+int startControlChannel(TControlChannel* control, const char* address, TPublisher* pub);
+
+/**
+ * Executes one command and writes its reply, which starts with "ok" or "error".
+ * A remote client may only subscribe or unsubscribe its own address, so that the channel cannot be used
+ * to send the positions to a third party.
+ * Returns 0 if the command was executed and 1 if it was rejected.
+ *
+ * @param Text of the command
+ * @param Pointer to the reply, at least CONTROLREPLY bytes long
+ * @param Pointer to the publisher changed by subscribe and unsubscribe, NULL for none
+ * @param Pointer to the address of a remote client, NULL for a local client which may subscribe any address
+ */
+int executeControlCommand(const char* command, char* reply, TPublisher* pub, const struct sockaddr_in* client);
+
+/**
+ * Stops the control thread and closes its socket. The published parameters stay in use.
+ *
+ * @param Pointer to the control channel
+ */
+void stopControlChannel(TControlChannel* control);
@@ -0,0 +1,428 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "kinectDense.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DENSESIMD
+#endif
+
+#define CLOUDMARGIN 8
+
+///kernel used by depthToPointCloud
+static int (*denseKernel)(const TIntrinsics*, const short*, TPointCloud*) = depthToPointCloudScalar;
+static const char* denseKernelName = "scalar";
+static pthread_once_t denseKernelOnce = PTHREAD_ONCE_INIT;
+static int denseFastest = DENSESCALAR;
+static void initDenseKernel();
+///kernel used by transformPoints
+static void transformPointsScalar(const TMatrix4D*, const float*, const float*, const float*, float*, float*, float*, int);
+static void (*transformKernel)(const TMatrix4D*, const float*, const float*, const float*, float*, float*, float*, int) = transformPointsScalar;
+
+#ifdef DENSESIMD
+///permutations moving the selected lanes of a vector to the front, for each mask
+static int compress8[256][8];
+static char compress4[16][16];
+#endif
+
+/**
+ * Allocates a point cloud.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the point cloud
+ * @param Maximum number of points
+ */
+int createPointCloud(TPointCloud* cloud, int capacity){
+	cloud->x = malloc((capacity+CLOUDMARGIN)*sizeof(float));
+	cloud->y = malloc((capacity+CLOUDMARGIN)*sizeof(float));
+	cloud->z = malloc((capacity+CLOUDMARGIN)*sizeof(float));
+	cloud->n = 0;
+	cloud->capacity = capacity;
+	if(cloud->x == NULL || cloud->y == NULL || cloud->z == NULL){
+		freePointCloud(cloud);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Frees a point cloud.
+ *
+ * @param Pointer to the point cloud
+ */
+void freePointCloud(TPointCloud* cloud){
+	free(cloud->x);
+	free(cloud->y);
+	free(cloud->z);
+	cloud->x = cloud->y = cloud->z = NULL;
+	cloud->n = 0;
+	cloud->capacity = 0;
+}
+
+/**
+ * Same as depthToPointCloud, one pixel at a time.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud, with a capacity of at least DEPTHSIZE
+ */
+int depthToPointCloudScalar(const TIntrinsics* intr, const short* data, TPointCloud* cloud){
+	int xs, ys, n = 0;
+	TDetectionParams p;
+	getDetectionParams(&p);
+	const TPlane f = p.floor, c = p.ceiling;
+	for(ys=0; ys<DEPTHHEIGHT; ys++){
+		const short* row = data + ys*DEPTHWIDTH;
+		float rayZ = intr->rayZ[ys];
+		for(xs=0; xs<DEPTHWIDTH; xs++){
+			//if the depth at that pixel between min and max...
+			if(row[xs]>p.minDepth && row[xs]<p.maxDepth){
+				float depth = row[xs] + intr->depthOffset;
+				float x = depth*intr->rayX[xs];
+				float z = depth*rayZ;
+				//if the point is between the floor and the ceiling...
+				if(f.a*x + f.b*depth + f.c*z + f.d > 0 && c.a*x + c.b*depth + c.c*z + c.d > 0){
+					cloud->x[n] = x;
+					cloud->y[n] = depth;
+					cloud->z[n] = z;
+					n++;
+				}
+			}
+		}
+	}
+	cloud->n = n;
+	return n;
+}
+
+/**
+ * Same as transformPoints, one point at a time.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the x coordinates
+ * @param Pointer to the y coordinates
+ * @param Pointer to the z coordinates
+ * @param Pointer to the transformed x coordinates
+ * @param Pointer to the transformed y coordinates
+ * @param Pointer to the transformed z coordinates
+ * @param Number of points
+ */
+static void transformPointsScalar(const TMatrix4D* m, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, int n){
+	int i;
+	for(i=0; i<n; i++){
+		float px = x[i], py = y[i], pz = z[i];
+		outX[i] = px*m->m[0] + py*m->m[1] + pz*m->m[2] + m->m[3];
+		outY[i] = px*m->m[4] + py*m->m[5] + pz*m->m[6] + m->m[7];
+		outZ[i] = px*m->m[8] + py*m->m[9] + pz*m->m[10] + m->m[11];
+	}
+}
+
+#ifdef DENSESIMD
+
+/**
+ * Same as depthToPointCloud, 4 pixels at a time with SSE4.1.
+ * Must only be called if the CPU supports SSE4.1.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud, with a capacity of at least DEPTHSIZE
+ */
+__attribute__((target("sse4.1")))
+int depthToPointCloudSSE(const TIntrinsics* intr, const short* data, TPointCloud* cloud){
+	pthread_once(&denseKernelOnce, initDenseKernel);
+	int xs, ys, n = 0;
+	TDetectionParams p;
+	getDetectionParams(&p);
+	const __m128i vMinDepth = _mm_set1_epi32(p.minDepth);
+	const __m128i vMaxDepth = _mm_set1_epi32(p.maxDepth);
+	const __m128 fa = _mm_set1_ps(p.floor.a), fb = _mm_set1_ps(p.floor.b), fc = _mm_set1_ps(p.floor.c), fd = _mm_set1_ps(p.floor.d);
+	const __m128 ca = _mm_set1_ps(p.ceiling.a), cb = _mm_set1_ps(p.ceiling.b), cc = _mm_set1_ps(p.ceiling.c), cd = _mm_set1_ps(p.ceiling.d);
+	const __m128 vOffset = _mm_set1_ps(intr->depthOffset);
+	for(ys=0; ys<DEPTHHEIGHT; ys++){
+		const short* row = data + ys*DEPTHWIDTH;
+		const __m128 vRayZ = _mm_set1_ps(intr->rayZ[ys]);
+		for(xs=0; xs<DEPTHWIDTH; xs+=4){
+			//depth test
+			__m128i d = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)(row+xs)));
+			__m128i inDepth = _mm_and_si128(_mm_cmpgt_epi32(d, vMinDepth), _mm_cmpgt_epi32(vMaxDepth, d));
+			//floor and ceiling test
+			__m128 depth = _mm_add_ps(_mm_cvtepi32_ps(d), vOffset);
+			__m128 x = _mm_mul_ps(depth, _mm_loadu_ps(intr->rayX+xs));
+			__m128 z = _mm_mul_ps(depth, vRayZ);
+			__m128 floorH = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(fa, x), _mm_mul_ps(fb, depth)), _mm_mul_ps(fc, z)), fd);
+			__m128 ceilingH = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ca, x), _mm_mul_ps(cb, depth)), _mm_mul_ps(cc, z)), cd);
+			__m128 inArea = _mm_and_ps(_mm_cmpgt_ps(floorH, _mm_setzero_ps()), _mm_cmpgt_ps(ceilingH, _mm_setzero_ps()));
+			int mask = _mm_movemask_ps(_mm_and_ps(_mm_castsi128_ps(inDepth), inArea));
+			if(mask == 0){ continue; }
+			//store surviving points
+			__m128i perm = _mm_loadu_si128((const __m128i*)compress4[mask]);
+			_mm_storeu_ps(cloud->x+n, _mm_castsi128_ps(_mm_shuffle_epi8(_mm_castps_si128(x), perm)));
+			_mm_storeu_ps(cloud->y+n, _mm_castsi128_ps(_mm_shuffle_epi8(_mm_castps_si128(depth), perm)));
+			_mm_storeu_ps(cloud->z+n, _mm_castsi128_ps(_mm_shuffle_epi8(_mm_castps_si128(z), perm)));
+			n += __builtin_popcount(mask);
+		}
+	}
+	cloud->n = n;
+	return n;
+}
+
+/**
+ * Same as depthToPointCloud, 8 pixels at a time with AVX2.
+ * Must only be called if the CPU supports AVX2.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud, with a capacity of at least DEPTHSIZE
+ */
+__attribute__((target("avx2")))
+int depthToPointCloudAVX2(const TIntrinsics* intr, const short* data, TPointCloud* cloud){
+	pthread_once(&denseKernelOnce, initDenseKernel);
+	int xs, ys, n = 0;
+	TDetectionParams p;
+	getDetectionParams(&p);
+	const __m256i vMinDepth = _mm256_set1_epi32(p.minDepth);
+	const __m256i vMaxDepth = _mm256_set1_epi32(p.maxDepth);
+	const __m256 fa = _mm256_set1_ps(p.floor.a), fb = _mm256_set1_ps(p.floor.b), fc = _mm256_set1_ps(p.floor.c), fd = _mm256_set1_ps(p.floor.d);
+	const __m256 ca = _mm256_set1_ps(p.ceiling.a), cb = _mm256_set1_ps(p.ceiling.b), cc = _mm256_set1_ps(p.ceiling.c), cd = _mm256_set1_ps(p.ceiling.d);
+	const __m256 vOffset = _mm256_set1_ps(intr->depthOffset);
+	for(ys=0; ys<DEPTHHEIGHT; ys++){
+		const short* row = data + ys*DEPTHWIDTH;
+		const __m256 vRayZ = _mm256_set1_ps(intr->rayZ[ys]);
+		for(xs=0; xs<DEPTHWIDTH; xs+=8){
+			//depth test
+			__m256i d = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(row+xs)));
+			__m256i inDepth = _mm256_and_si256(_mm256_cmpgt_epi32(d, vMinDepth), _mm256_cmpgt_epi32(vMaxDepth, d));
+			//floor and ceiling test
+			__m256 depth = _mm256_add_ps(_mm256_cvtepi32_ps(d), vOffset);
+			__m256 x = _mm256_mul_ps(depth, _mm256_loadu_ps(intr->rayX+xs));
+			__m256 z = _mm256_mul_ps(depth, vRayZ);
+			__m256 floorH = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(fa, x), _mm256_mul_ps(fb, depth)), _mm256_mul_ps(fc, z)), fd);
+			__m256 ceilingH = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ca, x), _mm256_mul_ps(cb, depth)), _mm256_mul_ps(cc, z)), cd);
+			__m256 inArea = _mm256_and_ps(_mm256_cmp_ps(floorH, _mm256_setzero_ps(), _CMP_GT_OQ), _mm256_cmp_ps(ceilingH, _mm256_setzero_ps(), _CMP_GT_OQ));
+			int mask = _mm256_movemask_ps(_mm256_and_ps(_mm256_castsi256_ps(inDepth), inArea));
+			if(mask == 0){ continue; }
+			//store surviving points
+			__m256i perm = _mm256_loadu_si256((const __m256i*)compress8[mask]);
+			_mm256_storeu_ps(cloud->x+n, _mm256_permutevar8x32_ps(x, perm));
+			_mm256_storeu_ps(cloud->y+n, _mm256_permutevar8x32_ps(depth, perm));
+			_mm256_storeu_ps(cloud->z+n, _mm256_permutevar8x32_ps(z, perm));
+			n += __builtin_popcount(mask);
+		}
+	}
+	cloud->n = n;
+	return n;
+}
+
+/**
+ * Same as transformPoints, 4 points at a time with SSE4.1.
+ * Must only be called if the CPU supports SSE4.1.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the x coordinates
+ * @param Pointer to the y coordinates
+ * @param Pointer to the z coordinates
+ * @param Pointer to the transformed x coordinates
+ * @param Pointer to the transformed y coordinates
+ * @param Pointer to the transformed z coordinates
+ * @param Number of points
+ */
+__attribute__((target("sse4.1")))
+static void transformPointsSSE(const TMatrix4D* m, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, int n){
+	__m128 r[12];
+	int i;
+	for(i=0; i<12; i++){ r[i] = _mm_set1_ps(m->m[i]); }
+	for(i=0; i+4<=n; i+=4){
+		__m128 px = _mm_loadu_ps(x+i), py = _mm_loadu_ps(y+i), pz = _mm_loadu_ps(z+i);
+		_mm_storeu_ps(outX+i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, r[0]), _mm_mul_ps(py, r[1])), _mm_mul_ps(pz, r[2])), r[3]));
+		_mm_storeu_ps(outY+i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, r[4]), _mm_mul_ps(py, r[5])), _mm_mul_ps(pz, r[6])), r[7]));
+		_mm_storeu_ps(outZ+i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, r[8]), _mm_mul_ps(py, r[9])), _mm_mul_ps(pz, r[10])), r[11]));
+	}
+	transformPointsScalar(m, x+i, y+i, z+i, outX+i, outY+i, outZ+i, n-i);
+}
+
+/**
+ * Same as transformPoints, 8 points at a time with AVX2.
+ * Must only be called if the CPU supports AVX2.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the x coordinates
+ * @param Pointer to the y coordinates
+ * @param Pointer to the z coordinates
+ * @param Pointer to the transformed x coordinates
+ * @param Pointer to the transformed y coordinates
+ * @param Pointer to the transformed z coordinates
+ * @param Number of points
+ */
+__attribute__((target("avx2")))
+static void transformPointsAVX2(const TMatrix4D* m, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, int n){
+	__m256 r[12];
+	int i;
+	for(i=0; i<12; i++){ r[i] = _mm256_set1_ps(m->m[i]); }
+	for(i=0; i+8<=n; i+=8){
+		__m256 px = _mm256_loadu_ps(x+i), py = _mm256_loadu_ps(y+i), pz = _mm256_loadu_ps(z+i);
+		_mm256_storeu_ps(outX+i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, r[0]), _mm256_mul_ps(py, r[1])), _mm256_mul_ps(pz, r[2])), r[3]));
+		_mm256_storeu_ps(outY+i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, r[4]), _mm256_mul_ps(py, r[5])), _mm256_mul_ps(pz, r[6])), r[7]));
+		_mm256_storeu_ps(outZ+i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, r[8]), _mm256_mul_ps(py, r[9])), _mm256_mul_ps(pz, r[10])), r[11]));
+	}
+	transformPointsScalar(m, x+i, y+i, z+i, outX+i, outY+i, outZ+i, n-i);
+}
+
+#else
+
+int depthToPointCloudSSE(const TIntrinsics* intr, const short* data, TPointCloud* cloud){
+	return depthToPointCloudScalar(intr, data, cloud);
+}
+
+int depthToPointCloudAVX2(const TIntrinsics* intr, const short* data, TPointCloud* cloud){
+	return depthToPointCloudScalar(intr, data, cloud);
+}
+
+#endif
+
+/**
+ * Sets the kernels of depthToPointCloud and transformPoints, without checking that the CPU supports them.
+ *
+ * @param Kernel (DENSESCALAR, DENSESSE or DENSEAVX2)
+ */
+static void selectDenseKernel(int kernel){
+	denseKernel = depthToPointCloudScalar;
+	denseKernelName = "scalar";
+	transformKernel = transformPointsScalar;
+#ifdef DENSESIMD
+	if(kernel == DENSEAVX2){
+		denseKernel = depthToPointCloudAVX2;
+		denseKernelName = "avx2";
+		transformKernel = transformPointsAVX2;
+	}else if(kernel == DENSESSE){
+		denseKernel = depthToPointCloudSSE;
+		denseKernelName = "sse4.1";
+		transformKernel = transformPointsSSE;
+	}
+#endif
+}
+
+/**
+ * Builds the permutation tables and selects the fastest kernel supported by the CPU.
+ */
+static void initDenseKernel(){
+#ifdef DENSESIMD
+	int mask, i, j;
+	for(mask=0; mask<256; mask++){
+		j = 0;
+		for(i=0; i<8; i++){
+			if(mask & (1<<i)){ compress8[mask][j++] = i; }
+		}
+		for(; j<8; j++){ compress8[mask][j] = 0; }
+	}
+	for(mask=0; mask<16; mask++){
+		j = 0;
+		for(i=0; i<4; i++){
+			if(mask & (1<<i)){
+				compress4[mask][4*j] = 4*i;
+				compress4[mask][4*j+1] = 4*i+1;
+				compress4[mask][4*j+2] = 4*i+2;
+				compress4[mask][4*j+3] = 4*i+3;
+				j++;
+			}
+		}
+		for(; j<4; j++){
+			compress4[mask][4*j] = compress4[mask][4*j+1] = compress4[mask][4*j+2] = compress4[mask][4*j+3] = -1;
+		}
+	}
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")){
+		denseFastest = DENSEAVX2;
+	}else if(__builtin_cpu_supports("sse4.1")){
+		denseFastest = DENSESSE;
+	}
+#endif
+	selectDenseKernel(denseFastest);
+}
+
+/**
+ * Converts every pixel of a depth map into 3D coordinates and keeps the points
+ * whose depth is between minDepth and maxDepth and which are above the floor and below the ceiling of getDetectionParams.
+ * The fastest kernel supported by the CPU is used, all kernels give identical results.
+ * Returns the number of points kept.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud, with a capacity of at least DEPTHSIZE
+ */
+int depthToPointCloud(const TIntrinsics* intr, const short* data, TPointCloud* cloud){
+	pthread_once(&denseKernelOnce, initDenseKernel);
+	return denseKernel(intr, data, cloud);
+}
+
+/**
+ * Applies the affine part of a transformation matrix (its first 3 rows) to points stored as a structure of arrays.
+ * The output arrays may be the input arrays. The fastest kernel supported by the CPU is used.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the x coordinates
+ * @param Pointer to the y coordinates
+ * @param Pointer to the z coordinates
+ * @param Pointer to the transformed x coordinates
+ * @param Pointer to the transformed y coordinates
+ * @param Pointer to the transformed z coordinates
+ * @param Number of points
+ */
+void transformPoints(const TMatrix4D* m, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, int n){
+	pthread_once(&denseKernelOnce, initDenseKernel);
+	transformKernel(m, x, y, z, outX, outY, outZ, n);
+}
+
+/**
+ * Applies the affine part of a transformation matrix to every point of a point cloud.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the point cloud
+ */
+void transformPointCloud(const TMatrix4D* m, TPointCloud* cloud){
+	transformPoints(m, cloud->x, cloud->y, cloud->z, cloud->x, cloud->y, cloud->z, cloud->n);
+}
+
+/**
+ * Applies the affine part of a transformation matrix to every vector of a vector list.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the vector list
+ */
+void transformVecList(const TMatrix4D* m, TVecList* list){
+	float x[MAXVECTORS], y[MAXVECTORS], z[MAXVECTORS];
+	int i;
+	for(i=0; i<list->n; i++){
+		x[i] = list->vector[i].x;
+		y[i] = list->vector[i].y;
+		z[i] = list->vector[i].z;
+	}
+	transformPoints(m, x, y, z, x, y, z, list->n);
+	for(i=0; i<list->n; i++){
+		list->vector[i].x = x[i];
+		list->vector[i].y = y[i];
+		list->vector[i].z = z[i];
+	}
+}
+
+/**
+ * Returns the name of the kernel used by depthToPointCloud ("avx2", "sse4.1" or "scalar").
+ */
+const char* pointCloudKernelName(){
+	pthread_once(&denseKernelOnce, initDenseKernel);
+	return denseKernelName;
+}
+
+/**
+ * Forces the kernel used by depthToPointCloud and transformPoints, to compare the kernels.
+ * Must not be called while another thread converts or transforms points.
+ * Returns 0 if the operation is a success and 1 if the CPU does not support the kernel.
+ *
+ * @param Kernel (DENSESCALAR, DENSESSE or DENSEAVX2), DENSEFASTEST for the fastest kernel supported by the CPU
+ */
+int setPointCloudKernel(int kernel){
+	pthread_once(&denseKernelOnce, initDenseKernel);
+	if(kernel == DENSEFASTEST){ kernel = denseFastest; }
+	//the kernels are ordered, each CPU supporting one also supports the previous ones
+	if(kernel < DENSESCALAR || kernel > denseFastest){ return 1; }
+	selectDenseKernel(kernel);
+	return 0;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "kinectDetectionUtil.h"
+
+///kernels of depthToPointCloud and transformPoints
+#define DENSEFASTEST -1
+#define DENSESCALAR 0
+#define DENSESSE 1
+#define DENSEAVX2 2
+#define NBDENSEKERNELS 3
+
+/// Structure containing a point cloud stored as a structure of arrays.
+/// The arrays have room for capacity points plus a margin used by the vectorized kernels.
+typedef struct{
+	float* x;
+	float* y;
+	float* z;
+	int n;
+	int capacity;
+}TPointCloud;
+
+
+/**
+ * Allocates a point cloud.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the point cloud
+ * @param Maximum number of points
+ */
+int createPointCloud(TPointCloud* cloud, int capacity);
+
+/**
+ * Frees a point cloud.
+ *
+ * @param Pointer to the point cloud
+ */
+void freePointCloud(TPointCloud* cloud);
+
+/**
+ * Converts every pixel of a depth map into 3D coordinates and keeps the points
+ * whose depth is between minDepth and maxDepth and which are above the floor and below the ceiling of getDetectionParams.
+ * The fastest kernel supported by the CPU is used, all kernels give identical results.
+ * Returns the number of points kept.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud, with a capacity of at least DEPTHSIZE
+ */
+int depthToPointCloud(const TIntrinsics* intr, const short* data, TPointCloud* cloud);
+
+/**
+ * Same as depthToPointCloud, one pixel at a time.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud, with a capacity of at least DEPTHSIZE
+ */
+int depthToPointCloudScalar(const TIntrinsics* intr, const short* data, TPointCloud* cloud);
+
+/**
+ * Same as depthToPointCloud, 4 pixels at a time with SSE4.1.
+ * Must only be called if the CPU supports SSE4.1.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud, with a capacity of at least DEPTHSIZE
+ */
+int depthToPointCloudSSE(const TIntrinsics* intr, const short* data, TPointCloud* cloud);
+
+/**
+ * Same as depthToPointCloud, 8 pixels at a time with AVX2.
+ * Must only be called if the CPU supports AVX2.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud, with a capacity of at least DEPTHSIZE
+ */
+int depthToPointCloudAVX2(const TIntrinsics* intr, const short* data, TPointCloud* cloud);
+
+/**
+ * Applies the affine part of a transformation matrix (its first 3 rows) to points stored as a structure of arrays.
+ * The output arrays may be the input arrays. The fastest kernel supported by the CPU is used.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the x coordinates
+ * @param Pointer to the y coordinates
+ * @param Pointer to the z coordinates
+ * @param Pointer to the transformed x coordinates
+ * @param Pointer to the transformed y coordinates
+ * @param Pointer to the transformed z coordinates
+ * @param Number of points
+ */
+void transformPoints(const TMatrix4D* m, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, int n);
+
+/**
+ * Applies the affine part of a transformation matrix to every point of a point cloud.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the point cloud
+ */
+void transformPointCloud(const TMatrix4D* m, TPointCloud* cloud);
+
+/**
+ * Applies the affine part of a transformation matrix to every vector of a vector list.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the vector list
+ */
+void transformVecList(const TMatrix4D* m, TVecList* list);
+
+/**
+ * Returns the name of the kernel used by depthToPointCloud ("avx2", "sse4.1" or "scalar").
+ */
+const char* pointCloudKernelName();
+
+/**
+ * Forces the kernel used by depthToPointCloud and transformPoints, to compare the kernels.
+ * Must not be called while another thread converts or transforms points.
+ * Returns 0 if the operation is a success and 1 if the CPU does not support the kernel.
+ *
+ * @param Kernel (DENSESCALAR, DENSESSE or DENSEAVX2), DENSEFASTEST for the fastest kernel supported by the CPU
+ */
+int setPointCloudKernel(int kernel);
@@ -1,15 +1,52 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
-#include <libfreenect_sync.h>
+#include <pthread.h>
+#include <limits.h>
+#include <time.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sched.h>
 #include "kinectDetectionUtil.h"
+#include "kinectCluster.h"
+#include "kinectMatrix.h"
 
 ///global variables
 int nbIterations = 4000;
 int minDepth = 400;
 int maxDepth = 6000;
-int minZ = -1000;
-int maxZ = 1000;
+TPlane floorPlane = {0, 0, 1, 1000};
+TPlane ceilingPlane = {0, 0, -1, 1000};
+float clusterTolerance = 300;
+float fusionTolerance = 200;
+int samplingMode = SAMPLINGRANDOM;
+
+///names of the sampling modes
+static const char* samplingNames[NBSAMPLINGMODES] = {"random", "stratified", "halton", "strided"};
+
+/// Structure generating the pixels sampled in a rectangle of a depth map.
+/// Stratified and strided modes divide the rectangle in a grid of cellsX x cellsY cells with one sample per cell,
+/// samples beyond the grid are random. The offset shifts the Halton and strided patterns at each depth map.
+typedef struct{
+	int mode;
+	int x0, y0, width, height;
+	int cellsX, cellsY;
+	float offsetX, offsetY;
+	TRandom* random;
+}TSampler;
+
+///parameters published by setDetectionParams, stored as atomic words and guarded by a sequence number
+///which is 0 until the first publication and odd while they are written
+#define PARAMWORDS (sizeof(TDetectionParams)/sizeof(unsigned int))
+_Static_assert(sizeof(TDetectionParams) == PARAMWORDS*sizeof(unsigned int), "parameters must be made of 32 bit words");
+static atomic_uint paramWords[PARAMWORDS];
+static atomic_uint paramSequence = 0;
+static pthread_mutex_t paramLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int paramVersion = 0;
+
+///intrinsic parameters of the Kinect
+static TIntrinsics defaultIntrinsics;
+static pthread_once_t defaultIntrinsicsOnce = PTHREAD_ONCE_INIT;
 
 /**
  * Converts a given depth pixel into 3D coordinates.
@@ -30,6 +67,111 @@ void vec4DFromDepth(TVec4D* vec, float xs, float ys, float depth){
 	vec->w = 1;
 }
 
+/**
+ * Computes the intrinsic parameters of a Kinect.
+ *
+ * @param Pointer to the intrinsic parameters
+ */
+void initKinectIntrinsics(TIntrinsics* intr){
+	int i;
+	for(i=0; i<DEPTHWIDTH; i++){
+		intr->rayX[i] = (i-320)*0.00169673656;
+	}
+	for(i=0; i<DEPTHHEIGHT; i++){
+		intr->rayZ[i] = (240-i)*0.00164129365;
+	}
+	intr->depthOffset = 280;
+	intr->centerX = 320;
+	intr->centerY = 240;
+	intr->scaleX = 0.00169673656;
+	intr->scaleZ = 0.00164129365;
+}
+
+/**
+ * Computes the intrinsic parameters returned by kinectIntrinsics.
+ */
+static void initDefaultIntrinsics(){
+	initKinectIntrinsics(&defaultIntrinsics);
+}
+
+/**
+ * Returns the intrinsic parameters of a Kinect, computed on the first call.
+ */
+const TIntrinsics* kinectIntrinsics(){
+	pthread_once(&defaultIntrinsicsOnce, initDefaultIntrinsics);
+	return &defaultIntrinsics;
+}
+
+/**
+ * Converts a given depth pixel into 3D coordinates using precomputed intrinsic parameters.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the vector
+ * @param x coordinate on the depth map
+ * @param y coordinate on the depth map
+ * @param Depth value on the depth map
+ */
+void vec4DFromRay(const TIntrinsics* intr, TVec4D* vec, int xs, int ys, float depth){
+	depth += intr->depthOffset;
+	vec->x = depth*intr->rayX[xs];
+	vec->y = depth;
+	vec->z = depth*intr->rayZ[ys];
+	vec->w = 1;
+}
+
+/**
+ * Projects 3D coordinates on the depth map.
+ * Returns 0 if the operation is a success and 1 if the vector is behind the camera.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the vector
+ * @param Pointer to the x coordinate on the depth map
+ * @param Pointer to the y coordinate on the depth map
+ */
+int vec4DToPixel(const TIntrinsics* intr, const TVec4D* vec, float* xs, float* ys){
+	if(vec->y <= 0){ return 1; }
+	*xs = intr->centerX + vec->x/(vec->y*intr->scaleX);
+	*ys = intr->centerY - vec->z/(vec->y*intr->scaleZ);
+	return 0;
+}
+
+/**
+ * Converts a row of a depth map into 3D coordinates.
+ * The point buffer must have room for DEPTHWIDTH vectors.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param y coordinate of the row
+ * @param Pointer to the point buffer
+ */
+void depthRowToPoints(const TIntrinsics* intr, const short* data, int ys, TVec4D* points){
+	const short* row = data + ys*DEPTHWIDTH;
+	float rayZ = intr->rayZ[ys];
+	int xs;
+	for(xs=0; xs<DEPTHWIDTH; xs++){
+		float depth = row[xs] + intr->depthOffset;
+		points[xs].x = depth*intr->rayX[xs];
+		points[xs].y = depth;
+		points[xs].z = depth*rayZ;
+		points[xs].w = 1;
+	}
+}
+
+/**
+ * Converts a whole depth map into 3D coordinates.
+ * The point buffer must have room for DEPTHSIZE vectors.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param Pointer to the point buffer
+ */
+void depthFrameToPoints(const TIntrinsics* intr, const short* data, TVec4D* points){
+	int ys;
+	for(ys=0; ys<DEPTHHEIGHT; ys++){
+		depthRowToPoints(intr, data, ys, points + ys*DEPTHWIDTH);
+	}
+}
+
 /**
  * Returns the distance between 2 vectors only taking into account the x and y coordinates.
  *
@@ -68,26 +210,132 @@ float vecHeightDifference(const TVec4D* v1, const TVec4D* v2){
     return v1->z>=v2->z? v1->z-v2->z : v2->z-v1->z;
 }
 
+/**
+ * Returns the signed distance of a vector to a plane, positive on the side of its normal.
+ *
+ * @param Pointer to the plane
+ * @param Pointer to the vector
+ */
+float planeDistance(const TPlane* plane, const TVec4D* vec){
+	return plane->a*vec->x + plane->b*vec->y + plane->c*vec->z + plane->d;
+}
+
+/**
+ * Returns a plane in the base of a camera, given the plane in the base of camera 0 and the base of the camera
+ * (the transformation of its vectors to the base of camera 0). The normal keeps a unit length.
+ *
+ * @param Pointer to the plane in the base of camera 0
+ * @param Pointer to the base of the camera
+ */
+TPlane transformPlane(const TPlane* plane, const TMatrix4D* base){
+	//the distance of a vector v of the camera is the distance of base*v, so the plane is multiplied by the base
+	const float* m = base->m;
+	TPlane p;
+	p.a = plane->a*m[0] + plane->b*m[4] + plane->c*m[8] + plane->d*m[12];
+	p.b = plane->a*m[1] + plane->b*m[5] + plane->c*m[9] + plane->d*m[13];
+	p.c = plane->a*m[2] + plane->b*m[6] + plane->c*m[10] + plane->d*m[14];
+	p.d = plane->a*m[3] + plane->b*m[7] + plane->c*m[11] + plane->d*m[15];
+	float norm = sqrtf(p.a*p.a + p.b*p.b + p.c*p.c);
+	if(norm > 0){
+		p.a /= norm;
+		p.b /= norm;
+		p.c /= norm;
+		p.d /= norm;
+	}
+	return p;
+}
+
+/**
+ * Returns 1 if a vector is above the floor and below the ceiling, 0 otherwise.
+ *
+ * @param Pointer to the vector
+ */
+int inFlightArea(const TVec4D* vec){
+	return planeDistance(&floorPlane, vec) > 0 && planeDistance(&ceilingPlane, vec) > 0;
+}
+
+/**
+ * Sets horizontal floor and ceiling planes.
+ *
+ * @param Height of the floor
+ * @param Height of the ceiling
+ */
+void setFlightArea(float floor, float ceiling){
+	TPlane floorP = {0, 0, 1, -floor}, ceilingP = {0, 0, -1, ceiling};
+	floorPlane = floorP;
+	ceilingPlane = ceilingP;
+}
+
+/**
+ * Copies the parameters used by the detection for one depth map.
+ * Without published parameters, they are the global variables (nbIterations, minDepth, maxDepth, floorPlane,
+ * ceilingPlane, clusterTolerance and fusionTolerance). No lock is taken: the copy is made again if
+ * setDetectionParams changed the parameters meanwhile (sequence lock).
+ * Returns 1 if the parameters were published with setDetectionParams and 0 if they are the global variables.
+ *
+ * @param Pointer to the parameters
+ */
+int getDetectionParams(TDetectionParams* params){
+	unsigned int words[PARAMWORDS], sequence;
+	size_t i;
+	do{
+		sequence = atomic_load_explicit(&paramSequence, memory_order_acquire);
+		if(sequence & 1){
+			//a writer is in the middle of a publication
+			sched_yield();
+			continue;
+		}
+		for(i=0; i<PARAMWORDS; i++){
+			words[i] = atomic_load_explicit(&(paramWords[i]), memory_order_relaxed);
+		}
+		atomic_thread_fence(memory_order_acquire);
+	}while((sequence & 1) || atomic_load_explicit(&paramSequence, memory_order_relaxed) != sequence);
+	if(sequence != 0){
+		memcpy(params, words, sizeof(TDetectionParams));
+		return 1;
+	}
+	params->nbIterations = nbIterations;
+	params->minDepth = minDepth;
+	params->maxDepth = maxDepth;
+	params->floor = floorPlane;
+	params->ceiling = ceilingPlane;
+	params->clusterTolerance = clusterTolerance;
+	params->fusionTolerance = fusionTolerance;
+	params->version = 0;
+	return 0;
+}
+
+/**
+ * Publishes parameters of the detection, which replace the global variables for the following depth maps.
+ * The sequence number is odd while the parameters are written, so that readers never keep a partial copy.
+ *
+ * @param Pointer to the parameters, the version is ignored
+ */
+void setDetectionParams(const TDetectionParams* params){
+	TDetectionParams block = *params;
+	unsigned int words[PARAMWORDS];
+	size_t i;
+	pthread_mutex_lock(&paramLock);
+	block.version = ++paramVersion;
+	memcpy(words, &block, sizeof(block));
+	//odd while the words are written
+	unsigned int sequence = atomic_load_explicit(&paramSequence, memory_order_relaxed);
+	atomic_store_explicit(&paramSequence, sequence+1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	for(i=0; i<PARAMWORDS; i++){
+		atomic_store_explicit(&(paramWords[i]), words[i], memory_order_relaxed);
+	}
+	atomic_store_explicit(&paramSequence, sequence+2, memory_order_release);
+	pthread_mutex_unlock(&paramLock);
+}
+
 /**
  * Returns a new identity matrix.
  */
 TMatrix4D* matrix4DIdentity(){
-	//Allocation of space for the matrix
-	TMatrix4D* matr = NULL;
-	matr = malloc(sizeof(TMatrix4D));
+	TMatrix4D* matr = malloc(sizeof(TMatrix4D));
 	if(matr == NULL){ return NULL; }
-	//generating matrix
-	int i, j;
-	for(j=0; j<4; j++){
-		for(i=0; i<4; i++){
-			if(i==j){
-				matr->m[j*4+i] = 1;
-			}else{
-				matr->m[j*4+i] = 0;
-			}
-		}
-	}
-	//returning matrix
+	*matr = identityMatrix();
 	return matr;
 }
 
@@ -101,28 +349,9 @@ TMatrix4D* matrix4DIdentity(){
  * @param Angle of rotation in radians.
  */
 TMatrix4D* matrix4DTranslationRotationZ(float x, float y, float z, float angle){
-	//Allocation of space for the matrix
-	TMatrix4D* matr = NULL;
-	matr = malloc(sizeof(TMatrix4D));
+	TMatrix4D* matr = malloc(sizeof(TMatrix4D));
 	if(matr == NULL){ return NULL; }
-	//generating matrix
-	matr->m[0] = cos(angle);
-	matr->m[4] = sin(angle);
-	matr->m[8] = 0;
-	matr->m[12] = 0;
-	matr->m[1] = -matr->m[4];
-	matr->m[5] = matr->m[0];
-	matr->m[9] = 0;
-	matr->m[13] = 0;
-	matr->m[2] = 0;
-	matr->m[6] = 0;
-	matr->m[10] = 1;
-	matr->m[14] = 0;
-	matr->m[3] = x;
-	matr->m[7] = y;
-	matr->m[11] = z;
-	matr->m[15] = 1;
-	//returning matrix
+	*matr = translationRotationZMatrix(x, y, z, angle);
 	return matr;
 }
 
@@ -168,15 +397,7 @@ void matrix4DGetFromVectors(TMatrix4D* m, const TVec4D* vectors){
  * @param Pointer to the second matrix
  */
 void matrix4DMultiply(TMatrix4D* result, const TMatrix4D* m1, const TMatrix4D* m2){
-    int i, j, k;
-    for(i=0; i<4; i++){
-        for(j=0; j<4; j++){
-            result->m[i+j*4] = m1->m[j*4] * m2->m[i];
-            for(k=1; k<4; k++){
-                result->m[i+j*4] += m1->m[k+j*4] * m2->m[i+k*4];
-            }
-        }
-    }
+	*result = multiplyMatrix(m1, m2);
 }
 
 /**
@@ -204,32 +425,14 @@ float matrix4DCofactor(const TMatrix4D* m, int x, int y){
 }
 
 /**
- * Inverts a matrix.
- * Returns 0 if inversion is a success and 1 if inversion is not possible.
+ * Inverts a matrix, see invertMatrix.
+ * Returns 0 if inversion is a success and 1 if the matrix is singular or ill-conditioned.
  *
  * @param Pointer to the inverted matrix
  * @param Pointer to the matrix to invert
  */
 int matrix4DInvert(TMatrix4D* invert, const TMatrix4D* m){
-    int i, j;
-    float det = 0;
-	for(i=0; i<4; i++){
-		for(j=0;j<4; j++){
-			int s;
-			if((i+j)%2 == 0){ s=1; }else{ s=-1; }
-			invert->m[j+4*i] = s*matrix4DCofactor(m, i, j);
-		}
-        det += m->m[i]*invert->m[4*i];
-	}
-	if(det == 0){
-        return 1;
-	}
-	for(i=0; i<4; i++){
-		for(j=0;j<4; j++){
-			invert->m[i+4*j] /= det;
-		}
-	}
-	return 0;
+	return invertMatrix(invert, m);
 }
 
 /**
@@ -242,6 +445,7 @@ int matrix4DInvert(TMatrix4D* invert, const TMatrix4D* m){
 void createPrimaryCamera(TDepthCamera* pCamera, int id){
 	pCamera->id = id;
 	pCamera->base = matrix4DIdentity();
+	openKinectSource(&(pCamera->source), id);
 }
 
 /**
@@ -258,6 +462,19 @@ void createPrimaryCamera(TDepthCamera* pCamera, int id){
 void createSecondaryCamera(TDepthCamera* pCamera, int id, float x, float y, float z, float angle){
 	pCamera->id = id;
 	pCamera->base = matrix4DTranslationRotationZ(x, y, z, angle);
+	openKinectSource(&(pCamera->source), id);
+}
+
+/**
+ * Replaces the source giving the depth maps of a camera.
+ * The previous source is closed.
+ *
+ * @param Pointer to the camera
+ * @param Pointer to the new source
+ */
+void setCameraSource(TDepthCamera* pCamera, const TFrameSource* pSource){
+	closeFrameSource(&(pCamera->source));
+	pCamera->source = *pSource;
 }
 
 /**
@@ -267,17 +484,69 @@ void createSecondaryCamera(TDepthCamera* pCamera, int id, float x, float y, floa
  * @param Pointer to the time stamp
  */
 int updateCamera(TDepthCamera* pCamera, unsigned int* timestamp){
-	return freenect_sync_get_depth((void**)(&(pCamera->data)), timestamp, pCamera->id, FREENECT_DEPTH_REGISTERED);
+	return pCamera->source.grab(&(pCamera->source), &(pCamera->data), timestamp);
 }
 
 /**
  * Frees a camera.
- * Well actually, it only frees the base matrix if the camera.
+ * Well actually, it only frees the base matrix and closes the source of the camera.
  *
  * @param Pointer to the camera
  */
 void freeCamera(TDepthCamera* pCamera){
 	free(pCamera->base);
+	closeFrameSource(&(pCamera->source));
+}
+
+/**
+ * Reads the floor, the ceiling and the transformation matrices of the secondary cameras written by the calibration program.
+ * The matrices are given in the order of the cameras, starting with camera 1.
+ * Files of former versions, with the heights of the floor and the ceiling instead of planes, are also read.
+ * Returns the number of matrices read, or -1 if the file cannot be read.
+ *
+ * @param Name of the calibration file
+ * @param Pointer to the matrices
+ * @param Maximum number of matrices
+ */
+int readCalibration(const char* fileName, TMatrix4D* bases, int maxBases){
+	FILE* pFile = fopen(fileName, "r");
+	if(pFile == NULL){ return -1; }
+	//the size of the file tells its version, matrices follow 2 heights or 2 planes
+	fseek(pFile, 0, SEEK_END);
+	long size = ftell(pFile);
+	rewind(pFile);
+	int heights[2];
+	if(size >= (long)sizeof(heights) && (size - sizeof(heights))%sizeof(TMatrix4D) == 0){
+		if(fread(heights, sizeof(int), 2, pFile) != 2){
+			fclose(pFile);
+			return -1;
+		}
+		setFlightArea(heights[0], heights[1]);
+	}else if(fread(&floorPlane, sizeof(TPlane), 1, pFile) != 1 || fread(&ceilingPlane, sizeof(TPlane), 1, pFile) != 1){
+		fclose(pFile);
+		return -1;
+	}
+	//one matrix per secondary camera, until the end of the file
+	int n = fread(bases, sizeof(TMatrix4D), maxBases, pFile);
+	fclose(pFile);
+	return n;
+}
+
+/**
+ * Writes the floor and ceiling planes and the transformation matrices of the secondary cameras.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Name of the calibration file
+ * @param Pointer to the matrices
+ * @param Number of matrices
+ */
+int writeCalibration(const char* fileName, const TMatrix4D* bases, int nbBases){
+	FILE* pFile = fopen(fileName, "w");
+	if(pFile == NULL){ return 1; }
+	int ret = fwrite(&floorPlane, sizeof(TPlane), 1, pFile) != 1 || fwrite(&ceilingPlane, sizeof(TPlane), 1, pFile) != 1;
+	if(nbBases > 0 && fwrite(bases, sizeof(TMatrix4D), nbBases, pFile) != nbBases){ ret = 1; }
+	if(fclose(pFile)){ ret = 1; }
+	return ret;
 }
 
 /**
@@ -382,9 +651,172 @@ TVec4D* maxPointList(TVecList* list){
     return &(list->vector[maxId]);
 }
 
+/**
+ * Initializes a pseudo-random number generator.
+ * Generators with different streams give independent numbers with the same seed.
+ *
+ * @param Pointer to the generator
+ * @param Seed of the generator
+ * @param Stream of the generator, the camera id for example
+ */
+void seedRandom(TRandom* random, uint64_t seed, uint64_t stream){
+	random->state = 0;
+	random->inc = (stream << 1) | 1;
+	nextRandom(random);
+	random->state += seed;
+	nextRandom(random);
+}
+
+/**
+ * Returns the next 32 bit pseudo-random number of a generator.
+ *
+ * @param Pointer to the generator
+ */
+uint32_t nextRandom(TRandom* random){
+	uint64_t old = random->state;
+	random->state = old*6364136223846793005ULL + random->inc;
+	//permutation of the old state: xorshift then random rotation
+	uint32_t shifted = ((old >> 18) ^ old) >> 27;
+	uint32_t rot = old >> 59;
+	return (shifted >> rot) | (shifted << ((-rot) & 31));
+}
+
+/**
+ * Returns a pseudo-random number between 0 and range-1, without bias.
+ *
+ * @param Pointer to the generator
+ * @param Number of possible values, at least 1
+ */
+uint32_t randomRange(TRandom* random, uint32_t range){
+	//multiply and keep the high bits, reject the few low values giving a bias
+	uint64_t m = (uint64_t)nextRandom(random)*range;
+	uint32_t low = m;
+	if(low < range){
+		uint32_t threshold = -range % range;
+		while(low < threshold){
+			m = (uint64_t)nextRandom(random)*range;
+			low = m;
+		}
+	}
+	return m >> 32;
+}
+
+/**
+ * Returns the name of a sampling mode ("random", "stratified", "halton" or "strided").
+ *
+ * @param Sampling mode
+ */
+const char* samplingModeName(int mode){
+	if(mode < 0 || mode >= NBSAMPLINGMODES){ return "unknown"; }
+	return samplingNames[mode];
+}
+
+/**
+ * Returns the sampling mode with a given name, or -1 if there is none.
+ *
+ * @param Name of the sampling mode
+ */
+int samplingModeFromName(const char* name){
+	int mode;
+	for(mode=0; mode<NBSAMPLINGMODES; mode++){
+		if(strcmp(name, samplingNames[mode]) == 0){ return mode; }
+	}
+	return -1;
+}
+
+/**
+ * Returns a pseudo-random number between 0 and 1 excluded.
+ *
+ * @param Pointer to the generator
+ */
+static float randomUnit(TRandom* random){
+	return (nextRandom(random) >> 8)*(1.0f/16777216);
+}
+
+/**
+ * Returns the k-th element of the van der Corput sequence in a given base.
+ *
+ * @param Index of the element
+ * @param Base of the sequence
+ */
+static float radicalInverse(unsigned int k, unsigned int base){
+	float inv = 1.0f/base, f = inv, r = 0;
+	while(k){
+		r += (k%base)*f;
+		k /= base;
+		f *= inv;
+	}
+	return r;
+}
+
+/**
+ * Prepares the sampling of a rectangle of a depth map.
+ *
+ * @param Pointer to the sampler
+ * @param Sampling mode
+ * @param Left column of the rectangle
+ * @param Top row of the rectangle
+ * @param Column after the right of the rectangle
+ * @param Row after the bottom of the rectangle
+ * @param Number of samples
+ * @param Pointer to the pseudo-random number generator
+ */
+static void initSampler(TSampler* sampler, int mode, int x0, int y0, int x1, int y1, int n, TRandom* random){
+	sampler->mode = mode;
+	sampler->x0 = x0;
+	sampler->y0 = y0;
+	sampler->width = x1 - x0;
+	sampler->height = y1 - y0;
+	sampler->random = random;
+	//grid with cells as square as possible
+	sampler->cellsX = sqrt((float)n*sampler->width/sampler->height) + 0.5;
+	if(sampler->cellsX < 1){ sampler->cellsX = 1; }
+	if(sampler->cellsX > sampler->width){ sampler->cellsX = sampler->width; }
+	sampler->cellsY = n/sampler->cellsX;
+	if(sampler->cellsY < 1){ sampler->cellsY = 1; }
+	if(sampler->cellsY > sampler->height){ sampler->cellsY = sampler->height; }
+	sampler->offsetX = (mode == SAMPLINGRANDOM)? 0 : randomUnit(random);
+	sampler->offsetY = (mode == SAMPLINGRANDOM)? 0 : randomUnit(random);
+}
+
+/**
+ * Gives the pixel of the k-th sample of a rectangle.
+ *
+ * @param Pointer to the sampler
+ * @param Index of the sample
+ * @param Pointer to the column of the pixel
+ * @param Pointer to the row of the pixel
+ */
+static void samplePixel(TSampler* sampler, int k, int* xs, int* ys){
+	float u, v;
+	if(sampler->mode == SAMPLINGHALTON){
+		u = radicalInverse(k+1, 2) + sampler->offsetX;
+		v = radicalInverse(k+1, 3) + sampler->offsetY;
+		if(u >= 1){ u -= 1; }
+		if(v >= 1){ v -= 1; }
+	}else if((sampler->mode == SAMPLINGSTRATIFIED || sampler->mode == SAMPLINGSTRIDED) && k < sampler->cellsX*sampler->cellsY){
+		float jitterX = sampler->offsetX, jitterY = sampler->offsetY;
+		if(sampler->mode == SAMPLINGSTRATIFIED){
+			jitterX = randomUnit(sampler->random);
+			jitterY = randomUnit(sampler->random);
+		}
+		u = (k%sampler->cellsX + jitterX)/sampler->cellsX;
+		v = (k/sampler->cellsX + jitterY)/sampler->cellsY;
+	}else{
+		*xs = sampler->x0 + randomRange(sampler->random, sampler->width);
+		*ys = sampler->y0 + randomRange(sampler->random, sampler->height);
+		return;
+	}
+	*xs = sampler->x0 + (int)(u*sampler->width);
+	*ys = sampler->y0 + (int)(v*sampler->height);
+	if(*xs >= sampler->x0 + sampler->width){ *xs = sampler->x0 + sampler->width - 1; }
+	if(*ys >= sampler->y0 + sampler->height){ *ys = sampler->y0 + sampler->height - 1; }
+}
+
 /**
  * Processes a depth map to generate a list of vectors.
- * The number of iterations can be changed with the global variable nbIterations.
+ * The number of iterations can be changed with the global variable nbIterations, or with setDetectionParams.
+ * With the distance functions above, vectors are clustered with a hash grid and the heaviest clusters are kept.
  * Returns 0 if the operation is a success and 1 in case of a failure.
  *
  * @param Pointer to the depth map
@@ -392,26 +824,101 @@ TVec4D* maxPointList(TVecList* list){
  * @param Function used to determine the distance between two vectors
  */
 int detectDrone(short* data, TVecList* list, float vecDistance(const TVec4D*, const TVec4D*)){
+    return detectDroneWindow(data, list, vecDistance, NULL, NULL, NULL);
+}
+
+/**
+ * Same as detectDrone, with part of the samples taken in a window of the depth map.
+ * Without a window, samples are taken in the whole depth map. The window may also set the number of samples,
+ * and the base of the camera used to convert the floor and the ceiling.
+ * Without a generator, a generator of the calling thread seeded with the time is used.
+ * A cluster grid kept by the caller is reset and reused, without it a grid is allocated for the call.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the depth map
+ * @param Pointer to the vector list
+ * @param Function used to determine the distance between two vectors
+ * @param Pointer to the sampling window, NULL for none
+ * @param Pointer to the pseudo-random number generator, NULL for the default one
+ * @param Pointer to the cluster grid, NULL for a grid allocated for the call
+ */
+int detectDroneWindow(short* data, TVecList* list, float vecDistance(const TVec4D*, const TVec4D*), const TSamplingWindow* window, TRandom* random, TClusterGrid* grid){
     //if data or list missing, error
     if(data == NULL || list == NULL){ return 1; }
     //reset vector list
     resetVecList(list);
+    if(random == NULL){
+        //default generator, seeded once per thread
+        static _Thread_local TRandom threadRandom;
+        static _Thread_local int seeded = 0;
+        if(!seeded){
+            seedRandom(&threadRandom, time(NULL), (uintptr_t)&threadRandom);
+            seeded = 1;
+        }
+        random = &threadRandom;
+    }
+    const TIntrinsics* intr = kinectIntrinsics();
     TVec4D tmpVector;
-    int i;
-    for(i=0; i<nbIterations; i++){
-        //for each random pixel
-        int pixelPos = rand()%(640*480);
+    TDetectionParams params;
+    int i, nbWindow = 0;
+    getDetectionParams(&params);
+    if(window != NULL && window->nbSamples > 0){
+        params.nbIterations = window->nbSamples;
+    }
+    //floor and ceiling in the base of the camera
+    if(window != NULL && window->base != NULL){
+        params.floor = transformPlane(&(params.floor), window->base);
+        params.ceiling = transformPlane(&(params.ceiling), window->base);
+    }
+    if(window != NULL && window->x1 > window->x0 && window->y1 > window->y0){
+        nbWindow = params.nbIterations*window->ratio;
+    }
+    //samplers of the window and of the whole depth map
+    TSampler windowSampler, frameSampler;
+    if(nbWindow > 0){
+        initSampler(&windowSampler, samplingMode, window->x0, window->y0, window->x1, window->y1, nbWindow, random);
+    }
+    initSampler(&frameSampler, samplingMode, 0, 0, DEPTHWIDTH, DEPTHHEIGHT, params.nbIterations - nbWindow, random);
+    //cluster with a hash grid if the distance function is known
+    TClusterGrid callGrid;
+    int axes = clusterAxes(vecDistance);
+    if(axes && grid == NULL){
+        if(createClusterGrid(&callGrid, params.clusterTolerance, axes, 64)){ axes = 0; }
+        grid = &callGrid;
+    }else if(axes){
+        //the tolerance may have changed since the previous call
+        grid->tolerance = params.clusterTolerance;
+        grid->axes = axes;
+        resetClusterGrid(grid);
+    }
+    for(i=0; i<params.nbIterations; i++){
+        //for each sampled pixel, in the window first
+        int xs, ys;
+        if(i < nbWindow){
+            samplePixel(&windowSampler, i, &xs, &ys);
+        }else{
+            samplePixel(&frameSampler, i - nbWindow, &xs, &ys);
+        }
+        int pixelPos = ys*DEPTHWIDTH + xs;
         //if the depth at that pixel between min and max...
-        if(data[pixelPos]>minDepth && data[pixelPos]<maxDepth){
+        if(data[pixelPos]>params.minDepth && data[pixelPos]<params.maxDepth){
             //convert to a vector
-            vec4DFromDepth(&tmpVector, pixelPos%640, pixelPos/640, data[pixelPos]);
-            //if the z component is between a min and max...
-            if(tmpVector.z > minZ && tmpVector.z < maxZ){
+            vec4DFromRay(intr, &tmpVector, xs, ys, data[pixelPos]);
+            //if the vector is between the floor and the ceiling...
+            if(planeDistance(&(params.floor), &tmpVector) > 0 && planeDistance(&(params.ceiling), &tmpVector) > 0){
                 //add vector to list
-                addVecToList(list, &tmpVector, 1, 300, vecDistance);
+                if(axes){
+                    addToClusterGrid(grid, tmpVector.x, tmpVector.y, tmpVector.z, 1);
+                }else{
+                    addVecToList(list, &tmpVector, 1, params.clusterTolerance, vecDistance);
+                }
             }
         }
     }
+    if(axes){
+        clusterGridToVecList(grid, list);
+        if(grid == &callGrid){ freeClusterGrid(&callGrid); }
+    }
     //no problem
     return 0;
 }
@@ -481,17 +988,45 @@ int __simplifyPointList(TVecList* list, float tolerance, float vecDistance(const
 }
 
 /**
- * Applies the function __simplifyPointList until no more fusions are possible.
+ * Fuses vectors within a same list if they are close enough, until no more fusions are possible.
+ * With the distance functions above, all close vectors are joined in a single pass (see mergeClusters),
+ * otherwise the function __simplifyPointList is applied until no more fusions are possible.
+ * Returns 1 if vectors were fused and 0 otherwise.
  *
  * @param Pointer to the vector list
  * @param Tolerance for fusing two vectors
  * @param Function used to determine the distance between two vectors
  */
 int simplifyPointList(TVecList* list, float tolerance, float vecDistance(const TVec4D*, const TVec4D*)){
-    int ret = 0;
-    do{
-        ret = __simplifyPointList(list, tolerance, vecDistance);
-    }while(ret == 1);
+    int i, n, ret = 0;
+    int axes = clusterAxes(vecDistance);
+    if(axes){
+        //single pass merge
+        TCluster clusters[MAXVECTORS];
+        for(i=0; i<list->n; i++){
+            clusters[i].x = list->vector[i].x;
+            clusters[i].y = list->vector[i].y;
+            clusters[i].z = list->vector[i].z;
+            clusters[i].weight = list->weight[i];
+        }
+        n = mergeClusters(clusters, list->n, tolerance, axes);
+        if(n != -1){
+            for(i=0; i<n; i++){
+                list->vector[i].x = clusters[i].x;
+                list->vector[i].y = clusters[i].y;
+                list->vector[i].z = clusters[i].z;
+                list->vector[i].w = 1;
+                list->weight[i] = clusters[i].weight < SHRT_MAX? clusters[i].weight : SHRT_MAX;
+            }
+            ret = n < list->n;
+            list->n = n;
+            return ret;
+        }
+    }
+    while(__simplifyPointList(list, tolerance, vecDistance) == 1){
+        ret = 1;
+    }
+    return ret;
 }
 
 /**
@@ -503,6 +1038,15 @@ void displayVec4(const TVec4D* v){
 	printf("x:%3.2f, y:%3.2f, z:%3.2f, w:%3.2f", v->x, v->y, v->z, v->w);
 }
 
+/**
+ * Displays the equation of a plane.
+ *
+ * @param Pointer to the plane
+ */
+void displayPlane(const TPlane* p){
+	printf("%.3fx %+.3fy %+.3fz %+.1f", p->a, p->b, p->c, p->d);
+}
+
 /**
  * Displays a matrix.
  *
@@ -1,26 +1,81 @@
 #pragma once
 
+#include <stdint.h>
+#include "kinectFrameSource.h"
+
 #define MAXVECTORS 16
+#define MAXCAMERAS 8
+#define DEPTHWIDTH 640
+#define DEPTHHEIGHT 480
+#define DEPTHSIZE (DEPTHWIDTH*DEPTHHEIGHT)
+
+///sampling modes of detectDrone
+#define SAMPLINGRANDOM 0
+#define SAMPLINGSTRATIFIED 1
+#define SAMPLINGHALTON 2
+#define SAMPLINGSTRIDED 3
+#define NBSAMPLINGMODES 4
 
 /// Structure for 4-dimension vectors.
 typedef struct{
 	float x, y, z, w;
 }TVec4D;
 
+/// Structure for planes, the signed distance of a point (x, y, z) to the plane is a*x + b*y + c*z + d.
+/// The normal (a, b, c) has a unit length and points towards the flight area.
+typedef struct{
+	float a, b, c, d;
+}TPlane;
+
 /// Structure for 4x4 matrices.
 typedef struct{
 	float m[16];
 }TMatrix4D;
 
+/// Structure containing the intrinsic parameters of a depth camera.
+/// The ray of pixel (xs, ys) is (rayX[xs], 1, rayZ[ys]).
+/// Multiplying it by the depth plus depthOffset gives the 3D coordinates of the pixel.
+/// The centre and the angle per pixel (scale) are used to project 3D coordinates back on the depth map.
+typedef struct{
+	float rayX[DEPTHWIDTH];
+	float rayZ[DEPTHHEIGHT];
+	float depthOffset;
+	float centerX, centerY;
+	float scaleX, scaleZ;
+}TIntrinsics;
+
+/// Structure describing where the samples of a depth map are taken.
+/// A ratio of the samples is taken in the window [x0, x1[ x [y0, y1[, the others in the whole depth map.
+/// The number of samples replaces the number of iterations of the parameters, 0 to keep it.
+/// The floor and the ceiling are given in the base of camera 0, they are converted with the base of the camera if any.
+typedef struct{
+	int x0, y0, x1, y1;
+	float ratio;
+	int nbSamples;
+	const TMatrix4D* base;
+}TSamplingWindow;
+
+/// Structure containing clusters indexed by a uniform 3D hash grid, defined in kinectCluster.h.
+typedef struct TClusterGrid TClusterGrid;
+
+/// Structure containing the state of a PCG32 pseudo-random number generator.
+/// Detection is reproducible with a generator seeded the same way.
+typedef struct{
+	uint64_t state;
+	uint64_t inc;
+}TRandom;
+
 /// Structure representing a Kinect.
 /// The id corresponds to the id of the Kinect.
 /// The base is a transformation to apply on vectors if necessary.
 /// The data contains the depth map if the camera.
 /// The depth is given in millimetres.
+/// The source gives the depth maps (a Kinect by default).
 typedef struct{
 	int id;
 	TMatrix4D* base;
 	short* data;
+	TFrameSource source;
 }TDepthCamera;
 
 /// Structure containing a list of vectors.
@@ -31,12 +86,29 @@ typedef struct{
 	int n;
 }TVecList;
 
+/// Structure containing the parameters of the detection which can be changed while it runs.
+/// The cluster tolerance fuses the samples of one depth map, the fusion tolerance the vectors of several cameras.
+/// The version is incremented by each setDetectionParams.
+typedef struct{
+	int nbIterations;
+	int minDepth;
+	int maxDepth;
+	TPlane floor;
+	TPlane ceiling;
+	float clusterTolerance;
+	float fusionTolerance;
+	unsigned int version;
+}TDetectionParams;
+
 ///global variables
 extern int nbIterations;
 extern int minDepth;
 extern int maxDepth;
-extern int minZ;
-extern int maxZ;
+extern TPlane floorPlane;
+extern TPlane ceilingPlane;
+extern float clusterTolerance;
+extern float fusionTolerance;
+extern int samplingMode;
 
 
 /**
@@ -49,6 +121,61 @@ extern int maxZ;
  */
 void vec4DFromDepth(TVec4D* vec, float xs, float ys, float depth);
 
+/**
+ * Computes the intrinsic parameters of a Kinect.
+ *
+ * @param Pointer to the intrinsic parameters
+ */
+void initKinectIntrinsics(TIntrinsics* intr);
+
+/**
+ * Returns the intrinsic parameters of a Kinect, computed on the first call.
+ */
+const TIntrinsics* kinectIntrinsics();
+
+/**
+ * Converts a given depth pixel into 3D coordinates using precomputed intrinsic parameters.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the vector
+ * @param x coordinate on the depth map
+ * @param y coordinate on the depth map
+ * @param Depth value on the depth map
+ */
+void vec4DFromRay(const TIntrinsics* intr, TVec4D* vec, int xs, int ys, float depth);
+
+/**
+ * Projects 3D coordinates on the depth map.
+ * Returns 0 if the operation is a success and 1 if the vector is behind the camera.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the vector
+ * @param Pointer to the x coordinate on the depth map
+ * @param Pointer to the y coordinate on the depth map
+ */
+int vec4DToPixel(const TIntrinsics* intr, const TVec4D* vec, float* xs, float* ys);
+
+/**
+ * Converts a row of a depth map into 3D coordinates.
+ * The point buffer must have room for DEPTHWIDTH vectors.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param y coordinate of the row
+ * @param Pointer to the point buffer
+ */
+void depthRowToPoints(const TIntrinsics* intr, const short* data, int ys, TVec4D* points);
+
+/**
+ * Converts a whole depth map into 3D coordinates.
+ * The point buffer must have room for DEPTHSIZE vectors.
+ *
+ * @param Pointer to the intrinsic parameters
+ * @param Pointer to the depth map
+ * @param Pointer to the point buffer
+ */
+void depthFrameToPoints(const TIntrinsics* intr, const short* data, TVec4D* points);
+
 /**
  * Returns the distance between 2 vectors only taking into account the x and y coordinates.
  *
@@ -74,6 +201,57 @@ float vec3DDistance(const TVec4D* v1, const TVec4D* v2);
  */
 float vecHeightDifference(const TVec4D* v1, const TVec4D* v2);
 
+/**
+ * Returns the signed distance of a vector to a plane, positive on the side of its normal.
+ *
+ * @param Pointer to the plane
+ * @param Pointer to the vector
+ */
+float planeDistance(const TPlane* plane, const TVec4D* vec);
+
+/**
+ * Returns a plane in the base of a camera, given the plane in the base of camera 0 and the base of the camera
+ * (the transformation of its vectors to the base of camera 0). The normal keeps a unit length.
+ *
+ * @param Pointer to the plane in the base of camera 0
+ * @param Pointer to the base of the camera
+ */
+TPlane transformPlane(const TPlane* plane, const TMatrix4D* base);
+
+/**
+ * Returns 1 if a vector is above the floor and below the ceiling, 0 otherwise.
+ *
+ * @param Pointer to the vector
+ */
+int inFlightArea(const TVec4D* vec);
+
+/**
+ * Sets horizontal floor and ceiling planes.
+ *
+ * @param Height of the floor
+ * @param Height of the ceiling
+ */
+void setFlightArea(float floor, float ceiling);
+
+/**
+ * Copies the parameters used by the detection for one depth map.
+ * Without published parameters, they are the global variables (nbIterations, minDepth, maxDepth, floorPlane,
+ * ceilingPlane, clusterTolerance and fusionTolerance). No lock is taken: the copy is made again if
+ * setDetectionParams changed the parameters meanwhile (sequence lock).
+ * Returns 1 if the parameters were published with setDetectionParams and 0 if they are the global variables.
+ *
+ * @param Pointer to the parameters
+ */
+int getDetectionParams(TDetectionParams* params);
+
+/**
+ * Publishes parameters of the detection, which replace the global variables for the following depth maps.
+ * The sequence number is odd while the parameters are written, so that readers never keep a partial copy.
+ *
+ * @param Pointer to the parameters, the version is ignored
+ */
+void setDetectionParams(const TDetectionParams* params);
+
 /**
  * Returns a new identity matrix.
  */
@@ -125,8 +303,8 @@ void matrix4DMultiply(TMatrix4D* result, const TMatrix4D* m1, const TMatrix4D* m
 float matrix4DCofactor(const TMatrix4D* m, int x, int y);
 
 /**
- * Inverts a matrix.
- * Returns 0 if inversion is a success and 1 if inversion is not possible.
+ * Inverts a matrix, see invertMatrix.
+ * Returns 0 if inversion is a success and 1 if the matrix is singular or ill-conditioned.
  *
  * @param Pointer to the inverted matrix
  * @param Pointer to the matrix to invert
@@ -155,6 +333,15 @@ void createPrimaryCamera(TDepthCamera* pCamera, int id);
  */
 void createSecondaryCamera(TDepthCamera* pCamera, int id, float x, float y, float z, float angle);
 
+/**
+ * Replaces the source giving the depth maps of a camera.
+ * The previous source is closed.
+ *
+ * @param Pointer to the camera
+ * @param Pointer to the new source
+ */
+void setCameraSource(TDepthCamera* pCamera, const TFrameSource* pSource);
+
 /**
  * Refreshes the depth map of a camera.
  *
@@ -165,12 +352,34 @@ int updateCamera(TDepthCamera* pCamera, unsigned int* timestamp);
 
 /**
  * Frees a camera.
- * Well actually, it only frees the base matrix if the camera.
+ * Well actually, it only frees the base matrix and closes the source of the camera.
  *
  * @param Pointer to the camera
  */
 void freeCamera(TDepthCamera* pCamera);
 
+/**
+ * Reads the floor, the ceiling and the transformation matrices of the secondary cameras written by the calibration program.
+ * The matrices are given in the order of the cameras, starting with camera 1.
+ * Files of former versions, with the heights of the floor and the ceiling instead of planes, are also read.
+ * Returns the number of matrices read, or -1 if the file cannot be read.
+ *
+ * @param Name of the calibration file
+ * @param Pointer to the matrices
+ * @param Maximum number of matrices
+ */
+int readCalibration(const char* fileName, TMatrix4D* bases, int maxBases);
+
+/**
+ * Writes the floor and ceiling planes and the transformation matrices of the secondary cameras.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Name of the calibration file
+ * @param Pointer to the matrices
+ * @param Number of matrices
+ */
+int writeCalibration(const char* fileName, const TMatrix4D* bases, int nbBases);
+
 /**
  * Empties a vector list and resets the weight of all vectors to 1.
  *
@@ -207,9 +416,53 @@ int getMaxVectorFromList(TVec4D* v, TVecList* list);
  */
 TVec4D* maxPointList(TVecList* list);
 
+/**
+ * Initializes a pseudo-random number generator.
+ * Generators with different streams give independent numbers with the same seed.
+ *
+ * @param Pointer to the generator
+ * @param Seed of the generator
+ * @param Stream of the generator, the camera id for example
+ */
+void seedRandom(TRandom* random, uint64_t seed, uint64_t stream);
+
+/**
+ * Returns the next 32 bit pseudo-random number of a generator.
+ *
+ * @param Pointer to the generator
+ */
+uint32_t nextRandom(TRandom* random);
+
+/**
+ * Returns a pseudo-random number between 0 and range-1, without bias.
+ *
+ * @param Pointer to the generator
+ * @param Number of possible values, at least 1
+ */
+uint32_t randomRange(TRandom* random, uint32_t range);
+
+/**
+ * Returns the name of a sampling mode ("random", "stratified", "halton" or "strided").
+ *
+ * @param Sampling mode
+ */
+const char* samplingModeName(int mode);
+
+/**
+ * Returns the sampling mode with a given name, or -1 if there is none.
+ *
+ * @param Name of the sampling mode
+ */
+int samplingModeFromName(const char* name);
+
 /**
  * Processes a depth map to generate a list of vectors.
- * The number of iterations can be changed with the global variable nbIterations.
+ * The number of iterations can be changed with the global variable nbIterations, or with setDetectionParams.
+ * The pixels are chosen according to the global variable samplingMode:
+ * SAMPLINGRANDOM picks them at random, SAMPLINGSTRATIFIED picks one at random in each cell of a grid,
+ * SAMPLINGHALTON follows a Halton sequence (bases 2 and 3) randomly shifted at each call
+ * and SAMPLINGSTRIDED takes a regular grid randomly shifted at each call.
+ * With the distance functions above, vectors are clustered with a hash grid and the heaviest clusters are kept.
  * Returns 0 if the operation is a success and 1 in case of a failure.
  *
  * @param Pointer to the depth map
@@ -218,6 +471,23 @@ TVec4D* maxPointList(TVecList* list);
  */
 int detectDrone(short* data, TVecList* list, float vecDistance(const TVec4D*, const TVec4D*));
 
+/**
+ * Same as detectDrone, with part of the samples taken in a window of the depth map.
+ * Without a window, samples are taken in the whole depth map. The window may also set the number of samples,
+ * and the base of the camera used to convert the floor and the ceiling.
+ * Without a generator, a generator of the calling thread seeded with the time is used.
+ * A cluster grid kept by the caller is reset and reused, without it a grid is allocated for the call.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the depth map
+ * @param Pointer to the vector list
+ * @param Function used to determine the distance between two vectors
+ * @param Pointer to the sampling window, NULL for none
+ * @param Pointer to the pseudo-random number generator, NULL for the default one
+ * @param Pointer to the cluster grid, NULL for a grid allocated for the call
+ */
+int detectDroneWindow(short* data, TVecList* list, float vecDistance(const TVec4D*, const TVec4D*), const TSamplingWindow* window, TRandom* random, TClusterGrid* grid);
+
 /**
  * Adds all the vectors of the second list to the first list.
  * If two vectors are close enough the are fused.
@@ -239,7 +509,10 @@ int fusePointList(TVecList* mainList, const TVecList* secList, float tolerance,
 int __simplifyPointList(TVecList* list, float tolerance, float vecDistance(const TVec4D*, const TVec4D*));
 
 /**
- * Applies the function __simplifyPointList until no more fusions are possible.
+ * Fuses vectors within a same list if they are close enough, until no more fusions are possible.
+ * With the distance functions above, all close vectors are joined in a single pass (see mergeClusters),
+ * otherwise the function __simplifyPointList is applied until no more fusions are possible.
+ * Returns 1 if vectors were fused and 0 otherwise.
  *
  * @param Pointer to the vector list
  * @param Tolerance for fusing two vectors
@@ -254,6 +527,13 @@ int simplifyPointList(TVecList* list, float tolerance, float vecDistance(const T
  */
 void displayVec4(const TVec4D* v);
 
+/**
+ * Displays the equation of a plane.
+ *
+ * @param Pointer to the plane
+ */
+void displayPlane(const TPlane* p);
+
 /**
  * Displays a matrix.
  *
@@ -0,0 +1,36 @@
+#include "kinectExchange.h"
+
+/**
+ * Initializes the indices of a buffer exchange, no buffer is fresh.
+ *
+ * @param Pointer to the buffer exchange
+ */
+void initBufferExchange(TBufferExchange* exchange){
+	exchange->front = 0;
+	atomic_init(&(exchange->middle), 1);
+	exchange->back = 2;
+}
+
+/**
+ * Publishes the back buffer as the newest one, called by the producer once the back buffer is written.
+ * The back index then designates the buffer to write next.
+ *
+ * @param Pointer to the buffer exchange
+ */
+void publishBuffer(TBufferExchange* exchange){
+	exchange->back = atomic_exchange(&(exchange->middle), exchange->back | FRESHBUFFER) & ~FRESHBUFFER;
+}
+
+/**
+ * Takes the newest buffer as the front buffer, called by the consumer.
+ * Returns 0 if the front index designates a new buffer and 1 if nothing was published since the last call.
+ *
+ * @param Pointer to the buffer exchange
+ */
+int takeBuffer(TBufferExchange* exchange){
+	//nothing new since last call
+	if(!(atomic_load(&(exchange->middle)) & FRESHBUFFER)){ return 1; }
+	//swap front buffer with the newest one
+	exchange->front = atomic_exchange(&(exchange->middle), exchange->front) & ~FRESHBUFFER;
+	return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdatomic.h>
+
+#define FRESHBUFFER 4
+
+/// Structure exchanging three buffers between a producer thread and a consumer thread without locks.
+/// The three buffers rotate: the producer writes in the back buffer,
+/// the consumer reads the front buffer and the middle one holds the newest data.
+/// The FRESHBUFFER bit of middle is set when the middle buffer has not been read yet.
+/// Only the indices of the buffers are exchanged, the buffers belong to the caller.
+typedef struct{
+	atomic_int middle;
+	int back;
+	int front;
+}TBufferExchange;
+
+
+/**
+ * Initializes the indices of a buffer exchange, no buffer is fresh.
+ *
+ * @param Pointer to the buffer exchange
+ */
+void initBufferExchange(TBufferExchange* exchange);
+
+/**
+ * Publishes the back buffer as the newest one, called by the producer once the back buffer is written.
+ * The back index then designates the buffer to write next.
+ *
+ * @param Pointer to the buffer exchange
+ */
+void publishBuffer(TBufferExchange* exchange);
+
+/**
+ * Takes the newest buffer as the front buffer, called by the consumer.
+ * Returns 0 if the front index designates a new buffer and 1 if nothing was published since the last call.
+ *
+ * @param Pointer to the buffer exchange
+ */
+int takeBuffer(TBufferExchange* exchange);
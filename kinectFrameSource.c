@@ -0,0 +1,233 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <libfreenect_sync.h>
+#include "kinectDetectionUtil.h"
+#include "kinectFrameSource.h"
+#include "kinectRecording.h"
+
+/// Structure containing the state of a synthetic or replay source.
+/// A replayed file is either read with pFile (raw depth maps) or memory mapped in recording (compressed).
+/// The deadline is the time at which the next depth map is due in real-time mode.
+typedef struct{
+	short data[DEPTHSIZE];
+	FILE* pFile;
+	TRecording* recording;
+	int mode;
+	unsigned int frame;
+	struct timespec deadline;
+}TReplayState;
+
+/**
+ * Waits until the next depth map is due at sensor rate.
+ *
+ * @param Pointer to the state of the source
+ */
+static void waitNextFrame(TReplayState* state){
+	if(state->deadline.tv_sec == 0 && state->deadline.tv_nsec == 0){
+		clock_gettime(CLOCK_MONOTONIC, &(state->deadline));
+	}
+	state->deadline.tv_nsec += FRAMEPERIOD*1000L;
+	if(state->deadline.tv_nsec >= 1000000000L){
+		state->deadline.tv_nsec -= 1000000000L;
+		state->deadline.tv_sec++;
+	}
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &(state->deadline), NULL);
+}
+
+/**
+ * Refreshes the depth map of a Kinect.
+ *
+ * @param Pointer to the source
+ * @param Pointer to the depth map
+ * @param Pointer to the time stamp
+ */
+static int grabKinect(TFrameSource* pSource, short** data, unsigned int* timestamp){
+	return freenect_sync_get_depth((void**)data, timestamp, pSource->id, FREENECT_DEPTH_REGISTERED);
+}
+
+/**
+ * Generates the next synthetic depth map.
+ *
+ * @param Pointer to the source
+ * @param Pointer to the depth map
+ * @param Pointer to the time stamp
+ */
+static int grabSynthetic(TFrameSource* pSource, short** data, unsigned int* timestamp){
+	TReplayState* state = pSource->state;
+	unsigned int frame = state->frame++;
+	//position of the object on the depth map
+	int cx = 320 + 150*cos(frame*0.05);
+	int cy = 200 + 60*sin(frame*0.05);
+	int xs, ys;
+	for(ys=0; ys<DEPTHHEIGHT; ys++){
+		//floor 1 metre below the camera, far wall above the horizon
+		short depth = 7000;
+		if(ys > 240){
+			float floorDepth = 1000/((ys-240)*0.00164129365) - 280;
+			if(floorDepth < depth){ depth = floorDepth; }
+		}
+		for(xs=0; xs<DEPTHWIDTH; xs++){
+			if((xs-cx)*(xs-cx) + (ys-cy)*(ys-cy) < 400){
+				state->data[ys*DEPTHWIDTH+xs] = 2500;
+			}else{
+				state->data[ys*DEPTHWIDTH+xs] = depth;
+			}
+		}
+	}
+	waitNextFrame(state);
+	*data = state->data;
+	*timestamp = frame;
+	return 0;
+}
+
+/**
+ * Reads the next depth map of a recorded file.
+ *
+ * @param Pointer to the source
+ * @param Pointer to the depth map
+ * @param Pointer to the time stamp
+ */
+static int grabReplay(TFrameSource* pSource, short** data, unsigned int* timestamp){
+	TReplayState* state = pSource->state;
+	//decode compressed frame, restart at the end of the file if needed
+	if(state->recording != NULL){
+		if(state->frame >= recordingLength(state->recording) && (state->mode & REPLAYLOOP)){
+			state->frame = 0;
+		}
+		if(decodeFrame(state->recording, state->frame, data, timestamp)){ return 1; }
+		state->frame++;
+		if(!(state->mode & REPLAYFAST)){
+			waitNextFrame(state);
+		}
+		return 0;
+	}
+	//read time stamp, restart at the end of the file if needed
+	if(fread(timestamp, sizeof(unsigned int), 1, state->pFile) != 1){
+		if(!(state->mode & REPLAYLOOP) || state->frame == 0){ return 1; }
+		rewind(state->pFile);
+		if(fread(timestamp, sizeof(unsigned int), 1, state->pFile) != 1){ return 1; }
+	}
+	//read depth map
+	if(fread(state->data, sizeof(short), DEPTHSIZE, state->pFile) != DEPTHSIZE){ return 1; }
+	state->frame++;
+	if(!(state->mode & REPLAYFAST)){
+		waitNextFrame(state);
+	}
+	*data = state->data;
+	return 0;
+}
+
+/**
+ * Frees the state of a synthetic or replay source.
+ *
+ * @param Pointer to the source
+ */
+static void closeReplay(TFrameSource* pSource){
+	TReplayState* state = pSource->state;
+	if(state->pFile != NULL){
+		fclose(state->pFile);
+	}
+	if(state->recording != NULL){
+		closeRecording(state->recording);
+		free(state->recording);
+	}
+	free(state);
+	pSource->state = NULL;
+}
+
+/**
+ * Opens a source reading the depth maps of a Kinect through libfreenect.
+ *
+ * @param Pointer to the source
+ * @param ID of the Kinect
+ */
+void openKinectSource(TFrameSource* pSource, int id){
+	pSource->grab = grabKinect;
+	pSource->close = NULL;
+	pSource->state = NULL;
+	pSource->id = id;
+}
+
+/**
+ * Opens a source generating synthetic depth maps at sensor rate: a flat floor and an object moving in circles.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the source
+ * @param ID of the source
+ */
+int openSyntheticSource(TFrameSource* pSource, int id){
+	TReplayState* state = calloc(1, sizeof(TReplayState));
+	if(state == NULL){ return 1; }
+	pSource->grab = grabSynthetic;
+	pSource->close = closeReplay;
+	pSource->state = state;
+	pSource->id = id;
+	return 0;
+}
+
+/**
+ * Opens a source replaying depth maps recorded in a file.
+ * The file is either a compressed recording (see kinectRecording.h) or raw depth maps written with writeRawFrame.
+ * With REPLAYREALTIME depth maps are given at sensor rate, with REPLAYFAST as fast as possible.
+ * REPLAYLOOP can be added to restart from the beginning at the end of the file.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the source
+ * @param Name of the recorded file
+ * @param Replay mode
+ */
+int openReplaySource(TFrameSource* pSource, const char* fileName, int mode){
+	TReplayState* state = calloc(1, sizeof(TReplayState));
+	if(state == NULL){ return 1; }
+	if(isRecording(fileName)){
+		//compressed recording
+		state->recording = malloc(sizeof(TRecording));
+		if(state->recording == NULL || openRecording(state->recording, fileName)){
+			free(state->recording);
+			free(state);
+			return 1;
+		}
+	}else{
+		//raw depth maps
+		state->pFile = fopen(fileName, "rb");
+		if(state->pFile == NULL){
+			free(state);
+			return 1;
+		}
+	}
+	state->mode = mode;
+	pSource->grab = grabReplay;
+	pSource->close = closeReplay;
+	pSource->state = state;
+	pSource->id = -1;
+	return 0;
+}
+
+/**
+ * Writes a depth map and its time stamp at the end of a recorded file.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the file
+ * @param Pointer to the depth map
+ * @param Time stamp of the depth map
+ */
+int writeRawFrame(FILE* pFile, const short* data, unsigned int timestamp){
+	if(fwrite(&timestamp, sizeof(unsigned int), 1, pFile) != 1){ return 1; }
+	if(fwrite(data, sizeof(short), DEPTHSIZE, pFile) != DEPTHSIZE){ return 1; }
+	return 0;
+}
+
+/**
+ * Closes a source.
+ *
+ * @param Pointer to the source
+ */
+void closeFrameSource(TFrameSource* pSource){
+	if(pSource->close != NULL){
+		pSource->close(pSource);
+	}
+	pSource->grab = NULL;
+	pSource->close = NULL;
+}
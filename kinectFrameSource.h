@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdio.h>
+
+#define FRAMEPERIOD 33333
+
+///replay modes
+#define REPLAYREALTIME 0
+#define REPLAYFAST 1
+#define REPLAYLOOP 2
+
+/// Structure representing a source of depth maps.
+/// The grab function gives the newest depth map (640x480, in millimetres) and its time stamp.
+/// The close function frees the state of the source.
+typedef struct TFrameSource{
+	int (*grab)(struct TFrameSource* pSource, short** data, unsigned int* timestamp);
+	void (*close)(struct TFrameSource* pSource);
+	void* state;
+	int id;
+}TFrameSource;
+
+
+/**
+ * Opens a source reading the depth maps of a Kinect through libfreenect.
+ *
+ * @param Pointer to the source
+ * @param ID of the Kinect
+ */
+void openKinectSource(TFrameSource* pSource, int id);
+
+/**
+ * Opens a source generating synthetic depth maps at sensor rate: a flat floor and an object moving in circles.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the source
+ * @param ID of the source
+ */
+int openSyntheticSource(TFrameSource* pSource, int id);
+
+/**
+ * Opens a source replaying depth maps recorded in a file.
+ * The file is either a compressed recording (see kinectRecording.h) or raw depth maps written with writeRawFrame.
+ * With REPLAYREALTIME depth maps are given at sensor rate, with REPLAYFAST as fast as possible.
+ * REPLAYLOOP can be added to restart from the beginning at the end of the file.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the source
+ * @param Name of the recorded file
+ * @param Replay mode
+ */
+int openReplaySource(TFrameSource* pSource, const char* fileName, int mode);
+
+/**
+ * Writes a depth map and its time stamp at the end of a recorded file.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the file
+ * @param Pointer to the depth map
+ * @param Time stamp of the depth map
+ */
+int writeRawFrame(FILE* pFile, const short* data, unsigned int timestamp);
+
+/**
+ * Closes a source.
+ *
+ * @param Pointer to the source
+ */
+void closeFrameSource(TFrameSource* pSource);
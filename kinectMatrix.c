@@ -0,0 +1,229 @@
+#include <math.h>
+#include "kinectMatrix.h"
+
+//SSE2 is part of x86-64, no dispatch is needed
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define MATRIXSIMD
+#define SWIZZLE(v, x, y, z, w) _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(v), _MM_SHUFFLE(w, z, y, x)))
+#define SHUFFLE(v1, v2, x, y, z, w) _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(w, z, y, x))
+#endif
+
+/**
+ * Returns an identity matrix.
+ */
+TMatrix4D identityMatrix(){
+	TMatrix4D m = {{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}};
+	return m;
+}
+
+/**
+ * Returns a transformation matrix.
+ * The transformation performs a rotation around the Z axis and a translation.
+ *
+ * @param x value of translation
+ * @param y value of translation
+ * @param z value of translation
+ * @param Angle of rotation in radians.
+ */
+TMatrix4D translationRotationZMatrix(float x, float y, float z, float angle){
+	float c = cos(angle), s = sin(angle);
+	TMatrix4D m = {{c, -s, 0, x, s, c, 0, y, 0, 0, 1, z, 0, 0, 0, 1}};
+	return m;
+}
+
+/**
+ * Returns the product of two matrices, with SSE when available.
+ *
+ * @param Pointer to the first matrix
+ * @param Pointer to the second matrix
+ */
+TMatrix4D multiplyMatrix(const TMatrix4D* m1, const TMatrix4D* m2){
+	TMatrix4D result;
+	int i;
+#ifdef MATRIXSIMD
+	__m128 b0 = _mm_loadu_ps(m2->m), b1 = _mm_loadu_ps(m2->m+4), b2 = _mm_loadu_ps(m2->m+8), b3 = _mm_loadu_ps(m2->m+12);
+	for(i=0; i<4; i++){
+		//row i is the combination of the rows of m2 by row i of m1
+		__m128 r = _mm_mul_ps(_mm_set1_ps(m1->m[4*i]), b0);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m1->m[4*i+1]), b1));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m1->m[4*i+2]), b2));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m1->m[4*i+3]), b3));
+		_mm_storeu_ps(result.m+4*i, r);
+	}
+#else
+	int j;
+	for(i=0; i<4; i++){
+		for(j=0; j<4; j++){
+			result.m[4*i+j] = m1->m[4*i]*m2->m[j] + m1->m[4*i+1]*m2->m[4+j] + m1->m[4*i+2]*m2->m[8+j] + m1->m[4*i+3]*m2->m[12+j];
+		}
+	}
+#endif
+	return result;
+}
+
+/**
+ * Returns the infinity norm of the upper-left block of a matrix, its largest sum of absolute values over a row,
+ * or NaN if the block contains NaN.
+ *
+ * @param Pointer to the matrix
+ * @param Size of the block, 3 for the linear part and 4 for the whole matrix
+ */
+static float matrixNorm(const TMatrix4D* m, int size){
+	float norm = 0;
+	int i, j;
+	for(i=0; i<size; i++){
+		float sum = 0;
+		for(j=0; j<size; j++){
+			sum += fabsf(m->m[4*i+j]);
+		}
+		//NaN values are kept, so that singular matrices are rejected
+		norm = (sum > norm || isnan(sum))? sum : norm;
+	}
+	return norm;
+}
+
+/**
+ * Returns the condition number in infinity norm of the linear part (upper-left 3x3 block) of a transformation,
+ * given its inverse, or NaN if either matrix contains NaN.
+ * The translation is left out: it is in mm, so it would make the condition grow with the distance between cameras.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the inverse of the matrix
+ */
+float matrixCondition(const TMatrix4D* m, const TMatrix4D* invert){
+	return matrixNorm(m, 3)*matrixNorm(invert, 3);
+}
+
+#ifdef MATRIXSIMD
+
+/**
+ * Returns the product of two 2x2 matrices stored in vectors, row by row.
+ *
+ * @param First matrix
+ * @param Second matrix
+ */
+static inline __m128 mat2Mul(__m128 a, __m128 b){
+	return _mm_add_ps(_mm_mul_ps(a, SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+/**
+ * Returns the product of the adjugate of a 2x2 matrix by another.
+ *
+ * @param First matrix
+ * @param Second matrix
+ */
+static inline __m128 mat2AdjMul(__m128 a, __m128 b){
+	return _mm_sub_ps(_mm_mul_ps(SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(SWIZZLE(a, 1, 1, 2, 2), SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+/**
+ * Returns the product of a 2x2 matrix by the adjugate of another.
+ *
+ * @param First matrix
+ * @param Second matrix
+ */
+static inline __m128 mat2MulAdj(__m128 a, __m128 b){
+	return _mm_sub_ps(_mm_mul_ps(a, SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+#endif
+
+/**
+ * Inverts a matrix with the closed form of its 2x2 blocks, with SSE when available.
+ * Returns 0 if the operation is a success and 1 if the condition number of its linear part is above MATRIXMAXCONDITION
+ * or if the inverse is not finite.
+ *
+ * @param Pointer to the inverted matrix
+ * @param Pointer to the matrix to invert
+ */
+int invertMatrix(TMatrix4D* invert, const TMatrix4D* m){
+#ifdef MATRIXSIMD
+	//M = [A B; C D] with 2x2 blocks stored row by row
+	__m128 r0 = _mm_loadu_ps(m->m), r1 = _mm_loadu_ps(m->m+4), r2 = _mm_loadu_ps(m->m+8), r3 = _mm_loadu_ps(m->m+12);
+	__m128 a = _mm_movelh_ps(r0, r1), b = _mm_movehl_ps(r1, r0);
+	__m128 c = _mm_movelh_ps(r2, r3), d = _mm_movehl_ps(r3, r2);
+	//determinants of the blocks (|A| |B| |C| |D|)
+	__m128 det = _mm_sub_ps(_mm_mul_ps(SHUFFLE(r0, r2, 0, 2, 0, 2), SHUFFLE(r1, r3, 1, 3, 1, 3)), _mm_mul_ps(SHUFFLE(r0, r2, 1, 3, 1, 3), SHUFFLE(r1, r3, 0, 2, 0, 2)));
+	__m128 detA = SWIZZLE(det, 0, 0, 0, 0), detB = SWIZZLE(det, 1, 1, 1, 1);
+	__m128 detC = SWIZZLE(det, 2, 2, 2, 2), detD = SWIZZLE(det, 3, 3, 3, 3);
+	//adjugates of the blocks of the inverse
+	__m128 dc = mat2AdjMul(d, c), ab = mat2AdjMul(a, b);
+	__m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), mat2Mul(b, dc));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), mat2Mul(c, ab));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), mat2MulAdj(d, ab));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), mat2MulAdj(a, dc));
+	//|M| = |A||D| + |B||C| - tr((A#B)(D#C))
+	__m128 tr = _mm_mul_ps(ab, SWIZZLE(dc, 0, 2, 1, 3));
+	tr = _mm_add_ps(tr, SWIZZLE(tr, 2, 3, 0, 1));
+	tr = _mm_add_ps(tr, SWIZZLE(tr, 1, 0, 3, 2));
+	__m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+	__m128 rDetM = _mm_div_ps(_mm_setr_ps(1, -1, -1, 1), detM);
+	x = _mm_mul_ps(x, rDetM);
+	y = _mm_mul_ps(y, rDetM);
+	z = _mm_mul_ps(z, rDetM);
+	w = _mm_mul_ps(w, rDetM);
+	//adjugate of the blocks and store
+	_mm_storeu_ps(invert->m, SHUFFLE(x, y, 3, 1, 3, 1));
+	_mm_storeu_ps(invert->m+4, SHUFFLE(x, y, 2, 0, 2, 0));
+	_mm_storeu_ps(invert->m+8, SHUFFLE(z, w, 3, 1, 3, 1));
+	_mm_storeu_ps(invert->m+12, SHUFFLE(z, w, 2, 0, 2, 0));
+#else
+	//2x2 determinants of the two upper and the two lower rows
+	const float* a = m->m;
+	float s0 = a[0]*a[5] - a[4]*a[1], s1 = a[0]*a[6] - a[4]*a[2], s2 = a[0]*a[7] - a[4]*a[3];
+	float s3 = a[1]*a[6] - a[5]*a[2], s4 = a[1]*a[7] - a[5]*a[3], s5 = a[2]*a[7] - a[6]*a[3];
+	float c5 = a[10]*a[15] - a[14]*a[11], c4 = a[9]*a[15] - a[13]*a[11], c3 = a[9]*a[14] - a[13]*a[10];
+	float c2 = a[8]*a[15] - a[12]*a[11], c1 = a[8]*a[14] - a[12]*a[10], c0 = a[8]*a[13] - a[12]*a[9];
+	float r = 1/(s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0);
+	float* inv = invert->m;
+	inv[0] = (a[5]*c5 - a[6]*c4 + a[7]*c3)*r;
+	inv[1] = (-a[1]*c5 + a[2]*c4 - a[3]*c3)*r;
+	inv[2] = (a[13]*s5 - a[14]*s4 + a[15]*s3)*r;
+	inv[3] = (-a[9]*s5 + a[10]*s4 - a[11]*s3)*r;
+	inv[4] = (-a[4]*c5 + a[6]*c2 - a[7]*c1)*r;
+	inv[5] = (a[0]*c5 - a[2]*c2 + a[3]*c1)*r;
+	inv[6] = (-a[12]*s5 + a[14]*s2 - a[15]*s1)*r;
+	inv[7] = (a[8]*s5 - a[10]*s2 + a[11]*s1)*r;
+	inv[8] = (a[4]*c4 - a[5]*c2 + a[7]*c0)*r;
+	inv[9] = (-a[0]*c4 + a[1]*c2 - a[3]*c0)*r;
+	inv[10] = (a[12]*s4 - a[13]*s2 + a[15]*s0)*r;
+	inv[11] = (-a[8]*s4 + a[9]*s2 - a[11]*s0)*r;
+	inv[12] = (-a[4]*c3 + a[5]*c1 - a[6]*c0)*r;
+	inv[13] = (a[0]*c3 - a[1]*c1 + a[2]*c0)*r;
+	inv[14] = (-a[12]*s3 + a[13]*s1 - a[14]*s0)*r;
+	inv[15] = (a[8]*s3 - a[9]*s1 + a[10]*s0)*r;
+#endif
+	//also rejects infinite and NaN values
+	return !(matrixCondition(m, invert) < MATRIXMAXCONDITION) || !isfinite(matrixNorm(invert, 4));
+}
+
+/**
+ * Inverts a rigid transformation by transposing its rotation and rotating back its translation.
+ * Returns 0 if the operation is a success and 1 if the matrix is not a rigid transformation.
+ *
+ * @param Pointer to the inverted matrix
+ * @param Pointer to the matrix to invert
+ */
+int invertRigidMatrix(TMatrix4D* invert, const TMatrix4D* m){
+	const float* a = m->m;
+	int i, j;
+	if(a[12] != 0 || a[13] != 0 || a[14] != 0 || a[15] != 1){ return 1; }
+	//the columns of the rotation must be orthonormal
+	for(i=0; i<3; i++){
+		for(j=i; j<3; j++){
+			float dot = a[i]*a[j] + a[4+i]*a[4+j] + a[8+i]*a[8+j];
+			if(fabsf(dot - (i == j)) > MATRIXRIGIDTOLERANCE){ return 1; }
+		}
+	}
+	//transposed rotation, then rotated back translation
+	invert->m[0] = a[0]; invert->m[1] = a[4]; invert->m[2] = a[8];
+	invert->m[4] = a[1]; invert->m[5] = a[5]; invert->m[6] = a[9];
+	invert->m[8] = a[2]; invert->m[9] = a[6]; invert->m[10] = a[10];
+	invert->m[3] = -(a[0]*a[3] + a[4]*a[7] + a[8]*a[11]);
+	invert->m[7] = -(a[1]*a[3] + a[5]*a[7] + a[9]*a[11]);
+	invert->m[11] = -(a[2]*a[3] + a[6]*a[7] + a[10]*a[11]);
+	invert->m[12] = invert->m[13] = invert->m[14] = 0;
+	invert->m[15] = 1;
+	return 0;
+}
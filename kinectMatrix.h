@@ -0,0 +1,61 @@
+#pragma once
+
+#include "kinectDetectionUtil.h"
+
+///largest condition number of the linear part of an invertible transformation
+#define MATRIXMAXCONDITION 1e6f
+///largest error of a rotation matrix (R^T R - I) for a rigid transformation
+#define MATRIXRIGIDTOLERANCE 1e-3f
+
+/**
+ * Returns an identity matrix.
+ */
+TMatrix4D identityMatrix();
+
+/**
+ * Returns a transformation matrix.
+ * The transformation performs a rotation around the Z axis and a translation.
+ *
+ * @param x value of translation
+ * @param y value of translation
+ * @param z value of translation
+ * @param Angle of rotation in radians.
+ */
+TMatrix4D translationRotationZMatrix(float x, float y, float z, float angle);
+
+/**
+ * Returns the product of two matrices, with SSE when available.
+ *
+ * @param Pointer to the first matrix
+ * @param Pointer to the second matrix
+ */
+TMatrix4D multiplyMatrix(const TMatrix4D* m1, const TMatrix4D* m2);
+
+/**
+ * Returns the condition number in infinity norm of the linear part (upper-left 3x3 block) of a transformation,
+ * given its inverse, or NaN if either matrix contains NaN.
+ * The translation is left out: it is in mm, so it would make the condition grow with the distance between cameras.
+ *
+ * @param Pointer to the matrix
+ * @param Pointer to the inverse of the matrix
+ */
+float matrixCondition(const TMatrix4D* m, const TMatrix4D* invert);
+
+/**
+ * Inverts a matrix with the closed form of its 2x2 blocks, with SSE when available.
+ * Returns 0 if the operation is a success and 1 if the condition number of its linear part is above MATRIXMAXCONDITION
+ * or if the inverse is not finite.
+ *
+ * @param Pointer to the inverted matrix
+ * @param Pointer to the matrix to invert
+ */
+int invertMatrix(TMatrix4D* invert, const TMatrix4D* m);
+
+/**
+ * Inverts a rigid transformation by transposing its rotation and rotating back its translation.
+ * Returns 0 if the operation is a success and 1 if the matrix is not a rigid transformation.
+ *
+ * @param Pointer to the inverted matrix
+ * @param Pointer to the matrix to invert
+ */
+int invertRigidMatrix(TMatrix4D* invert, const TMatrix4D* m);
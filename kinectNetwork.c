@@ -0,0 +1,199 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include "kinectNetwork.h"
+
+/**
+ * Puts a packet in the queue of a network thread.
+ * Returns 0 if the operation is a success and 1 if the queue is full.
+ *
+ * @param Pointer to the network thread
+ * @param Pointer to the packet
+ * @param Length of the packet in bytes
+ */
+static int enqueuePacket(TNetworkThread* net, const void* packet, int length){
+	size_t pos = atomic_load_explicit(&(net->head), memory_order_relaxed);
+	while(1){
+		TPacketSlot* slot = &(net->slot[pos % NETWORKQUEUESIZE]);
+		intptr_t diff = (intptr_t)atomic_load_explicit(&(slot->sequence), memory_order_acquire) - (intptr_t)pos;
+		if(diff == 0){
+			if(atomic_compare_exchange_weak_explicit(&(net->head), &pos, pos+1, memory_order_relaxed, memory_order_relaxed)){
+				memcpy(slot->data, packet, length);
+				slot->length = length;
+				atomic_store_explicit(&(slot->sequence), pos+1, memory_order_release);
+				return 0;
+			}
+		}else if(diff < 0){
+			return 1;
+		}else{
+			pos = atomic_load_explicit(&(net->head), memory_order_relaxed);
+		}
+	}
+}
+
+/**
+ * Takes the oldest packet of the queue of a network thread.
+ * Called by the network thread, and by the detection loop to drop a packet when the queue is full.
+ * Returns 0 if the operation is a success and 1 if the queue is empty.
+ *
+ * @param Pointer to the network thread
+ * @param Pointer to the packet, NULL to drop it
+ * @param Pointer to the length of the packet
+ */
+static int dequeuePacket(TNetworkThread* net, char* packet, int* length){
+	size_t pos = atomic_load_explicit(&(net->tail), memory_order_relaxed);
+	while(1){
+		TPacketSlot* slot = &(net->slot[pos % NETWORKQUEUESIZE]);
+		intptr_t diff = (intptr_t)atomic_load_explicit(&(slot->sequence), memory_order_acquire) - (intptr_t)(pos+1);
+		if(diff == 0){
+			if(atomic_compare_exchange_weak_explicit(&(net->tail), &pos, pos+1, memory_order_relaxed, memory_order_relaxed)){
+				if(packet != NULL){
+					*length = slot->length;
+					memcpy(packet, slot->data, slot->length);
+				}
+				atomic_store_explicit(&(slot->sequence), pos+NETWORKQUEUESIZE, memory_order_release);
+				return 0;
+			}
+		}else if(diff < 0){
+			return 1;
+		}else{
+			pos = atomic_load_explicit(&(net->tail), memory_order_relaxed);
+		}
+	}
+}
+
+/**
+ * Function executed by the network thread: sends the queued packets, and retries after NETWORKRETRYMS when the socket is full.
+ *
+ * @param Pointer to the network thread
+ */
+static void* networkLoop(void* arg){
+	TNetworkThread* net = arg;
+	struct epoll_event event;
+	char packet[NETWORKMAXPACKET];
+	int length = 0, pending = 0, next = 0;
+	uint64_t value;
+	while(atomic_load(&(net->running))){
+		//a UDP socket is always writable, ENOBUFS is not signalled by epoll, so a packet waiting for room is retried after a delay
+		if(epoll_wait(net->epoll, &event, 1, pending? NETWORKRETRYMS : -1) > 0){
+			while(read(net->wake, &value, sizeof(value)) > 0);
+		}
+		if(!atomic_load(&(net->running))){ break; }
+		while(1){
+			if(!pending){
+				if(dequeuePacket(net, packet, &length)){ break; }
+				pending = 1;
+				next = 0;
+			}
+			next = sendPacketFrom(net->publisher, packet, length, next);
+			if(next < subscriberCount(net->publisher)){
+				//socket full, retry from the same subscriber later
+				atomic_fetch_add(&(net->nbRetries), 1);
+				break;
+			}
+			pending = 0;
+			atomic_fetch_add(&(net->nbSent), 1);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Makes the socket of a publisher non-blocking and starts the thread sending its packets.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the network thread
+ * @param Pointer to the publisher, must stay valid while the thread runs
+ */
+int startNetworkThread(TNetworkThread* net, TPublisher* pub){
+	int i;
+	struct epoll_event wake = {.events = EPOLLIN};
+	net->publisher = pub;
+	for(i=0; i<NETWORKQUEUESIZE; i++){
+		atomic_init(&(net->slot[i].sequence), i);
+	}
+	atomic_init(&(net->head), 0);
+	atomic_init(&(net->tail), 0);
+	atomic_init(&(net->nbQueued), 0);
+	atomic_init(&(net->nbDropped), 0);
+	atomic_init(&(net->nbSent), 0);
+	atomic_init(&(net->nbRetries), 0);
+	atomic_init(&(net->running), 1);
+	if(setPublisherNonBlocking(pub)){
+		return 1;
+	}
+	net->epoll = epoll_create1(0);
+	net->wake = eventfd(0, EFD_NONBLOCK);
+	wake.data.fd = net->wake;
+	if(net->epoll == -1 || net->wake == -1 || epoll_ctl(net->epoll, EPOLL_CTL_ADD, net->wake, &wake)){
+		close(net->epoll);
+		close(net->wake);
+		return 1;
+	}
+	if(pthread_create(&(net->thread), NULL, networkLoop, net)){
+		close(net->epoll);
+		close(net->wake);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Queues a packet to be sent to all the subscribers, without waiting for the network.
+ * If the queue is full, the oldest packet is dropped.
+ * Returns 0 if the packet was queued, 1 if an older packet was dropped to make room and -1 if the packet is too long.
+ *
+ * @param Pointer to the network thread
+ * @param Pointer to the packet
+ * @param Length of the packet in bytes, at most NETWORKMAXPACKET
+ */
+int queuePacket(TNetworkThread* net, const void* packet, int length){
+	uint64_t one = 1;
+	int dropped = 0;
+	if(length > NETWORKMAXPACKET){
+		return -1;
+	}
+	while(enqueuePacket(net, packet, length)){
+		if(dequeuePacket(net, NULL, NULL) == 0){
+			atomic_fetch_add(&(net->nbDropped), 1);
+			dropped = 1;
+		}
+	}
+	atomic_fetch_add(&(net->nbQueued), 1);
+	//the eventfd is non-blocking, a failed wake-up only delays the packet until the next one
+	if(write(net->wake, &one, sizeof(one)) != sizeof(one)){
+		atomic_fetch_add(&(net->nbRetries), 1);
+	}
+	return dropped;
+}
+
+/**
+ * Stops the network thread, the packets still in the queue are not sent.
+ *
+ * @param Pointer to the network thread
+ */
+void stopNetworkThread(TNetworkThread* net){
+	uint64_t one = 1;
+	atomic_store(&(net->running), 0);
+	while(write(net->wake, &one, sizeof(one)) != sizeof(one) && errno == EINTR);
+	pthread_join(net->thread, NULL);
+	close(net->epoll);
+	close(net->wake);
+}
+
+/**
+ * Displays the number of packets queued, sent and dropped, the retries and the errors of the subscribers.
+ *
+ * @param Pointer to the output file
+ * @param Pointer to the network thread
+ */
+void displayNetworkThread(FILE* pFile, TNetworkThread* net){
+	fprintf(pFile, "network: %ld queued, %ld sent, %ld dropped, %ld retries, %ld errors, %d subscribers\n",
+		atomic_load(&(net->nbQueued)), atomic_load(&(net->nbSent)), atomic_load(&(net->nbDropped)),
+		atomic_load(&(net->nbRetries)), net->publisher->nbErrors, subscriberCount(net->publisher));
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "kinectPublisher.h"
+
+#define NETWORKQUEUESIZE 16
+#define NETWORKMAXPACKET 64
+#define NETWORKRETRYMS 5
+
+/// Structure containing a packet waiting in the queue of the network thread.
+/// The sequence of a slot tells whether it is free or holds a packet (bounded queue of D. Vyukov).
+typedef struct{
+	atomic_size_t sequence;
+	int length;
+	char data[NETWORKMAXPACKET];
+}TPacketSlot;
+
+/// Structure representing the thread sending the packets of the detection loop to the subscribers of a publisher.
+/// The loop puts packets in a bounded lock-free queue and never waits for the network: when the queue is full,
+/// the oldest packet is dropped. The thread waits with epoll for new packets (eventfd), a packet which could not
+/// be sent to all subscribers by the non-blocking socket is retried from where it stopped after NETWORKRETRYMS.
+/// Unreachable subscribers are counted in the errors of the publisher and skipped.
+typedef struct{
+	TPublisher* publisher;
+	TPacketSlot slot[NETWORKQUEUESIZE];
+	atomic_size_t head;
+	atomic_size_t tail;
+	int epoll;
+	int wake;
+	atomic_int running;
+	pthread_t thread;
+	atomic_long nbQueued;
+	atomic_long nbDropped;
+	atomic_long nbSent;
+	atomic_long nbRetries;
+}TNetworkThread;
+
+
+/**
+ * Makes the socket of a publisher non-blocking and starts the thread sending its packets.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the network thread
+ * @param Pointer to the publisher, must stay valid while the thread runs
+ */
+int startNetworkThread(TNetworkThread* net, TPublisher* pub);
+
+/**
+ * Queues a packet to be sent to all the subscribers, without waiting for the network.
+ * If the queue is full, the oldest packet is dropped.
+ * Returns 0 if the packet was queued, 1 if an older packet was dropped to make room and -1 if the packet is too long.
+ *
+ * @param Pointer to the network thread
+ * @param Pointer to the packet
+ * @param Length of the packet in bytes, at most NETWORKMAXPACKET
+ */
+int queuePacket(TNetworkThread* net, const void* packet, int length);
+
+/**
+ * Stops the network thread, the packets still in the queue are not sent.
+ *
+ * @param Pointer to the network thread
+ */
+void stopNetworkThread(TNetworkThread* net);
+
+/**
+ * Displays the number of packets queued, sent and dropped, the retries and the errors of the subscribers.
+ *
+ * @param Pointer to the output file
+ * @param Pointer to the network thread
+ */
+void displayNetworkThread(FILE* pFile, TNetworkThread* net);
@@ -0,0 +1,233 @@
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "kinectPacket.h"
+
+///table of the CRC32, one entry per byte value
+static uint32_t crcTable[256];
+static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Fills the table of the CRC32 with the reflected polynomial 0xEDB88320.
+ */
+static void initCRCTable(){
+	uint32_t i, j, c;
+	for(i=0; i<256; i++){
+		c = i;
+		for(j=0; j<8; j++){
+			c = (c & 1)? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		}
+		crcTable[i] = c;
+	}
+}
+
+/**
+ * Writes little-endian integers and floats of 16, 32 and 64 bits, whatever the byte order of the host.
+ */
+static void put16(char* p, uint32_t v){
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put32(char* p, uint32_t v){
+	put16(p, v);
+	put16(p+2, v >> 16);
+}
+
+static void put64(char* p, uint64_t v){
+	put32(p, v);
+	put32(p+4, v >> 32);
+}
+
+static void putFloat(char* p, float f){
+	uint32_t v;
+	memcpy(&v, &f, sizeof(v));
+	put32(p, v);
+}
+
+/**
+ * Reads little-endian integers and floats of 16, 32 and 64 bits, whatever the byte order of the host.
+ */
+static uint32_t get16(const char* p){
+	return (unsigned char)p[0] | ((unsigned char)p[1] << 8);
+}
+
+static uint32_t get32(const char* p){
+	return get16(p) | (get16(p+2) << 16);
+}
+
+static uint64_t get64(const char* p){
+	return get32(p) | ((uint64_t)get32(p+4) << 32);
+}
+
+static float getFloat(const char* p){
+	uint32_t v = get32(p);
+	float f;
+	memcpy(&f, &v, sizeof(f));
+	return f;
+}
+
+/**
+ * Writes data to a legacy packet, sent to the consumers which do not understand position packets.
+ * A 8 bit checksum is written at the end of the packet.
+ *
+ * @param Pointer to the packet. The packet must be at least LEGACYPACKETSIZE bytes long.
+ * @param Type of data transmitted.
+ * @param First variable to transmit.
+ * @param Second variable to transmit.
+ * @param Third variable to transmit.
+ */
+void writePacket(char* packet, char type, short data1, short data2, short data3){
+	int i;
+	char crc8 = type;
+	packet[0] = type;
+	*((short*)&packet[1]) = data1;
+	*((short*)&packet[3]) = data2;
+	*((short*)&packet[5]) = data3;
+	for(i=1; i<7; i++){
+		crc8 += packet[i];
+	}
+	packet[7] = crc8;
+}
+
+/**
+ * Reads the data of a legacy packet.
+ * Returns 0 if the operation is a success and 1 if the packet is too short or its checksum is wrong.
+ *
+ * @param Pointer to the packet
+ * @param Length of the packet in bytes
+ * @param Pointer to the type of data transmitted
+ * @param Pointer to the three variables transmitted
+ */
+int readPacket(const char* packet, int length, char* type, short data[3]){
+	int i;
+	char crc8 = packet[0];
+	if(length != LEGACYPACKETSIZE){
+		return 1;
+	}
+	for(i=1; i<7; i++){
+		crc8 += packet[i];
+	}
+	if(crc8 != packet[7]){
+		return 1;
+	}
+	*type = packet[0];
+	memcpy(data, packet+1, 3*sizeof(short));
+	return 0;
+}
+
+/**
+ * Computes the CRC32 (IEEE 802.3, as zlib) of a buffer.
+ *
+ * @param Pointer to the buffer
+ * @param Length of the buffer in bytes
+ */
+uint32_t packetCRC32(const void* buffer, int length){
+	const unsigned char* p = buffer;
+	uint32_t c = 0xFFFFFFFFu;
+	int i;
+	pthread_once(&crcTableOnce, initCRCTable);
+	for(i=0; i<length; i++){
+		c = crcTable[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+	}
+	return c ^ 0xFFFFFFFFu;
+}
+
+/**
+ * Fills a position packet with the state of a Kalman tracker, the sequence number is left to the caller.
+ * The weight is the one of the heaviest vector of the list, the packet is flagged as tracked if the track is not lost.
+ *
+ * @param Pointer to the content of the packet
+ * @param Pointer to the Kalman tracker
+ * @param Pointer to the detected vectors
+ * @param Capture timestamp of the depth map
+ * @param Mask of the cameras which detected something
+ */
+void fillPositionPacket(TPositionPacket* content, const TKalmanTracker* kalman, const TVecList* list, unsigned int timestamp, int cameraMask){
+	int i;
+	content->version = POSITIONPACKETVERSION;
+	//same test as kalmanPosition, so that receivers only need this file
+	content->flags = (kalman->misses <= KALMANMAXMISSES)? POSITIONTRACKED : 0;
+	content->time = packetTime();
+	content->captureTimestamp = timestamp;
+	//a lost track gives its last estimate
+	for(i=0; i<3; i++){
+		content->position[i] = kalman->position[i];
+		content->velocity[i] = kalman->velocity[i];
+	}
+	content->confidence = kalman->confidence;
+	content->weight = 0;
+	for(i=0; i<list->n; i++){
+		if(list->weight[i] > content->weight){
+			content->weight = list->weight[i];
+		}
+	}
+	content->cameraMask = cameraMask;
+}
+
+/**
+ * Writes a position packet in its wire format.
+ * Returns the length of the packet, POSITIONPACKETSIZE.
+ *
+ * @param Pointer to the packet, at least POSITIONPACKETSIZE bytes long
+ * @param Pointer to the content of the packet, its version is ignored
+ */
+int encodePositionPacket(char* packet, const TPositionPacket* content){
+	int i;
+	packet[0] = POSITIONPACKETTYPE;
+	packet[1] = POSITIONPACKETVERSION;
+	put16(packet+2, content->flags);
+	put32(packet+4, content->sequence);
+	put64(packet+8, content->time);
+	put32(packet+16, content->captureTimestamp);
+	for(i=0; i<3; i++){
+		putFloat(packet+20+4*i, content->position[i]);
+		putFloat(packet+32+4*i, content->velocity[i]);
+	}
+	putFloat(packet+44, content->confidence);
+	put16(packet+48, content->weight);
+	packet[50] = content->cameraMask;
+	packet[51] = 0;
+	put32(packet+52, packetCRC32(packet, 52));
+	return POSITIONPACKETSIZE;
+}
+
+/**
+ * Reads a position packet from its wire format.
+ * Returns 0 if the operation is a success and 1 if the packet is too short, of another type or version, or corrupted.
+ *
+ * @param Pointer to the packet
+ * @param Length of the packet in bytes
+ * @param Pointer to the content of the packet
+ */
+int decodePositionPacket(const char* packet, int length, TPositionPacket* content){
+	int i;
+	if(length < POSITIONPACKETSIZE || packet[0] != POSITIONPACKETTYPE || packet[1] != POSITIONPACKETVERSION){
+		return 1;
+	}
+	if(get32(packet+52) != packetCRC32(packet, 52)){
+		return 1;
+	}
+	content->version = packet[1];
+	content->flags = get16(packet+2);
+	content->sequence = get32(packet+4);
+	content->time = get64(packet+8);
+	content->captureTimestamp = get32(packet+16);
+	for(i=0; i<3; i++){
+		content->position[i] = getFloat(packet+20+4*i);
+		content->velocity[i] = getFloat(packet+32+4*i);
+	}
+	content->confidence = getFloat(packet+44);
+	content->weight = (short)get16(packet+48);
+	content->cameraMask = (unsigned char)packet[50];
+	return 0;
+}
+
+/**
+ * Returns the wall clock time in microseconds since the epoch, as used by position packets.
+ */
+uint64_t packetTime(){
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return (uint64_t)now.tv_sec*1000000 + now.tv_nsec/1000;
+}
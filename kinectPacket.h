@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include "kinectDetectionUtil.h"
+#include "kinectTracking.h"
+
+#define LEGACYPACKETSIZE 8
+#define LEGACYPACKETTYPE 'k'
+#define POSITIONPACKETSIZE 56
+#define POSITIONPACKETTYPE 'p'
+#define POSITIONPACKETVERSION 1
+
+///flags of a position packet
+#define POSITIONTRACKED 1
+
+/// Structure containing the decoded content of a position packet.
+/// The time is the wall clock time when the position was computed, in microseconds since the epoch,
+/// the capture timestamp is the one given by updateCamera for the depth map, in ticks of the camera clock.
+/// The sequence number is incremented for each packet sent, so that losses and reordering can be detected.
+/// The position is given in millimetres and the velocity in millimetres per second, in the base of the main camera.
+/// The weight is the weight of the detected vector, the camera mask has bit i set if camera i detected something.
+///
+/// Wire format, little-endian, CRC32 (IEEE 802.3) of bytes 0 to 51 at the end:
+///  0 type 'p'     1 version        2 flags (16 bits)   4 sequence (32 bits)
+///  8 time (64 bits)               16 capture timestamp (32 bits)
+/// 20 x, y, z (float)              32 vx, vy, vz (float)
+/// 44 confidence (float)           48 weight (16 bits)  50 camera mask (8 bits)  51 reserved
+/// 52 CRC32
+typedef struct{
+	int version;
+	int flags;
+	uint32_t sequence;
+	uint64_t time;
+	uint32_t captureTimestamp;
+	float position[3];
+	float velocity[3];
+	float confidence;
+	int weight;
+	int cameraMask;
+}TPositionPacket;
+
+
+/**
+ * Writes data to a legacy packet, sent to the consumers which do not understand position packets.
+ * A 8 bit checksum is written at the end of the packet.
+ *
+ * @param Pointer to the packet. The packet must be at least LEGACYPACKETSIZE bytes long.
+ * @param Type of data transmitted.
+ * @param First variable to transmit.
+ * @param Second variable to transmit.
+ * @param Third variable to transmit.
+ */
+void writePacket(char* packet, char type, short data1, short data2, short data3);
+
+/**
+ * Reads the data of a legacy packet.
+ * Returns 0 if the operation is a success and 1 if the packet is too short or its checksum is wrong.
+ *
+ * @param Pointer to the packet
+ * @param Length of the packet in bytes
+ * @param Pointer to the type of data transmitted
+ * @param Pointer to the three variables transmitted
+ */
+int readPacket(const char* packet, int length, char* type, short data[3]);
+
+/**
+ * Computes the CRC32 (IEEE 802.3, as zlib) of a buffer.
+ *
+ * @param Pointer to the buffer
+ * @param Length of the buffer in bytes
+ */
+uint32_t packetCRC32(const void* buffer, int length);
+
+/**
+ * Fills a position packet with the state of a Kalman tracker, the sequence number is left to the caller.
+ * The weight is the one of the heaviest vector of the list, the packet is flagged as tracked if the track is not lost.
+ *
+ * @param Pointer to the content of the packet
+ * @param Pointer to the Kalman tracker
+ * @param Pointer to the detected vectors
+ * @param Capture timestamp of the depth map
+ * @param Mask of the cameras which detected something
+ */
+void fillPositionPacket(TPositionPacket* content, const TKalmanTracker* kalman, const TVecList* list, unsigned int timestamp, int cameraMask);
+
+/**
+ * Writes a position packet in its wire format.
+ * Returns the length of the packet, POSITIONPACKETSIZE.
+ *
+ * @param Pointer to the packet, at least POSITIONPACKETSIZE bytes long
+ * @param Pointer to the content of the packet, its version is ignored
+ */
+int encodePositionPacket(char* packet, const TPositionPacket* content);
+
+/**
+ * Reads a position packet from its wire format.
+ * Returns 0 if the operation is a success and 1 if the packet is too short, of another type or version, or corrupted.
+ *
+ * @param Pointer to the packet
+ * @param Length of the packet in bytes
+ * @param Pointer to the content of the packet
+ */
+int decodePositionPacket(const char* packet, int length, TPositionPacket* content);
+
+/**
+ * Returns the wall clock time in microseconds since the epoch, as used by position packets.
+ */
+uint64_t packetTime();
@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "kinectPipeline.h"
+#include "kinectDense.h"
+#include "kinectCluster.h"
+
+/**
+ * Function executed in a thread to detect the drone with one camera at each step of the pool.
+ *
+ * @param Pointer to the detection worker
+ */
+static void *detectionLoop(void *pArg){
+	TDetectionWorker* pWorker = pArg;
+	TDetectionPool* pool = pWorker->pool;
+	int i = pWorker->index;
+	struct timespec start, middle, end;
+	TDetectionParams params;
+	short* data;
+	int step, generation = 0;
+	//the cluster grid of the worker is reused at each depth map, without it one is allocated each time
+	TClusterGrid grid;
+	TClusterGrid* pGrid = createClusterGrid(&grid, pool->tolerance, CLUSTERXYZ, 64)? NULL : &grid;
+	while(1){
+		//wait for the next step
+		pthread_mutex_lock(&(pool->lock));
+		while(pool->generation == generation && atomic_load(&(pool->running))){
+			pthread_cond_wait(&(pool->wake), &(pool->lock));
+		}
+		generation = pool->generation;
+		pthread_mutex_unlock(&(pool->lock));
+		if(!atomic_load(&(pool->running))){ break; }
+		//detect in the newest depth map and convert to the base of camera 0
+		pool->status[i] = acquireFrame(&(pool->capture[i]), &data, &(pool->timestamp[i]));
+		if(pool->status[i] == 0){
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			if(pool->useBackground){
+				updateChangeMask(&(pool->change[i]), data);
+				subtractBackground(&(pool->background[i]), data, pool->foreground[i], &(pool->change[i]));
+				data = pool->foreground[i];
+			}
+			if(pool->useBudget){
+				getDetectionParams(&params);
+				pool->window[i].nbSamples = budgetSamples(&(pool->budget[i]), params.nbIterations);
+			}
+			clock_gettime(CLOCK_MONOTONIC, &middle);
+			detectDroneWindow(data, &(pool->list[i]), pool->vecDistance, &(pool->window[i]), &(pool->random[i]), pGrid);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			long sampleTime = (end.tv_sec - middle.tv_sec)*1000000000L + (end.tv_nsec - middle.tv_nsec);
+			if(i > 0){
+				transformVecList(pool->cams[i].base, &(pool->list[i]));
+			}
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			long time = (end.tv_sec - start.tv_sec)*1000000000L + (end.tv_nsec - start.tv_nsec);
+			recordLatency(&(pool->detectTime[i]), time);
+			if(pool->useBudget){
+				pool->floor[i] = updateSampleBudget(&(pool->budget[i]), time - sampleTime, sampleTime, pool->window[i].nbSamples);
+			}
+		}
+		//fuse the lists two by two, list i receives list i+step
+		pool->fused[i] = pool->list[i];
+		for(step=1; step<pool->nbCams; step*=2){
+			pthread_barrier_wait(&(pool->reduce));
+			if(i%(2*step) == 0 && i+step < pool->nbCams){
+				fusePointList(&(pool->fused[i]), &(pool->fused[i+step]), pool->tolerance, pool->vecDistance);
+			}
+		}
+		//signal the end of the step
+		pthread_mutex_lock(&(pool->lock));
+		if(--(pool->pending) == 0){
+			pthread_cond_signal(&(pool->idle));
+		}
+		pthread_mutex_unlock(&(pool->lock));
+	}
+	if(pGrid != NULL){ freeClusterGrid(pGrid); }
+	pthread_exit(NULL);
+}
+
+/**
+ * Starts the acquisition and detection threads of several cameras.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the detection pool
+ * @param Pointer to the cameras, camera 0 gives the base of the fused vectors
+ * @param Number of cameras, at most MAXCAMERAS
+ * @param Tolerance for fusing two vectors of different cameras
+ * @param Function used to determine the distance between two vectors
+ */
+int startDetectionPool(TDetectionPool* pool, TDepthCamera* cams, int nbCams, float tolerance, float vecDistance(const TVec4D*, const TVec4D*)){
+	int i, j;
+	if(nbCams < 1 || nbCams > MAXCAMERAS){ return 1; }
+	pool->nbCams = nbCams;
+	pool->cams = cams;
+	pool->tolerance = tolerance;
+	pool->vecDistance = vecDistance;
+	atomic_init(&(pool->running), 1);
+	pool->useBackground = 0;
+	pool->useBudget = 0;
+	pool->floorMask = 0;
+	pool->generation = 0;
+	pool->pending = 0;
+	pthread_mutex_init(&(pool->lock), NULL);
+	pthread_cond_init(&(pool->wake), NULL);
+	pthread_cond_init(&(pool->idle), NULL);
+	pthread_barrier_init(&(pool->reduce), NULL, nbCams);
+	pool->cameraMask = 0;
+	for(i=0; i<nbCams; i++){
+		resetVecList(&(pool->list[i]));
+		pool->window[i].ratio = 0;
+		pool->window[i].nbSamples = 0;
+		pool->window[i].base = (i > 0)? cams[i].base : NULL;
+		pool->floor[i] = 0;
+		pool->status[i] = 1;
+		pool->timestamp[i] = 0;
+		seedRandom(&(pool->random[i]), time(NULL), cams[i].id);
+		snprintf(pool->detectName[i], sizeof(pool->detectName[i]), "detect %d", cams[i].id);
+		initHistogram(&(pool->detectTime[i]), pool->detectName[i]);
+		if(startCapture(&(pool->capture[i]), &(cams[i]))){
+			//no worker was started yet
+			for(j=0; j<i; j++){ stopCapture(&(pool->capture[j])); }
+			pool->nbCams = 0;
+			stopDetectionPool(pool);
+			return 1;
+		}
+	}
+	pool->nbCams = 0;
+	for(i=0; i<nbCams; i++){
+		pool->worker[i].pool = pool;
+		pool->worker[i].index = i;
+		if(pthread_create(&(pool->worker[i].thread), NULL, detectionLoop, &(pool->worker[i]))){
+			//no step was started, the workers only wait for the stop
+			for(j=i; j<nbCams; j++){ stopCapture(&(pool->capture[j])); }
+			stopDetectionPool(pool);
+			return 1;
+		}
+		pool->nbCams++;
+	}
+	return 0;
+}
+
+/**
+ * Removes the background of the depth maps of all cameras before detection.
+ * Must be called before the first step of the pool.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the detection pool
+ * @param Number of depth maps used to learn the background
+ * @param Number of depth maps between two updates of the background
+ */
+int enableBackground(TDetectionPool* pool, int learnFrames, int updateInterval){
+	int i;
+	for(i=0; i<pool->nbCams; i++){
+		pool->foreground[i] = malloc(DEPTHSIZE*sizeof(short));
+		if(pool->foreground[i] == NULL || createBackground(&(pool->background[i]), learnFrames, updateInterval)){
+			free(pool->foreground[i]);
+			break;
+		}
+		if(createChangeMask(&(pool->change[i]), CHANGETHRESHOLD)){
+			free(pool->foreground[i]);
+			freeBackground(&(pool->background[i]));
+			break;
+		}
+	}
+	if(i < pool->nbCams){
+		for(i--; i>=0; i--){
+			free(pool->foreground[i]);
+			freeBackground(&(pool->background[i]));
+			freeChangeMask(&(pool->change[i]));
+		}
+		return 1;
+	}
+	pool->useBackground = 1;
+	return 0;
+}
+
+/**
+ * Adapts the number of samples of each camera to a deadline per depth map, see TSampleBudget.
+ * Must be called before the first step of the pool.
+ *
+ * @param Pointer to the detection pool
+ * @param Deadline of the processing of a depth map in milliseconds
+ * @param Minimum number of samples of a depth map
+ */
+void enableBudget(TDetectionPool* pool, double deadline, int minSamples){
+	int i;
+	for(i=0; i<pool->nbCams; i++){
+		initSampleBudget(&(pool->budget[i]), deadline, minSamples);
+	}
+	pool->useBudget = 1;
+}
+
+/**
+ * Seeds the pseudo-random number generators of all cameras, to make the detection reproducible.
+ * The generator of each camera uses the id of the camera as stream.
+ *
+ * @param Pointer to the detection pool
+ * @param Seed of the generators
+ */
+void seedDetectionPool(TDetectionPool* pool, uint64_t seed){
+	int i;
+	for(i=0; i<pool->nbCams; i++){
+		seedRandom(&(pool->random[i]), seed, pool->cams[i].id);
+	}
+}
+
+/**
+ * Detects the drone in the newest depth map of each camera and fuses the vectors of all cameras.
+ * Parameters published with setDetectionParams replace the tolerance of the pool.
+ * Returns 0 if at least one camera had a new depth map, 1 if none had and -1 if an acquisition failed.
+ *
+ * @param Pointer to the detection pool
+ * @param Pointer to the fused vector list
+ */
+int runDetectionPool(TDetectionPool* pool, TVecList* fusedList){
+	int i, ret = 1;
+	TDetectionParams params;
+	//published parameters change the fusion tolerance between two steps
+	if(getDetectionParams(&params)){
+		pool->tolerance = params.fusionTolerance;
+	}
+	//start a step and wait for all workers
+	pthread_mutex_lock(&(pool->lock));
+	pool->pending = pool->nbCams;
+	pool->generation++;
+	pthread_cond_broadcast(&(pool->wake));
+	while(pool->pending > 0){
+		pthread_cond_wait(&(pool->idle), &(pool->lock));
+	}
+	pthread_mutex_unlock(&(pool->lock));
+	pool->cameraMask = 0;
+	pool->floorMask = 0;
+	for(i=0; i<pool->nbCams; i++){
+		if(pool->floor[i]){
+			pool->floorMask |= 1 << i;
+			pool->floor[i] = 0;
+		}
+		if(pool->status[i] == -1){ return -1; }
+		if(pool->status[i] == 0){
+			ret = 0;
+			if(pool->list[i].n > 0){ pool->cameraMask |= 1 << i; }
+		}
+	}
+	*fusedList = pool->fused[0];
+	return ret;
+}
+
+/**
+ * Stops all the threads of a detection pool.
+ *
+ * @param Pointer to the detection pool
+ */
+void stopDetectionPool(TDetectionPool* pool){
+	int i;
+	pthread_mutex_lock(&(pool->lock));
+	atomic_store(&(pool->running), 0);
+	pthread_cond_broadcast(&(pool->wake));
+	pthread_mutex_unlock(&(pool->lock));
+	for(i=0; i<pool->nbCams; i++){
+		pthread_join(pool->worker[i].thread, NULL);
+		stopCapture(&(pool->capture[i]));
+	}
+	for(i=0; pool->useBackground && i<pool->nbCams; i++){
+		free(pool->foreground[i]);
+		freeBackground(&(pool->background[i]));
+		freeChangeMask(&(pool->change[i]));
+	}
+	pool->useBackground = 0;
+	pthread_barrier_destroy(&(pool->reduce));
+	pthread_cond_destroy(&(pool->wake));
+	pthread_cond_destroy(&(pool->idle));
+	pthread_mutex_destroy(&(pool->lock));
+}
+
+/**
+ * Displays the grab and detection times of each camera, and their budgets if any.
+ *
+ * @param Pointer to the output file
+ * @param Pointer to the detection pool
+ */
+void displayDetectionPool(FILE* pFile, const TDetectionPool* pool){
+	int i;
+	for(i=0; i<pool->nbCams; i++){
+		displayHistogram(pFile, &(pool->capture[i].grabTime));
+		displayHistogram(pFile, &(pool->detectTime[i]));
+		if(pool->useBudget){
+			displaySampleBudget(pFile, pool->detectName[i], &(pool->budget[i]));
+		}
+	}
+}
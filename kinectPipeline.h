@@ -0,0 +1,132 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "kinectDetectionUtil.h"
+#include "kinectCapture.h"
+#include "kinectProfile.h"
+#include "kinectBackground.h"
+#include "kinectBudget.h"
+
+/// Structure representing a detection thread, the pool is a pointer to its TDetectionPool.
+typedef struct{
+	void* pool;
+	int index;
+	pthread_t thread;
+}TDetectionWorker;
+
+/// Structure representing the pool of threads detecting the drone with several cameras.
+/// Each camera has an acquisition thread and a detection thread. The detected vectors are converted to the base
+/// of camera 0 with the base of their camera, then the lists of all cameras are fused two by two in parallel.
+/// The sampling window of each camera is set by the caller before each step, its base is the one of the camera
+/// so that the floor and the ceiling found by camera 0 are converted to the other cameras.
+/// Each camera has its own pseudo-random number generator, seeded with the time by startDetectionPool.
+/// Each worker keeps its cluster grid between depth maps, so that detection does not allocate memory.
+/// The status of each camera is the result of its last acquireFrame, its list is kept when no new depth map is available.
+/// The timestamp of each camera is the one of its last depth map, the camera mask has bit i set if camera i
+/// detected something in a new depth map during the last step.
+/// With a background model, detection only uses the foreground of each depth map,
+/// which is only extracted again in the tiles changed since the previous depth map.
+/// With a budget, the number of samples of each camera is adapted to a deadline per depth map,
+/// the floor mask has bit i set if the minimum number of samples of camera i stopped fitting in the deadline during the last step.
+/// A step starts when the generation changes and ends when no worker is pending.
+typedef struct{
+	int nbCams;
+	TDepthCamera* cams;
+	TCaptureThread capture[MAXCAMERAS];
+	TVecList list[MAXCAMERAS];
+	TVecList fused[MAXCAMERAS];
+	TSamplingWindow window[MAXCAMERAS];
+	TRandom random[MAXCAMERAS];
+	int useBackground;
+	TBackground background[MAXCAMERAS];
+	short* foreground[MAXCAMERAS];
+	TChangeMask change[MAXCAMERAS];
+	int useBudget;
+	TSampleBudget budget[MAXCAMERAS];
+	int floor[MAXCAMERAS];
+	int floorMask;
+	int status[MAXCAMERAS];
+	unsigned int timestamp[MAXCAMERAS];
+	int cameraMask;
+	float tolerance;
+	float (*vecDistance)(const TVec4D*, const TVec4D*);
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t idle;
+	int generation;
+	int pending;
+	pthread_barrier_t reduce;
+	TDetectionWorker worker[MAXCAMERAS];
+	atomic_int running;
+	THistogram detectTime[MAXCAMERAS];
+	char detectName[MAXCAMERAS][16];
+}TDetectionPool;
+
+
+/**
+ * Starts the acquisition and detection threads of several cameras.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the detection pool
+ * @param Pointer to the cameras, camera 0 gives the base of the fused vectors
+ * @param Number of cameras, at most MAXCAMERAS
+ * @param Tolerance for fusing two vectors of different cameras
+ * @param Function used to determine the distance between two vectors
+ */
+int startDetectionPool(TDetectionPool* pool, TDepthCamera* cams, int nbCams, float tolerance, float vecDistance(const TVec4D*, const TVec4D*));
+
+/**
+ * Removes the background of the depth maps of all cameras before detection.
+ * Must be called before the first step of the pool.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the detection pool
+ * @param Number of depth maps used to learn the background
+ * @param Number of depth maps between two updates of the background
+ */
+int enableBackground(TDetectionPool* pool, int learnFrames, int updateInterval);
+
+/**
+ * Adapts the number of samples of each camera to a deadline per depth map, see TSampleBudget.
+ * Must be called before the first step of the pool.
+ *
+ * @param Pointer to the detection pool
+ * @param Deadline of the processing of a depth map in milliseconds
+ * @param Minimum number of samples of a depth map
+ */
+void enableBudget(TDetectionPool* pool, double deadline, int minSamples);
+
+/**
+ * Seeds the pseudo-random number generators of all cameras, to make the detection reproducible.
+ * The generator of each camera uses the id of the camera as stream.
+ *
+ * @param Pointer to the detection pool
+ * @param Seed of the generators
+ */
+void seedDetectionPool(TDetectionPool* pool, uint64_t seed);
+
+/**
+ * Detects the drone in the newest depth map of each camera and fuses the vectors of all cameras.
+ * Parameters published with setDetectionParams replace the tolerance of the pool.
+ * Returns 0 if at least one camera had a new depth map, 1 if none had and -1 if an acquisition failed.
+ *
+ * @param Pointer to the detection pool
+ * @param Pointer to the fused vector list
+ */
+int runDetectionPool(TDetectionPool* pool, TVecList* fusedList);
+
+/**
+ * Stops all the threads of a detection pool.
+ *
+ * @param Pointer to the detection pool
+ */
+void stopDetectionPool(TDetectionPool* pool);
+
+/**
+ * Displays the grab and detection times of each camera, and their budgets if any.
+ *
+ * @param Pointer to the output file
+ * @param Pointer to the detection pool
+ */
+void displayDetectionPool(FILE* pFile, const TDetectionPool* pool);
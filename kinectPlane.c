@@ -0,0 +1,141 @@
+#include <math.h>
+#include "kinectPlane.h"
+
+/**
+ * Returns the signed distance of a point of a point cloud to a plane.
+ *
+ * @param Pointer to the plane
+ * @param Pointer to the point cloud
+ * @param Index of the point
+ */
+static float cloudDistance(const TPlane* plane, const TPointCloud* cloud, int i){
+	return plane->a*cloud->x[i] + plane->b*cloud->y[i] + plane->c*cloud->z[i] + plane->d;
+}
+
+/**
+ * Returns a random point of a point cloud on one side of the camera, or -1 if none was found.
+ *
+ * @param Pointer to the point cloud
+ * @param Side of the plane (PLANEFLOOR or PLANECEILING)
+ * @param Pointer to the pseudo-random number generator
+ */
+static int randomPoint(const TPointCloud* cloud, int side, TRandom* random){
+	int tries;
+	for(tries=0; tries<64; tries++){
+		int i = randomRange(random, cloud->n);
+		if((cloud->z[i] > 0) == (side == PLANECEILING)){ return i; }
+	}
+	return -1;
+}
+
+/**
+ * Finds the floor or the ceiling in a point cloud with RANSAC.
+ * Planes through 3 random points below (floor) or above (ceiling) the camera are scored by their number of inliers,
+ * closer than PLANETHRESHOLD, on PLANESAMPLES random points. Their normal must be within about 30 degrees of the z axis.
+ * The best plane is then fitted again by least squares on all its inliers.
+ * The normal of the plane points towards the camera.
+ * Returns 0 if the operation is a success and 1 if no plane has PLANEMININLIERS inliers.
+ *
+ * @param Pointer to the point cloud
+ * @param Side of the plane (PLANEFLOOR or PLANECEILING)
+ * @param Pointer to the pseudo-random number generator
+ * @param Pointer to the plane
+ * @param Pointer to the number of inliers of the plane
+ */
+int fitPlane(const TPointCloud* cloud, int side, TRandom* random, TPlane* plane, int* nbInliers){
+	int samples[PLANESAMPLES];
+	int i, it, nbSamples = 0, best = 0;
+	TPlane candidate, bestPlane;
+	*nbInliers = 0;
+	if(cloud->n < 3){ return 1; }
+	//points scoring the candidates
+	for(i=0; i<PLANESAMPLES; i++){
+		int p = randomPoint(cloud, side, random);
+		if(p >= 0){ samples[nbSamples++] = p; }
+	}
+	for(it=0; it<PLANEITERATIONS && nbSamples >= 3; it++){
+		//plane through 3 random points
+		int p0 = samples[randomRange(random, nbSamples)], p1 = samples[randomRange(random, nbSamples)], p2 = samples[randomRange(random, nbSamples)];
+		float ux = cloud->x[p1] - cloud->x[p0], uy = cloud->y[p1] - cloud->y[p0], uz = cloud->z[p1] - cloud->z[p0];
+		float vx = cloud->x[p2] - cloud->x[p0], vy = cloud->y[p2] - cloud->y[p0], vz = cloud->z[p2] - cloud->z[p0];
+		candidate.a = uy*vz - uz*vy;
+		candidate.b = uz*vx - ux*vz;
+		candidate.c = ux*vy - uy*vx;
+		float norm = sqrtf(candidate.a*candidate.a + candidate.b*candidate.b + candidate.c*candidate.c);
+		if(norm < 1e-3f){ continue; }
+		candidate.a /= norm;
+		candidate.b /= norm;
+		candidate.c /= norm;
+		if(fabsf(candidate.c) < PLANEMINVERTICAL){ continue; }
+		candidate.d = -(candidate.a*cloud->x[p0] + candidate.b*cloud->y[p0] + candidate.c*cloud->z[p0]);
+		int n = 0;
+		for(i=0; i<nbSamples; i++){
+			n += fabsf(cloudDistance(&candidate, cloud, samples[i])) < PLANETHRESHOLD;
+		}
+		if(n > best){
+			best = n;
+			bestPlane = candidate;
+		}
+	}
+	if(best == 0){ return 1; }
+	//least squares fit of z = alpha*x + beta*y + gamma on all the inliers
+	double sxx = 0, sxy = 0, syy = 0, sx = 0, sy = 0, sxz = 0, syz = 0, sz = 0;
+	int n = 0;
+	for(i=0; i<cloud->n; i++){
+		if(fabsf(cloudDistance(&bestPlane, cloud, i)) >= PLANETHRESHOLD){ continue; }
+		double x = cloud->x[i], y = cloud->y[i], z = cloud->z[i];
+		sxx += x*x; sxy += x*y; syy += y*y;
+		sx += x; sy += y; sz += z;
+		sxz += x*z; syz += y*z;
+		n++;
+	}
+	*nbInliers = n;
+	if(n < PLANEMININLIERS){ return 1; }
+	//normal equations solved with Cramer's rule
+	double det = sxx*(syy*n - sy*sy) - sxy*(sxy*n - sy*sx) + sx*(sxy*sy - syy*sx);
+	if(fabs(det) < 1e-12){ return 1; }
+	double alpha = (sxz*(syy*n - sy*sy) - sxy*(syz*n - sy*sz) + sx*(syz*sy - syy*sz))/det;
+	double beta = (sxx*(syz*n - sy*sz) - sxz*(sxy*n - sy*sx) + sx*(sxy*sz - syz*sx))/det;
+	double gamma = (sxx*(syy*sz - sy*syz) - sxy*(sxy*sz - sx*syz) + sxz*(sxy*sy - syy*sx))/det;
+	//normal towards the camera, which is at the origin
+	double norm = sqrt(alpha*alpha + beta*beta + 1);
+	double sign = (gamma < 0)? 1 : -1;
+	plane->a = -alpha*sign/norm;
+	plane->b = -beta*sign/norm;
+	plane->c = sign/norm;
+	plane->d = -gamma*sign/norm;
+	return 0;
+}
+
+/**
+ * Finds the floor and the ceiling in a depth map and sets floorPlane and ceilingPlane,
+ * moved by PLANEMARGIN towards the camera. A plane which is not found is left unchanged.
+ * Returns 0 if both planes were found, 1 otherwise.
+ *
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud used for the conversion, with a capacity of at least DEPTHSIZE
+ * @param Pointer to the pseudo-random number generator
+ */
+int findFlightArea(const short* data, TPointCloud* cloud, TRandom* random){
+	TPlane floorP, ceilingP;
+	int nbFloor, nbCeiling, ret = 0;
+	//keep all the points for the search
+	TPlane oldFloor = floorPlane, oldCeiling = ceilingPlane;
+	setFlightArea(-1e9, 1e9);
+	depthToPointCloud(kinectIntrinsics(), data, cloud);
+	floorPlane = oldFloor;
+	ceilingPlane = oldCeiling;
+	if(fitPlane(cloud, PLANEFLOOR, random, &floorP, &nbFloor) == 0){
+		floorP.d -= PLANEMARGIN;
+		floorPlane = floorP;
+	}else{
+		ret = 1;
+	}
+	if(fitPlane(cloud, PLANECEILING, random, &ceilingP, &nbCeiling) == 0){
+		ceilingP.d -= PLANEMARGIN;
+		ceilingPlane = ceilingP;
+	}else{
+		ret = 1;
+	}
+	return ret;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "kinectDetectionUtil.h"
+#include "kinectDense.h"
+
+#define PLANETHRESHOLD 30
+#define PLANEITERATIONS 300
+#define PLANESAMPLES 4096
+#define PLANEMININLIERS 2000
+#define PLANEMINVERTICAL 0.85f
+#define PLANEMARGIN 100
+
+///sides of the camera where a plane is searched
+#define PLANEFLOOR 0
+#define PLANECEILING 1
+
+
+/**
+ * Finds the floor or the ceiling in a point cloud with RANSAC.
+ * Planes through 3 random points below (floor) or above (ceiling) the camera are scored by their number of inliers,
+ * closer than PLANETHRESHOLD, on PLANESAMPLES random points. Their normal must be within about 30 degrees of the z axis.
+ * The best plane is then fitted again by least squares on all its inliers.
+ * The normal of the plane points towards the camera.
+ * Returns 0 if the operation is a success and 1 if no plane has PLANEMININLIERS inliers.
+ *
+ * @param Pointer to the point cloud
+ * @param Side of the plane (PLANEFLOOR or PLANECEILING)
+ * @param Pointer to the pseudo-random number generator
+ * @param Pointer to the plane
+ * @param Pointer to the number of inliers of the plane
+ */
+int fitPlane(const TPointCloud* cloud, int side, TRandom* random, TPlane* plane, int* nbInliers);
+
+/**
+ * Finds the floor and the ceiling in a depth map and sets floorPlane and ceilingPlane,
+ * moved by PLANEMARGIN towards the camera. A plane which is not found is left unchanged.
+ * Returns 0 if both planes were found, 1 otherwise.
+ *
+ * @param Pointer to the depth map
+ * @param Pointer to the point cloud used for the conversion, with a capacity of at least DEPTHSIZE
+ * @param Pointer to the pseudo-random number generator
+ */
+int findFlightArea(const short* data, TPointCloud* cloud, TRandom* random);
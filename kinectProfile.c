@@ -0,0 +1,197 @@
+#include <signal.h>
+#include <string.h>
+#include "kinectProfile.h"
+
+///set by the signal handler
+static volatile sig_atomic_t profileSignal = 0;
+
+/**
+ * Returns the bucket of a duration.
+ *
+ * @param Duration in nanoseconds
+ */
+static int histogramBucket(unsigned long duration){
+	if(duration < PROFILESUB){ return duration; }
+	int shift = 63 - __builtin_clzl(duration) - PROFILESUBBITS;
+	return (shift+1)*PROFILESUB + (duration >> shift) - PROFILESUB;
+}
+
+/**
+ * Returns the highest duration of a bucket.
+ *
+ * @param Index of the bucket
+ */
+static unsigned long bucketDuration(int bucket){
+	if(bucket < PROFILESUB){ return bucket; }
+	int shift = bucket/PROFILESUB - 1;
+	unsigned long sub = bucket%PROFILESUB + PROFILESUB;
+	return ((sub+1) << shift) - 1;
+}
+
+/**
+ * Initializes a histogram.
+ *
+ * @param Pointer to the histogram
+ * @param Name of the histogram, must stay valid while the histogram is used
+ */
+void initHistogram(THistogram* histogram, const char* name){
+	int i;
+	histogram->name = name;
+	for(i=0; i<PROFILEBUCKETS; i++){
+		atomic_init(&(histogram->count[i]), 0);
+	}
+	atomic_init(&(histogram->total), 0);
+	atomic_init(&(histogram->max), 0);
+}
+
+/**
+ * Adds a duration to a histogram.
+ *
+ * @param Pointer to the histogram
+ * @param Duration in nanoseconds
+ */
+void recordLatency(THistogram* histogram, unsigned long duration){
+	atomic_fetch_add_explicit(&(histogram->count[histogramBucket(duration)]), 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&(histogram->total), duration, memory_order_relaxed);
+	unsigned long max = atomic_load_explicit(&(histogram->max), memory_order_relaxed);
+	while(duration > max && !atomic_compare_exchange_weak_explicit(&(histogram->max), &max, duration, memory_order_relaxed, memory_order_relaxed));
+}
+
+/**
+ * Returns the duration in nanoseconds below which a part of the recorded durations lie, 0 if the histogram is empty.
+ *
+ * @param Pointer to the histogram
+ * @param Part of the recorded durations, between 0 and 1
+ */
+unsigned long histogramPercentile(const THistogram* histogram, double part){
+	unsigned long counts[PROFILEBUCKETS], n = 0, sum = 0;
+	int i;
+	for(i=0; i<PROFILEBUCKETS; i++){
+		counts[i] = atomic_load_explicit(&(histogram->count[i]), memory_order_relaxed);
+		n += counts[i];
+	}
+	if(n == 0){ return 0; }
+	unsigned long rank = part*n;
+	if(rank >= n){ rank = n-1; }
+	for(i=0; i<PROFILEBUCKETS; i++){
+		sum += counts[i];
+		if(sum > rank){ break; }
+	}
+	//the highest duration of the bucket, but not above the maximum
+	unsigned long duration = bucketDuration(i);
+	unsigned long max = atomic_load_explicit(&(histogram->max), memory_order_relaxed);
+	return duration < max? duration : max;
+}
+
+/**
+ * Displays the number of durations, their mean, p50, p99, p99.9 and max in microseconds.
+ *
+ * @param Pointer to the output file
+ * @param Pointer to the histogram
+ */
+void displayHistogram(FILE* pFile, const THistogram* histogram){
+	unsigned long n = 0;
+	int i;
+	for(i=0; i<PROFILEBUCKETS; i++){
+		n += atomic_load_explicit(&(histogram->count[i]), memory_order_relaxed);
+	}
+	double total = atomic_load_explicit(&(histogram->total), memory_order_relaxed);
+	fprintf(pFile, "%-16s %9lu %9.1f %9.1f %9.1f %9.1f %9.1f\n", histogram->name, n, n? total*1e-3/n : 0,
+		histogramPercentile(histogram, 0.5)*1e-3, histogramPercentile(histogram, 0.99)*1e-3,
+		histogramPercentile(histogram, 0.999)*1e-3, atomic_load_explicit(&(histogram->max), memory_order_relaxed)*1e-3);
+}
+
+/**
+ * Initializes a profile without stages.
+ *
+ * @param Pointer to the profile
+ */
+void initProfile(TProfile* profile){
+	profile->nbStages = 0;
+	clock_gettime(CLOCK_MONOTONIC, &(profile->last));
+}
+
+/**
+ * Adds a stage to a profile.
+ * Returns the index of the stage, or -1 if there are already PROFILEMAXSTAGES stages.
+ *
+ * @param Pointer to the profile
+ * @param Name of the stage, must stay valid while the profile is used
+ */
+int addProfileStage(TProfile* profile, const char* name){
+	if(profile->nbStages >= PROFILEMAXSTAGES){ return -1; }
+	initHistogram(&(profile->stage[profile->nbStages]), name);
+	return profile->nbStages++;
+}
+
+/**
+ * Starts timing an iteration of a profiled loop.
+ *
+ * @param Pointer to the profile
+ */
+void profileStart(TProfile* profile){
+	clock_gettime(CLOCK_MONOTONIC, &(profile->last));
+}
+
+/**
+ * Records the time elapsed since the previous stage in a stage of a profile.
+ *
+ * @param Pointer to the profile
+ * @param Index of the stage
+ */
+void profileStage(TProfile* profile, int stage){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if(stage >= 0 && stage < profile->nbStages){
+		long duration = (now.tv_sec - profile->last.tv_sec)*1000000000L + (now.tv_nsec - profile->last.tv_nsec);
+		recordLatency(&(profile->stage[stage]), duration > 0? duration : 0);
+	}
+	profile->last = now;
+}
+
+/**
+ * Displays the histograms of all stages of a profile.
+ *
+ * @param Pointer to the output file
+ * @param Pointer to the profile
+ */
+void displayProfile(FILE* pFile, const TProfile* profile){
+	int i;
+	fprintf(pFile, "%-16s %9s %9s %9s %9s %9s %9s\n", "stage (us)", "count", "mean", "p50", "p99", "p99.9", "max");
+	for(i=0; i<profile->nbStages; i++){
+		displayHistogram(pFile, &(profile->stage[i]));
+	}
+}
+
+/**
+ * Function executed when the watched signal is received.
+ *
+ * @param Number of the signal
+ */
+static void profileSignalHandler(int signum){
+	profileSignal = 1;
+}
+
+/**
+ * Catches a signal to ask for the display of profiles.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Number of the signal, SIGUSR1 for example
+ */
+int watchProfileSignal(int signum){
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = profileSignalHandler;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	return sigaction(signum, &action, NULL) != 0;
+}
+
+/**
+ * Returns 1 once after each reception of the watched signal, 0 otherwise.
+ */
+int profileSignalled(){
+	if(!profileSignal){ return 0; }
+	profileSignal = 0;
+	return 1;
+}
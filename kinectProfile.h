@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#define PROFILESUBBITS 4
+#define PROFILESUB (1 << PROFILESUBBITS)
+#define PROFILEBUCKETS ((64 - PROFILESUBBITS + 1)*PROFILESUB)
+#define PROFILEMAXSTAGES 16
+
+/// Structure containing a histogram of durations in nanoseconds.
+/// Buckets are linear below PROFILESUB, then each power of two is split in PROFILESUB buckets,
+/// so a duration is known within 1/PROFILESUB of its value.
+/// Counters are atomic: one thread records while others may read.
+typedef struct{
+	const char* name;
+	atomic_ulong count[PROFILEBUCKETS];
+	atomic_ulong total;
+	atomic_ulong max;
+}THistogram;
+
+/// Structure timing the successive stages of a loop.
+/// Each stage records the time elapsed since the previous stage or the start of the iteration.
+typedef struct{
+	THistogram stage[PROFILEMAXSTAGES];
+	int nbStages;
+	struct timespec last;
+}TProfile;
+
+
+/**
+ * Initializes a histogram.
+ *
+ * @param Pointer to the histogram
+ * @param Name of the histogram, must stay valid while the histogram is used
+ */
+void initHistogram(THistogram* histogram, const char* name);
+
+/**
+ * Adds a duration to a histogram.
+ *
+ * @param Pointer to the histogram
+ * @param Duration in nanoseconds
+ */
+void recordLatency(THistogram* histogram, unsigned long duration);
+
+/**
+ * Returns the duration in nanoseconds below which a part of the recorded durations lie, 0 if the histogram is empty.
+ *
+ * @param Pointer to the histogram
+ * @param Part of the recorded durations, between 0 and 1
+ */
+unsigned long histogramPercentile(const THistogram* histogram, double part);
+
+/**
+ * Displays the number of durations, their mean, p50, p99, p99.9 and max in microseconds.
+ *
+ * @param Pointer to the output file
+ * @param Pointer to the histogram
+ */
+void displayHistogram(FILE* pFile, const THistogram* histogram);
+
+/**
+ * Initializes a profile without stages.
+ *
+ * @param Pointer to the profile
+ */
+void initProfile(TProfile* profile);
+
+/**
+ * Adds a stage to a profile.
+ * Returns the index of the stage, or -1 if there are already PROFILEMAXSTAGES stages.
+ *
+ * @param Pointer to the profile
+ * @param Name of the stage, must stay valid while the profile is used
+ */
+int addProfileStage(TProfile* profile, const char* name);
+
+/**
+ * Starts timing an iteration of a profiled loop.
+ *
+ * @param Pointer to the profile
+ */
+void profileStart(TProfile* profile);
+
+/**
+ * Records the time elapsed since the previous stage in a stage of a profile.
+ *
+ * @param Pointer to the profile
+ * @param Index of the stage
+ */
+void profileStage(TProfile* profile, int stage);
+
+/**
+ * Displays the histograms of all stages of a profile.
+ *
+ * @param Pointer to the output file
+ * @param Pointer to the profile
+ */
+void displayProfile(FILE* pFile, const TProfile* profile);
+
+/**
+ * Catches a signal to ask for the display of profiles.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Number of the signal, SIGUSR1 for example
+ */
+int watchProfileSignal(int signum);
+
+/**
+ * Returns 1 once after each reception of the watched signal, 0 otherwise.
+ */
+int profileSignalled();
@@ -0,0 +1,283 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/uio.h>
+#include "kinectPublisher.h"
+
+/**
+ * Converts an address given as "ip" or "ip:port" into a socket address.
+ * Returns 0 if the operation is a success and 1 if the address is invalid.
+ *
+ * @param Address to convert
+ * @param Pointer to the socket address
+ */
+static int parseAddress(const char* address, struct sockaddr_in* addr){
+	char ip[INET_ADDRSTRLEN];
+	int port = PUBLISHERPORT;
+	const char* colon = strchr(address, ':');
+	int length = colon? colon - address : strlen(address);
+	if(length <= 0 || length >= INET_ADDRSTRLEN){
+		return 1;
+	}
+	memcpy(ip, address, length);
+	ip[length] = '\0';
+	if(colon){
+		char* end;
+		port = strtol(colon+1, &end, 10);
+		if(*end != '\0' || port <= 0 || port > 65535){
+			return 1;
+		}
+	}
+	memset(addr, 0, sizeof(*addr));
+	addr->sin_family = AF_INET;
+	addr->sin_port = htons(port);
+	return inet_aton(ip, &(addr->sin_addr)) == 0;
+}
+
+/**
+ * Returns the index of a subscriber, -1 if unknown. The publisher must be locked.
+ *
+ * @param Pointer to the publisher
+ * @param Pointer to the socket address of the subscriber
+ */
+static int findSubscriber(const TPublisher* pub, const struct sockaddr_in* addr){
+	int i;
+	for(i=0; i<pub->nbSubscribers; i++){
+		if(pub->subscriber[i].sin_addr.s_addr == addr->sin_addr.s_addr && pub->subscriber[i].sin_port == addr->sin_port){
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Opens the UDP socket of a publisher without any subscriber.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the publisher
+ */
+int openPublisher(TPublisher* pub){
+	pub->nbSubscribers = 0;
+	pub->multicast = 0;
+	pub->nbPackets = 0;
+	pub->nbErrors = 0;
+	if((pub->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == -1){
+		return 1;
+	}
+	if(pthread_mutex_init(&(pub->lock), NULL)){
+		close(pub->socket);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Closes the socket of a publisher.
+ *
+ * @param Pointer to the publisher
+ */
+void closePublisher(TPublisher* pub){
+	close(pub->socket);
+	pthread_mutex_destroy(&(pub->lock));
+	pub->nbSubscribers = 0;
+}
+
+/**
+ * Adds a subscriber given as "ip" or "ip:port", PUBLISHERPORT by default.
+ * A multicast group address (224.0.0.0 to 239.255.255.255) makes the publisher send to the group.
+ * Adding a subscriber twice has no effect.
+ * Returns 0 if the operation is a success and 1 if the address is invalid or the list is full.
+ *
+ * @param Pointer to the publisher
+ * @param Address of the subscriber
+ */
+int addSubscriber(TPublisher* pub, const char* address){
+	struct sockaddr_in addr;
+	int failed = 0;
+	if(parseAddress(address, &addr)){
+		return 1;
+	}
+	//packets to a group stay on the local network unless setMulticastOptions says otherwise
+	if(IN_MULTICAST(ntohl(addr.sin_addr.s_addr)) && !pub->multicast){
+		if(setMulticastOptions(pub, PUBLISHERTTL, NULL)){
+			return 1;
+		}
+	}
+	pthread_mutex_lock(&(pub->lock));
+	if(findSubscriber(pub, &addr) < 0){
+		if(pub->nbSubscribers < MAXSUBSCRIBERS){
+			pub->subscriber[pub->nbSubscribers++] = addr;
+		}else{
+			failed = 1;
+		}
+	}
+	pthread_mutex_unlock(&(pub->lock));
+	return failed;
+}
+
+/**
+ * Removes a subscriber given as "ip" or "ip:port".
+ * Returns 0 if the operation is a success and 1 if the subscriber is unknown.
+ *
+ * @param Pointer to the publisher
+ * @param Address of the subscriber
+ */
+int removeSubscriber(TPublisher* pub, const char* address){
+	struct sockaddr_in addr;
+	int i;
+	if(parseAddress(address, &addr)){
+		return 1;
+	}
+	pthread_mutex_lock(&(pub->lock));
+	i = findSubscriber(pub, &addr);
+	if(i >= 0){
+		pub->subscriber[i] = pub->subscriber[--pub->nbSubscribers];
+	}
+	pthread_mutex_unlock(&(pub->lock));
+	return i < 0;
+}
+
+/**
+ * Adds the subscribers listed in a text file, one address per line.
+ * Empty lines and lines starting with '#' are ignored.
+ * Returns the number of subscribers added, or -1 if the file cannot be read or contains an invalid address.
+ *
+ * @param Pointer to the publisher
+ * @param Name of the file
+ */
+int loadSubscribers(TPublisher* pub, const char* fileName){
+	char line[256];
+	int n = 0;
+	FILE* file = fopen(fileName, "r");
+	if(file == NULL){
+		return -1;
+	}
+	while(fgets(line, sizeof(line), file)){
+		//trim the line
+		char* address = line + strspn(line, " \t");
+		address[strcspn(address, " \t\r\n")] = '\0';
+		if(address[0] == '\0' || address[0] == '#'){
+			continue;
+		}
+		if(addSubscriber(pub, address)){
+			fclose(file);
+			return -1;
+		}
+		n++;
+	}
+	fclose(file);
+	return n;
+}
+
+/**
+ * Sets the time to live and the interface of the multicast packets.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the publisher
+ * @param Maximum number of routers crossed by a packet
+ * @param IP address of the interface, NULL for the default one
+ */
+int setMulticastOptions(TPublisher* pub, int ttl, const char* interface){
+	unsigned char value = ttl;
+	struct in_addr addr;
+	if(setsockopt(pub->socket, IPPROTO_IP, IP_MULTICAST_TTL, &value, sizeof(value))){
+		return 1;
+	}
+	if(interface){
+		if(inet_aton(interface, &addr) == 0 || setsockopt(pub->socket, IPPROTO_IP, IP_MULTICAST_IF, &addr, sizeof(addr))){
+			return 1;
+		}
+	}
+	pub->multicast = 1;
+	return 0;
+}
+
+/**
+ * Sends a packet to all the subscribers with one system call.
+ * Returns 0 if the operation is a success and 1 if the packet could not be sent to all subscribers.
+ *
+ * @param Pointer to the publisher
+ * @param Pointer to the packet
+ * @param Length of the packet in bytes
+ */
+int publishPacket(TPublisher* pub, const void* packet, int length){
+	long errors = pub->nbErrors;
+	sendPacketFrom(pub, packet, length, 0);
+	return pub->nbErrors != errors;
+}
+
+/**
+ * Sends a packet to the subscribers from a given index, with as few system calls as possible.
+ * Subscribers which cannot be reached are counted in nbErrors and skipped.
+ * With a non-blocking socket, the sending stops when the socket buffer is full (EAGAIN or ENOBUFS).
+ * Returns the index of the first subscriber which did not receive the packet, the number of subscribers if all did.
+ *
+ * @param Pointer to the publisher
+ * @param Pointer to the packet
+ * @param Length of the packet in bytes
+ * @param Index of the first subscriber
+ */
+int sendPacketFrom(TPublisher* pub, const void* packet, int length, int first){
+	struct mmsghdr message[MAXSUBSCRIBERS];
+	struct iovec data = {(void*)packet, length};
+	int i, sent, n;
+	pthread_mutex_lock(&(pub->lock));
+	n = pub->nbSubscribers;
+	sent = (first < n)? first : n;
+	memset(message, 0, n*sizeof(struct mmsghdr));
+	for(i=sent; i<n; i++){
+		message[i].msg_hdr.msg_name = &(pub->subscriber[i]);
+		message[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		message[i].msg_hdr.msg_iov = &data;
+		message[i].msg_hdr.msg_iovlen = 1;
+	}
+	//sendmmsg stops at the first subscriber which cannot be reached, the following ones are retried
+	while(sent < n){
+		int r = sendmmsg(pub->socket, message + sent, n - sent, 0);
+		if(r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)){
+			break;
+		}
+		if(r < 0 && errno == EINTR){
+			continue;
+		}
+		if(r <= 0){
+			//skip the failing subscriber
+			pub->nbErrors++;
+			r = 1;
+		}
+		sent += r;
+	}
+	if(sent == n){
+		pub->nbPackets++;
+	}
+	pthread_mutex_unlock(&(pub->lock));
+	return sent;
+}
+
+/**
+ * Returns the number of subscribers of a publisher.
+ *
+ * @param Pointer to the publisher
+ */
+int subscriberCount(TPublisher* pub){
+	pthread_mutex_lock(&(pub->lock));
+	int n = pub->nbSubscribers;
+	pthread_mutex_unlock(&(pub->lock));
+	return n;
+}
+
+/**
+ * Makes the socket of a publisher non-blocking, sendPacketFrom then returns instead of waiting for the network.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the publisher
+ */
+int setPublisherNonBlocking(TPublisher* pub){
+	int flags = fcntl(pub->socket, F_GETFL, 0);
+	return flags == -1 || fcntl(pub->socket, F_SETFL, flags | O_NONBLOCK) == -1;
+}
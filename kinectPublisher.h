@@ -0,0 +1,117 @@
+#pragma once
+
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define MAXSUBSCRIBERS 64
+#define PUBLISHERPORT 5005
+#define PUBLISHERTTL 1
+
+/// Structure representing the UDP socket sending every packet to a list of subscribers.
+/// A packet reaches all the subscribers with a single sendmmsg, whatever their number.
+/// Subscribers may be added or removed from another thread while packets are published.
+/// Multicast groups are ordinary subscribers, the socket options are set when the first group is added.
+typedef struct{
+	int socket;
+	struct sockaddr_in subscriber[MAXSUBSCRIBERS];
+	int nbSubscribers;
+	int multicast;
+	long nbPackets;
+	long nbErrors;
+	pthread_mutex_t lock;
+}TPublisher;
+
+
+/**
+ * Opens the UDP socket of a publisher without any subscriber.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the publisher
+ */
+int openPublisher(TPublisher* pub);
+
+/**
+ * Closes the socket of a publisher.
+ *
+ * @param Pointer to the publisher
+ */
+void closePublisher(TPublisher* pub);
+
+/**
+ * Adds a subscriber given as "ip" or "ip:port", PUBLISHERPORT by default.
+ * A multicast group address (224.0.0.0 to 239.255.255.255) makes the publisher send to the group.
+ * Adding a subscriber twice has no effect.
+ * Returns 0 if the operation is a success and 1 if the address is invalid or the list is full.
+ *
+ * @param Pointer to the publisher
+ * @param Address of the subscriber
+ */
+int addSubscriber(TPublisher* pub, const char* address);
+
+/**
+ * Removes a subscriber given as "ip" or "ip:port".
+ * Returns 0 if the operation is a success and 1 if the subscriber is unknown.
+ *
+ * @param Pointer to the publisher
+ * @param Address of the subscriber
+ */
+int removeSubscriber(TPublisher* pub, const char* address);
+
+/**
+ * Adds the subscribers listed in a text file, one address per line.
+ * Empty lines and lines starting with '#' are ignored.
+ * Returns the number of subscribers added, or -1 if the file cannot be read or contains an invalid address.
+ *
+ * @param Pointer to the publisher
+ * @param Name of the file
+ */
+int loadSubscribers(TPublisher* pub, const char* fileName);
+
+/**
+ * Sets the time to live and the interface of the multicast packets.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the publisher
+ * @param Maximum number of routers crossed by a packet
+ * @param IP address of the interface, NULL for the default one
+ */
+int setMulticastOptions(TPublisher* pub, int ttl, const char* interface);
+
+/**
+ * Sends a packet to all the subscribers with one system call.
+ * Returns 0 if the operation is a success and 1 if the packet could not be sent to all subscribers.
+ *
+ * @param Pointer to the publisher
+ * @param Pointer to the packet
+ * @param Length of the packet in bytes
+ */
+int publishPacket(TPublisher* pub, const void* packet, int length);
+
+/**
+ * Sends a packet to the subscribers from a given index, with as few system calls as possible.
+ * Subscribers which cannot be reached are counted in nbErrors and skipped.
+ * With a non-blocking socket, the sending stops when the socket buffer is full (EAGAIN or ENOBUFS).
+ * Returns the index of the first subscriber which did not receive the packet, the number of subscribers if all did.
+ *
+ * @param Pointer to the publisher
+ * @param Pointer to the packet
+ * @param Length of the packet in bytes
+ * @param Index of the first subscriber
+ */
+int sendPacketFrom(TPublisher* pub, const void* packet, int length, int first);
+
+/**
+ * Returns the number of subscribers of a publisher.
+ *
+ * @param Pointer to the publisher
+ */
+int subscriberCount(TPublisher* pub);
+
+/**
+ * Makes the socket of a publisher non-blocking, sendPacketFrom then returns instead of waiting for the network.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the publisher
+ */
+int setPublisherNonBlocking(TPublisher* pub);
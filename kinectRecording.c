@@ -0,0 +1,319 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "kinectRecording.h"
+
+#define MAXBLOCKSIZE (4*DEPTHSIZE+16)
+
+/**
+ * Writes an unsigned integer using 7 bits per byte.
+ * Returns the address following the written bytes.
+ *
+ * @param Pointer to the output
+ * @param Value to write
+ */
+static unsigned char* writeVarint(unsigned char* out, unsigned int value){
+	while(value >= 0x80){
+		*out++ = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	*out++ = value;
+	return out;
+}
+
+/**
+ * Reads an unsigned integer written with writeVarint.
+ * Returns the address following the read bytes or NULL if the end of the block is reached.
+ *
+ * @param Pointer to the input
+ * @param Pointer to the end of the block
+ * @param Pointer to the value
+ */
+static const unsigned char* readVarint(const unsigned char* in, const unsigned char* end, unsigned int* value){
+	int shift = 0;
+	*value = 0;
+	while(in < end && shift < 32){
+		*value |= (*in & 0x7F) << shift;
+		if(!(*in++ & 0x80)){ return in; }
+		shift += 7;
+	}
+	return NULL;
+}
+
+/**
+ * Returns the predicted value of a pixel of a key frame: the pixel on the left, or above at the start of a row.
+ *
+ * @param Pointer to the depth map
+ * @param Position of the pixel
+ */
+static int predictPixel(const short* data, int pixelPos){
+	if(pixelPos%DEPTHWIDTH){ return data[pixelPos-1]; }
+	if(pixelPos >= DEPTHWIDTH){ return data[pixelPos-DEPTHWIDTH]; }
+	return 0;
+}
+
+/**
+ * Compresses a depth map.
+ * The residuals (difference from the previous frame, or from predictPixel for key frames) are coded
+ * as runs of zeros followed by runs of non-zero values, all written with writeVarint.
+ * Returns the size of the compressed block.
+ *
+ * @param Pointer to the compressed block
+ * @param Pointer to the depth map
+ * @param Pointer to the previous depth map, NULL for a key frame
+ */
+static size_t encodeFrame(unsigned char* block, const short* data, const short* previous){
+	unsigned char* out = block;
+	int i = 0, j, residual;
+	while(i < DEPTHSIZE){
+		//run of zeros
+		j = i;
+		while(j < DEPTHSIZE && data[j] == (previous != NULL? previous[j] : predictPixel(data, j))){ j++; }
+		out = writeVarint(out, j-i);
+		i = j;
+		//run of non-zero values
+		while(j < DEPTHSIZE && data[j] != (previous != NULL? previous[j] : predictPixel(data, j))){ j++; }
+		out = writeVarint(out, j-i);
+		for(; i<j; i++){
+			residual = data[i] - (previous != NULL? previous[i] : predictPixel(data, i));
+			//zigzag coding of the sign
+			out = writeVarint(out, residual >= 0? 2*residual : -2*residual-1);
+		}
+	}
+	return out - block;
+}
+
+/**
+ * Decompresses a depth map in place.
+ * For other frames than key frames, the depth map must contain the previous frame.
+ * Returns 0 if the operation is a success and 1 if the block is corrupted.
+ *
+ * @param Pointer to the depth map
+ * @param Pointer to the compressed block
+ * @param Size of the compressed block
+ * @param 1 for a key frame, 0 otherwise
+ */
+static int decodeBlock(short* data, const unsigned char* block, size_t size, int keyFrame){
+	const unsigned char* end = block + size;
+	unsigned int run, value;
+	int i = 0;
+	while(i < DEPTHSIZE){
+		//run of zeros
+		block = readVarint(block, end, &run);
+		if(block == NULL || run > (unsigned int)(DEPTHSIZE-i)){ return 1; }
+		for(; run>0; run--, i++){
+			if(keyFrame){ data[i] = predictPixel(data, i); }
+		}
+		//run of non-zero values
+		block = readVarint(block, end, &run);
+		if(block == NULL || run > (unsigned int)(DEPTHSIZE-i)){ return 1; }
+		for(; run>0; run--, i++){
+			block = readVarint(block, end, &value);
+			if(block == NULL){ return 1; }
+			int residual = value & 1? -(int)(value>>1)-1 : (int)(value>>1);
+			data[i] = (keyFrame? predictPixel(data, i) : data[i]) + residual;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Creates a new recording.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the recorder
+ * @param Name of the recorded file
+ */
+int openRecorder(TRecorder* pRecorder, const char* fileName){
+	TRecordingHeader header;
+	memset(&header, 0, sizeof(header));
+	pRecorder->block = malloc(MAXBLOCKSIZE);
+	if(pRecorder->block == NULL){ return 1; }
+	pRecorder->pFile = fopen(fileName, "wb");
+	if(pRecorder->pFile == NULL){
+		free(pRecorder->block);
+		return 1;
+	}
+	//header is completed when the recording is closed
+	if(fwrite(&header, sizeof(header), 1, pRecorder->pFile) != 1){
+		fclose(pRecorder->pFile);
+		free(pRecorder->block);
+		return 1;
+	}
+	pRecorder->index = NULL;
+	pRecorder->nbFrames = 0;
+	pRecorder->capacity = 0;
+	return 0;
+}
+
+/**
+ * Compresses a depth map and writes it at the end of a recording.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the recorder
+ * @param Pointer to the depth map
+ * @param Time stamp of the depth map
+ */
+int recordFrame(TRecorder* pRecorder, const short* data, unsigned int timestamp){
+	//grow index if needed
+	if(pRecorder->nbFrames == pRecorder->capacity){
+		int capacity = pRecorder->capacity? 2*pRecorder->capacity : 1024;
+		TRecordingIndex* index = realloc(pRecorder->index, capacity*sizeof(TRecordingIndex));
+		if(index == NULL){ return 1; }
+		pRecorder->index = index;
+		pRecorder->capacity = capacity;
+	}
+	//compress frame
+	int keyFrame = pRecorder->nbFrames%KEYFRAMEINTERVAL == 0;
+	size_t size = encodeFrame(pRecorder->block, data, keyFrame? NULL : pRecorder->previous);
+	long offset = ftell(pRecorder->pFile);
+	if(offset == -1){ return 1; }
+	TRecordingIndex* entry = &(pRecorder->index[pRecorder->nbFrames]);
+	entry->offset = offset;
+	entry->size = size;
+	entry->timestamp = timestamp;
+	if(fwrite(pRecorder->block, 1, size, pRecorder->pFile) != size){ return 1; }
+	memcpy(pRecorder->previous, data, sizeof(pRecorder->previous));
+	pRecorder->nbFrames++;
+	return 0;
+}
+
+/**
+ * Writes the index of a recording and closes it.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the recorder
+ */
+int closeRecorder(TRecorder* pRecorder){
+	int ret = 0;
+	TRecordingHeader header;
+	memcpy(header.magic, RECORDINGMAGIC, 4);
+	header.version = RECORDINGVERSION;
+	header.width = DEPTHWIDTH;
+	header.height = DEPTHHEIGHT;
+	header.nbFrames = pRecorder->nbFrames;
+	header.keyInterval = KEYFRAMEINTERVAL;
+	//align index so that it can be read directly from the mapping
+	long pos = ftell(pRecorder->pFile);
+	if(pos == -1){ ret = 1; }
+	while(!ret && pos%8){
+		if(fputc(0, pRecorder->pFile) == EOF){ ret = 1; }
+		pos++;
+	}
+	header.indexOffset = pos;
+	if(ret || fwrite(pRecorder->index, sizeof(TRecordingIndex), pRecorder->nbFrames, pRecorder->pFile) != (size_t)pRecorder->nbFrames){ ret = 1; }
+	//complete header
+	rewind(pRecorder->pFile);
+	if(fwrite(&header, sizeof(header), 1, pRecorder->pFile) != 1){ ret = 1; }
+	if(fclose(pRecorder->pFile)){ ret = 1; }
+	free(pRecorder->index);
+	free(pRecorder->block);
+	return ret;
+}
+
+/**
+ * Checks whether a file is a recording.
+ * Returns 1 if the file starts with the header of a recording and 0 otherwise.
+ *
+ * @param Name of the file
+ */
+int isRecording(const char* fileName){
+	char magic[4];
+	FILE* pFile = fopen(fileName, "rb");
+	if(pFile == NULL){ return 0; }
+	int ret = fread(magic, 1, 4, pFile) == 4 && memcmp(magic, RECORDINGMAGIC, 4) == 0;
+	fclose(pFile);
+	return ret;
+}
+
+/**
+ * Memory maps a recording.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the recording
+ * @param Name of the recorded file
+ */
+int openRecording(TRecording* pRecording, const char* fileName){
+	struct stat st;
+	int fd = open(fileName, O_RDONLY);
+	if(fd == -1){ return 1; }
+	if(fstat(fd, &st) || (size_t)st.st_size < sizeof(TRecordingHeader)){
+		close(fd);
+		return 1;
+	}
+	void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED){ return 1; }
+	pRecording->map = map;
+	pRecording->size = st.st_size;
+	pRecording->header = map;
+	pRecording->current = -1;
+	//check header and index
+	const TRecordingHeader* header = pRecording->header;
+	if(memcmp(header->magic, RECORDINGMAGIC, 4) || header->version != RECORDINGVERSION
+		|| header->width != DEPTHWIDTH || header->height != DEPTHHEIGHT || header->keyInterval == 0
+		|| header->indexOffset%8 || header->indexOffset > pRecording->size
+		|| (pRecording->size - header->indexOffset)/sizeof(TRecordingIndex) < header->nbFrames){
+		closeRecording(pRecording);
+		return 1;
+	}
+	pRecording->index = (const TRecordingIndex*)(pRecording->map + header->indexOffset);
+	return 0;
+}
+
+/**
+ * Returns the number of frames of a recording.
+ *
+ * @param Pointer to the recording
+ */
+int recordingLength(const TRecording* pRecording){
+	return pRecording->header->nbFrames;
+}
+
+/**
+ * Decodes any frame of a recording.
+ * Decoding starts from the previous key frame unless the previous frame was the last one decoded.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the recording
+ * @param Number of the frame
+ * @param Pointer to the depth map
+ * @param Pointer to the time stamp
+ */
+int decodeFrame(TRecording* pRecording, int frame, short** data, unsigned int* timestamp){
+	if(frame < 0 || frame >= recordingLength(pRecording)){ return 1; }
+	int keyInterval = pRecording->header->keyInterval;
+	int i = pRecording->current+1;
+	//seek to previous key frame
+	if(i != frame && frame != pRecording->current){
+		i = frame - frame%keyInterval;
+	}
+	for(; i<=frame; i++){
+		const TRecordingIndex* entry = &(pRecording->index[i]);
+		if(entry->offset > pRecording->size || entry->size > pRecording->size - entry->offset
+			|| decodeBlock(pRecording->data, pRecording->map + entry->offset, entry->size, i%keyInterval == 0)){
+			pRecording->current = -1;
+			return 1;
+		}
+		pRecording->current = i;
+	}
+	*data = pRecording->data;
+	if(timestamp != NULL){
+		*timestamp = pRecording->index[frame].timestamp;
+	}
+	return 0;
+}
+
+/**
+ * Unmaps a recording.
+ *
+ * @param Pointer to the recording
+ */
+void closeRecording(TRecording* pRecording){
+	munmap((void*)pRecording->map, pRecording->size);
+	pRecording->map = NULL;
+}
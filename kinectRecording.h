@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include "kinectDetectionUtil.h"
+
+#define RECORDINGMAGIC "KDRC"
+#define RECORDINGVERSION 1
+#define KEYFRAMEINTERVAL 30
+
+/// Header at the beginning of a recording.
+/// The index of the frames is written at indexOffset when the recording is closed.
+typedef struct{
+	char magic[4];
+	uint32_t version;
+	uint32_t width, height;
+	uint32_t nbFrames;
+	uint32_t keyInterval;
+	uint64_t indexOffset;
+}TRecordingHeader;
+
+/// Entry of the index of a recording.
+/// Each frame is stored as a compressed block of size bytes starting at offset.
+typedef struct{
+	uint64_t offset;
+	uint32_t size;
+	uint32_t timestamp;
+}TRecordingIndex;
+
+/// Structure used to write a recording.
+/// Every KEYFRAMEINTERVAL frames, a frame is coded on its own (key frame).
+/// Other frames are coded as the difference from the previous frame.
+typedef struct{
+	FILE* pFile;
+	short previous[DEPTHSIZE];
+	unsigned char* block;
+	TRecordingIndex* index;
+	int nbFrames;
+	int capacity;
+}TRecorder;
+
+/// Structure used to read a recording.
+/// The file is memory mapped and frames are decoded directly from the mapping into data.
+/// The current value is the number of the frame contained in data, -1 if none.
+typedef struct{
+	const unsigned char* map;
+	size_t size;
+	const TRecordingHeader* header;
+	const TRecordingIndex* index;
+	int current;
+	short data[DEPTHSIZE];
+}TRecording;
+
+
+/**
+ * Creates a new recording.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the recorder
+ * @param Name of the recorded file
+ */
+int openRecorder(TRecorder* pRecorder, const char* fileName);
+
+/**
+ * Compresses a depth map and writes it at the end of a recording.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the recorder
+ * @param Pointer to the depth map
+ * @param Time stamp of the depth map
+ */
+int recordFrame(TRecorder* pRecorder, const short* data, unsigned int timestamp);
+
+/**
+ * Writes the index of a recording and closes it.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the recorder
+ */
+int closeRecorder(TRecorder* pRecorder);
+
+/**
+ * Checks whether a file is a recording.
+ * Returns 1 if the file starts with the header of a recording and 0 otherwise.
+ *
+ * @param Name of the file
+ */
+int isRecording(const char* fileName);
+
+/**
+ * Memory maps a recording.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the recording
+ * @param Name of the recorded file
+ */
+int openRecording(TRecording* pRecording, const char* fileName);
+
+/**
+ * Returns the number of frames of a recording.
+ *
+ * @param Pointer to the recording
+ */
+int recordingLength(const TRecording* pRecording);
+
+/**
+ * Decodes any frame of a recording.
+ * Decoding starts from the previous key frame unless the previous frame was the last one decoded.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the recording
+ * @param Number of the frame
+ * @param Pointer to the depth map
+ * @param Pointer to the time stamp
+ */
+int decodeFrame(TRecording* pRecording, int frame, short** data, unsigned int* timestamp);
+
+/**
+ * Unmaps a recording.
+ *
+ * @param Pointer to the recording
+ */
+void closeRecording(TRecording* pRecording);
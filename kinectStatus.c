@@ -0,0 +1,100 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include "kinectStatus.h"
+
+/**
+ * Renders a status in the terminal, from the top left corner.
+ *
+ * @param Pointer to the status
+ */
+static void renderStatus(const TStatus* status){
+	//move to the top left corner and clear the screen with ANSI escapes
+	fputs("\033[H\033[2J", stdout);
+	puts("Press Enter to exit.\n\n---------------\nLIST:");
+	displayVecList(&(status->list));
+	printf("\nFrame: %u\n", status->frame);
+	if(status->tracked){
+		printf("Position: %.0f, %.0f, %.0f\n", status->position.x, status->position.y, status->position.z);
+	}else{
+		puts("Position: lost");
+	}
+	printf("Confidence: %.2f\n", status->confidence);
+	fflush(stdout);
+}
+
+/**
+ * Function executed in a thread to render the newest status until the display is stopped.
+ *
+ * @param Pointer to the status display
+ */
+static void *statusLoop(void *pArg){
+	TStatusDisplay* display = pArg;
+	struct timespec deadline;
+	long period = 1e9/display->rate;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	while(atomic_load(&(display->running))){
+		//render the newest status if it was not rendered yet
+		if(takeBuffer(&(display->exchange)) == 0){
+			renderStatus(&(display->slot[display->exchange.front]));
+		}
+		//wait for the next rendering
+		deadline.tv_nsec += period;
+		while(deadline.tv_nsec >= 1000000000L){
+			deadline.tv_nsec -= 1000000000L;
+			deadline.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+	}
+	pthread_exit(NULL);
+}
+
+/**
+ * Starts a low priority thread rendering the newest status a given number of times per second.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the status display
+ * @param Number of renderings per second, 0 or less for no display
+ */
+int startStatusDisplay(TStatusDisplay* display, float rate){
+	initBufferExchange(&(display->exchange));
+	display->rate = rate;
+	atomic_init(&(display->running), rate > 0);
+	if(rate <= 0){ return 0; }
+	if(pthread_create(&(display->thread), NULL, statusLoop, display)){
+		atomic_store(&(display->running), 0);
+		display->rate = 0;
+		return 1;
+	}
+#ifdef SCHED_IDLE
+	//only run the display when the processing threads are idle
+	struct sched_param param = {0};
+	pthread_setschedparam(display->thread, SCHED_IDLE, &param);
+#endif
+	return 0;
+}
+
+/**
+ * Publishes a status to be displayed, without waiting for the terminal.
+ *
+ * @param Pointer to the status display
+ * @param Pointer to the status
+ */
+void publishStatus(TStatusDisplay* display, const TStatus* status){
+	if(display->rate <= 0){ return; }
+	display->slot[display->exchange.back] = *status;
+	publishBuffer(&(display->exchange));
+}
+
+/**
+ * Stops the display thread.
+ *
+ * @param Pointer to the status display
+ */
+void stopStatusDisplay(TStatusDisplay* display){
+	if(display->rate <= 0){ return; }
+	atomic_store(&(display->running), 0);
+	pthread_join(display->thread, NULL);
+	display->rate = 0;
+}
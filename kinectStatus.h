@@ -0,0 +1,54 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "kinectDetectionUtil.h"
+#include "kinectExchange.h"
+
+#define STATUSRATE 5
+
+/// Structure containing the state of the detection shown to the user.
+/// The position is the filtered position of the drone, valid if tracked is set.
+typedef struct{
+	TVecList list;
+	TVec4D position;
+	int tracked;
+	float confidence;
+	unsigned int frame;
+}TStatus;
+
+/// Structure representing the thread displaying the status in the terminal.
+/// The loop publishes snapshots in a triple buffer (see kinectExchange.h), the display thread renders the newest one.
+/// A rate of 0 or less disables the display (headless mode).
+typedef struct{
+	TStatus slot[3];
+	TBufferExchange exchange;
+	float rate;
+	atomic_int running;
+	pthread_t thread;
+}TStatusDisplay;
+
+
+/**
+ * Starts a low priority thread rendering the newest status a given number of times per second.
+ * Returns 0 if the operation is a success and 1 in case of a failure.
+ *
+ * @param Pointer to the status display
+ * @param Number of renderings per second, 0 or less for no display
+ */
+int startStatusDisplay(TStatusDisplay* display, float rate);
+
+/**
+ * Publishes a status to be displayed, without waiting for the terminal.
+ *
+ * @param Pointer to the status display
+ * @param Pointer to the status
+ */
+void publishStatus(TStatusDisplay* display, const TStatus* status);
+
+/**
+ * Stops the display thread.
+ *
+ * @param Pointer to the status display
+ */
+void stopStatusDisplay(TStatusDisplay* display);
@@ -0,0 +1,217 @@
+#include <math.h>
+#include "kinectTracking.h"
+
+/**
+ * Initializes a tracker, the drone is considered lost until it is detected.
+ *
+ * @param Pointer to the tracker
+ * @param Part of the samples taken in the tracking window
+ */
+void initRegionTracker(TRegionTracker* tracker, float ratio){
+	tracker->position.x = tracker->position.y = tracker->position.z = 0;
+	tracker->position.w = 1;
+	tracker->velocity.x = tracker->velocity.y = tracker->velocity.z = tracker->velocity.w = 0;
+	tracker->speed = 0;
+	tracker->lost = TRACKMAXLOST + 1;
+	tracker->ratio = ratio;
+}
+
+/**
+ * Updates a tracker with the detected position of the drone.
+ *
+ * @param Pointer to the tracker
+ * @param Pointer to the detected position, NULL if the drone was not detected
+ */
+void updateRegionTracker(TRegionTracker* tracker, const TVec4D* position){
+	if(position == NULL){
+		tracker->lost++;
+		return;
+	}
+	if(tracker->lost <= TRACKMAXLOST){
+		//smooth the velocity over the steps since the last detection
+		float steps = tracker->lost + 1;
+		tracker->velocity.x = 0.5*tracker->velocity.x + 0.5*(position->x - tracker->position.x)/steps;
+		tracker->velocity.y = 0.5*tracker->velocity.y + 0.5*(position->y - tracker->position.y)/steps;
+		tracker->velocity.z = 0.5*tracker->velocity.z + 0.5*(position->z - tracker->position.z)/steps;
+	}else{
+		//new target, unknown velocity
+		tracker->velocity.x = tracker->velocity.y = tracker->velocity.z = 0;
+	}
+	tracker->speed = sqrt(tracker->velocity.x*tracker->velocity.x + tracker->velocity.y*tracker->velocity.y + tracker->velocity.z*tracker->velocity.z);
+	tracker->position = *position;
+	tracker->position.w = 1;
+	tracker->lost = 0;
+}
+
+/**
+ * Computes the sampling window of a camera around the predicted position of the drone.
+ * The size of the window depends on the speed of the drone and on the time since its last detection.
+ * If the drone is lost or out of view, the ratio of the window is 0 and the whole depth map is sampled.
+ *
+ * @param Pointer to the tracker
+ * @param Pointer to the intrinsic parameters of the camera
+ * @param Pointer to the transformation from the tracker base to the camera base, NULL for none
+ * @param Pointer to the sampling window
+ */
+void trackerWindow(const TRegionTracker* tracker, const TIntrinsics* intr, const TMatrix4D* toCamera, TSamplingWindow* window){
+	window->x0 = window->y0 = 0;
+	window->x1 = DEPTHWIDTH;
+	window->y1 = DEPTHHEIGHT;
+	window->ratio = 0;
+	if(tracker->lost > TRACKMAXLOST){ return; }
+	//predict the position of the drone
+	float steps = tracker->lost + 1;
+	TVec4D predicted = tracker->position;
+	predicted.x += tracker->velocity.x*steps;
+	predicted.y += tracker->velocity.y*steps;
+	predicted.z += tracker->velocity.z*steps;
+	if(toCamera != NULL){
+		transformVec4D(&predicted, toCamera);
+	}
+	//project it with the radius of the search area
+	float xs, ys;
+	if(vec4DToPixel(intr, &predicted, &xs, &ys)){ return; }
+	float radius = TRACKRADIUS + (tracker->speed + TRACKMINSPEED)*steps;
+	float radiusX = radius/(predicted.y*intr->scaleX);
+	float radiusY = radius/(predicted.y*intr->scaleZ);
+	//out of view
+	if(xs + radiusX < 0 || xs - radiusX >= DEPTHWIDTH || ys + radiusY < 0 || ys - radiusY >= DEPTHHEIGHT){ return; }
+	window->x0 = (xs - radiusX > 0) ? xs - radiusX : 0;
+	window->y0 = (ys - radiusY > 0) ? ys - radiusY : 0;
+	window->x1 = (xs + radiusX + 1 < DEPTHWIDTH) ? xs + radiusX + 1 : DEPTHWIDTH;
+	window->y1 = (ys + radiusY + 1 < DEPTHHEIGHT) ? ys + radiusY + 1 : DEPTHHEIGHT;
+	window->ratio = tracker->ratio;
+}
+
+/**
+ * Initializes a Kalman tracker, the track is lost until a first measurement.
+ *
+ * @param Pointer to the Kalman tracker
+ * @param Standard deviation of the acceleration of the drone, in mm/s^2
+ * @param Standard deviation of the measured positions, in mm
+ */
+void initKalmanTracker(TKalmanTracker* kalman, float accelNoise, float measureNoise){
+	int i;
+	for(i=0; i<3; i++){
+		kalman->position[i] = kalman->velocity[i] = 0;
+		kalman->pp[i] = kalman->pv[i] = kalman->vv[i] = 0;
+	}
+	kalman->accelNoise = accelNoise;
+	kalman->measureNoise = measureNoise;
+	kalman->misses = KALMANMAXMISSES + 1;
+	kalman->confidence = 0;
+}
+
+/**
+ * Starts a new track on a measured position, with an unknown velocity.
+ *
+ * @param Pointer to the Kalman tracker
+ * @param Pointer to the measured position
+ */
+static void restartKalmanTracker(TKalmanTracker* kalman, const TVec4D* vec){
+	int i;
+	kalman->position[0] = vec->x;
+	kalman->position[1] = vec->y;
+	kalman->position[2] = vec->z;
+	for(i=0; i<3; i++){
+		kalman->velocity[i] = 0;
+		kalman->pp[i] = kalman->measureNoise*kalman->measureNoise;
+		kalman->pv[i] = 0;
+		kalman->vv[i] = KALMANINITSPEED*KALMANINITSPEED;
+	}
+	kalman->misses = 0;
+	kalman->confidence = 0.2;
+}
+
+/**
+ * Predicts the state of a Kalman tracker after some time, without measurement.
+ *
+ * @param Pointer to the Kalman tracker
+ * @param Time since the last prediction, in seconds
+ */
+void predictKalmanTracker(TKalmanTracker* kalman, float dt){
+	int i;
+	float q = kalman->accelNoise*kalman->accelNoise;
+	float dt2 = dt*dt;
+	for(i=0; i<3; i++){
+		kalman->position[i] += kalman->velocity[i]*dt;
+		//P = F.P.Ft + Q with a white noise acceleration
+		kalman->pp[i] += 2*dt*kalman->pv[i] + dt2*kalman->vv[i] + q*dt2*dt2/4;
+		kalman->pv[i] += dt*kalman->vv[i] + q*dt2*dt/2;
+		kalman->vv[i] += q*dt2;
+	}
+}
+
+/**
+ * Updates a Kalman tracker with the vectors detected in the current step.
+ * The state is predicted, then corrected with the heaviest vector inside the gate.
+ * The gate is a Mahalanobis distance of KALMANGATE (99% for 3 dimensions).
+ * A lost track restarts on the heaviest vector of the list.
+ * Returns 0 if a measurement was accepted and 1 if the state was only predicted.
+ *
+ * @param Pointer to the Kalman tracker
+ * @param Pointer to the vector list, NULL if nothing was detected
+ * @param Time since the last update, in seconds
+ */
+int updateKalmanTracker(TKalmanTracker* kalman, const TVecList* list, float dt){
+	int i, j, best = -1;
+	float r = kalman->measureNoise*kalman->measureNoise;
+	if(kalman->misses > KALMANMAXMISSES){
+		//lost track, restart on the heaviest vector
+		if(list == NULL || list->n == 0){ return 1; }
+		for(j=0; j<list->n; j++){
+			if(best < 0 || list->weight[j] > list->weight[best]){ best = j; }
+		}
+		restartKalmanTracker(kalman, &(list->vector[best]));
+		return 0;
+	}
+	predictKalmanTracker(kalman, dt);
+	//heaviest vector inside the gate
+	for(j=0; list != NULL && j<list->n; j++){
+		const TVec4D* v = &(list->vector[j]);
+		float dx = v->x - kalman->position[0];
+		float dy = v->y - kalman->position[1];
+		float dz = v->z - kalman->position[2];
+		float d2 = dx*dx/(kalman->pp[0] + r) + dy*dy/(kalman->pp[1] + r) + dz*dz/(kalman->pp[2] + r);
+		if(d2 < KALMANGATE && (best < 0 || list->weight[j] > list->weight[best])){ best = j; }
+	}
+	if(best < 0){
+		kalman->misses++;
+		kalman->confidence *= 0.8;
+		return 1;
+	}
+	//correct each axis
+	const TVec4D* v = &(list->vector[best]);
+	float z[3] = {v->x, v->y, v->z};
+	for(i=0; i<3; i++){
+		float s = kalman->pp[i] + r;
+		float kp = kalman->pp[i]/s;
+		float kv = kalman->pv[i]/s;
+		float y = z[i] - kalman->position[i];
+		kalman->position[i] += kp*y;
+		kalman->velocity[i] += kv*y;
+		kalman->vv[i] -= kv*kalman->pv[i];
+		kalman->pp[i] *= 1 - kp;
+		kalman->pv[i] *= 1 - kp;
+	}
+	kalman->misses = 0;
+	kalman->confidence += 0.2*(1 - kalman->confidence);
+	return 0;
+}
+
+/**
+ * Gives the position of a Kalman tracker extrapolated with its velocity.
+ * Returns 0 if the operation is a success and 1 if the track is lost.
+ *
+ * @param Pointer to the Kalman tracker
+ * @param Time to extrapolate, in seconds, 0 for the current estimate
+ * @param Pointer to the position
+ */
+int kalmanPosition(const TKalmanTracker* kalman, float dt, TVec4D* vec){
+	if(kalman->misses > KALMANMAXMISSES){ return 1; }
+	vec->x = kalman->position[0] + kalman->velocity[0]*dt;
+	vec->y = kalman->position[1] + kalman->velocity[1]*dt;
+	vec->z = kalman->position[2] + kalman->velocity[2]*dt;
+	vec->w = 1;
+	return 0;
+}
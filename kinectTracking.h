@@ -0,0 +1,109 @@
+#pragma once
+
+#include "kinectDetectionUtil.h"
+
+#define TRACKRADIUS 300
+#define TRACKMINSPEED 50
+#define TRACKMAXLOST 10
+#define TRACKRATIO 0.8
+
+/// Structure following the position of the drone from one processing step to the next.
+/// The velocity is given in millimetres per step, lost is the number of steps without detection.
+/// The ratio is the part of the samples taken in the tracking window.
+typedef struct{
+	TVec4D position;
+	TVec4D velocity;
+	float speed;
+	int lost;
+	float ratio;
+}TRegionTracker;
+
+
+/**
+ * Initializes a tracker, the drone is considered lost until it is detected.
+ *
+ * @param Pointer to the tracker
+ * @param Part of the samples taken in the tracking window
+ */
+void initRegionTracker(TRegionTracker* tracker, float ratio);
+
+/**
+ * Updates a tracker with the detected position of the drone.
+ *
+ * @param Pointer to the tracker
+ * @param Pointer to the detected position, NULL if the drone was not detected
+ */
+void updateRegionTracker(TRegionTracker* tracker, const TVec4D* position);
+
+/**
+ * Computes the sampling window of a camera around the predicted position of the drone.
+ * The size of the window depends on the speed of the drone and on the time since its last detection.
+ * If the drone is lost or out of view, the ratio of the window is 0 and the whole depth map is sampled.
+ *
+ * @param Pointer to the tracker
+ * @param Pointer to the intrinsic parameters of the camera
+ * @param Pointer to the transformation from the tracker base to the camera base, NULL for none
+ * @param Pointer to the sampling window
+ */
+void trackerWindow(const TRegionTracker* tracker, const TIntrinsics* intr, const TMatrix4D* toCamera, TSamplingWindow* window);
+
+#define KALMANGATE 11.34
+#define KALMANMAXMISSES 15
+#define KALMANACCELNOISE 3000
+#define KALMANMEASURENOISE 40
+#define KALMANINITSPEED 2000
+
+/// Structure filtering the position of the drone with a constant velocity Kalman filter.
+/// The axes are independent, each one has a 2x2 covariance (pp, pv, vv) on its position and velocity.
+/// Positions are given in millimetres and velocities in millimetres per second.
+/// Misses is the number of updates without an accepted measurement, the track is lost after KALMANMAXMISSES.
+/// The confidence goes towards 1 with accepted measurements and towards 0 with misses.
+typedef struct{
+	float position[3];
+	float velocity[3];
+	float pp[3], pv[3], vv[3];
+	float accelNoise;
+	float measureNoise;
+	int misses;
+	float confidence;
+}TKalmanTracker;
+
+/**
+ * Initializes a Kalman tracker, the track is lost until a first measurement.
+ *
+ * @param Pointer to the Kalman tracker
+ * @param Standard deviation of the acceleration of the drone, in mm/s^2
+ * @param Standard deviation of the measured positions, in mm
+ */
+void initKalmanTracker(TKalmanTracker* kalman, float accelNoise, float measureNoise);
+
+/**
+ * Predicts the state of a Kalman tracker after some time, without measurement.
+ *
+ * @param Pointer to the Kalman tracker
+ * @param Time since the last prediction, in seconds
+ */
+void predictKalmanTracker(TKalmanTracker* kalman, float dt);
+
+/**
+ * Updates a Kalman tracker with the vectors detected in the current step.
+ * The state is predicted, then corrected with the heaviest vector inside the gate.
+ * The gate is a Mahalanobis distance of KALMANGATE (99% for 3 dimensions).
+ * A lost track restarts on the heaviest vector of the list.
+ * Returns 0 if a measurement was accepted and 1 if the state was only predicted.
+ *
+ * @param Pointer to the Kalman tracker
+ * @param Pointer to the vector list, NULL if nothing was detected
+ * @param Time since the last update, in seconds
+ */
+int updateKalmanTracker(TKalmanTracker* kalman, const TVecList* list, float dt);
+
+/**
+ * Gives the position of a Kalman tracker extrapolated with its velocity.
+ * Returns 0 if the operation is a success and 1 if the track is lost.
+ *
+ * @param Pointer to the Kalman tracker
+ * @param Time to extrapolate, in seconds, 0 for the current estimate
+ * @param Pointer to the position
+ */
+int kalmanPosition(const TKalmanTracker* kalman, float dt, TVec4D* vec);
@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "kinectPacket.h"
+
+#define PORT 5005
+#define TESTPACKETS 1000
+
+///prototypes
+int openReceiver(int port, struct sockaddr_in* addr);
+int receiveLoop(int s);
+int loopbackTest();
+
+///functions
+int main(int argc, char* argv[])
+{
+	//input parameters
+	if(argc > 2){
+		printf("usage: %s [<port> | test]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if(argc == 2 && strcmp(argv[1], "test") == 0){
+		return loopbackTest();
+	}
+	struct sockaddr_in addr;
+	int s = openReceiver((argc == 2)? atoi(argv[1]) : PORT, &addr);
+	if(s == -1){
+		fprintf(stderr, "Could not open the UDP port.\n");
+		return EXIT_FAILURE;
+	}
+	printf("Listening on port %d, legacy and position packets.\n", ntohs(addr.sin_port));
+	return receiveLoop(s);
+}
+
+/**
+ * Opens a UDP socket bound to a port of all interfaces, 0 for any free port.
+ * Returns the socket, or -1 in case of a failure.
+ *
+ * @param Port to listen on
+ * @param Pointer to the bound address
+ */
+int openReceiver(int port, struct sockaddr_in* addr){
+	socklen_t length = sizeof(struct sockaddr_in);
+	int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if(s == -1){
+		return -1;
+	}
+	memset(addr, 0, sizeof(struct sockaddr_in));
+	addr->sin_family = AF_INET;
+	addr->sin_port = htons(port);
+	addr->sin_addr.s_addr = htonl(INADDR_ANY);
+	if(bind(s, (struct sockaddr*)addr, length) || getsockname(s, (struct sockaddr*)addr, &length)){
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+/**
+ * Prints every packet received on a socket, with the losses, reordering and age of the position packets.
+ * Corrupted packets are counted and ignored.
+ *
+ * @param Socket to read
+ */
+int receiveLoop(int s){
+	char buf[256];
+	TPositionPacket packet;
+	short data[3];
+	char type;
+	uint32_t expected = 0;
+	long received = 0, lost = 0, late = 0, corrupted = 0;
+	while(1){
+		int length = recv(s, buf, sizeof(buf), 0);
+		if(length < 0){
+			fprintf(stderr, "recv() failed\n");
+			return EXIT_FAILURE;
+		}
+		if(length == LEGACYPACKETSIZE){
+			if(readPacket(buf, length, &type, data)){
+				corrupted++;
+				continue;
+			}
+			printf("%c %6d %6d %6d\n", type, data[0], data[1], data[2]);
+			continue;
+		}
+		if(decodePositionPacket(buf, length, &packet)){
+			corrupted++;
+			continue;
+		}
+		//a sequence number below the expected one arrived late, above it some packets were lost
+		if(received > 0 && (int32_t)(packet.sequence - expected) < 0){
+			late++;
+		}else{
+			if(received > 0){ lost += packet.sequence - expected; }
+			expected = packet.sequence + 1;
+		}
+		received++;
+		printf("#%u %s x %8.1f y %8.1f z %8.1f  v %7.1f %7.1f %7.1f mm/s  conf %.2f weight %d cameras %02x  age %.1f ms  (lost %ld late %ld corrupted %ld)\n",
+			packet.sequence, (packet.flags & POSITIONTRACKED)? "tracked" : "lost   ",
+			packet.position[0], packet.position[1], packet.position[2],
+			packet.velocity[0], packet.velocity[1], packet.velocity[2],
+			packet.confidence, packet.weight, packet.cameraMask,
+			((int64_t)(packetTime() - packet.time))/1000.0, lost, late, corrupted);
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Sends position and legacy packets to itself through the loopback interface and checks that they are decoded
+ * unchanged, and that corrupted, truncated and unknown packets are rejected.
+ * Returns EXIT_SUCCESS if all checks pass.
+ */
+int loopbackTest(){
+	struct sockaddr_in addr;
+	char buf[256];
+	TPositionPacket sent, decoded;
+	short data[3];
+	char type;
+	int i, j, failures = 0;
+	int s = openReceiver(0, &addr);
+	if(s == -1){
+		fprintf(stderr, "Could not open the UDP port.\n");
+		return EXIT_FAILURE;
+	}
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	//known value of the CRC32
+	if(packetCRC32("123456789", 9) != 0xCBF43926u){
+		puts("CRC32 of \"123456789\" is wrong");
+		failures++;
+	}
+	srand(0);
+	for(i=0; i<TESTPACKETS; i++){
+		memset(&sent, 0, sizeof(sent));
+		sent.version = POSITIONPACKETVERSION;
+		sent.flags = i & POSITIONTRACKED;
+		sent.sequence = 4000000000u + i;
+		sent.time = packetTime();
+		sent.captureTimestamp = rand();
+		for(j=0; j<3; j++){
+			sent.position[j] = (rand() - RAND_MAX/2)/1000.0f;
+			sent.velocity[j] = (rand() - RAND_MAX/2)/1e6f;
+		}
+		sent.confidence = rand()/(float)RAND_MAX;
+		sent.weight = rand()%32768;
+		sent.cameraMask = rand()%256;
+		int length = encodePositionPacket(buf, &sent);
+		if(sendto(s, buf, length, 0, (struct sockaddr*)&addr, sizeof(addr)) != length || recv(s, buf, sizeof(buf), 0) != length){
+			puts("Loopback send or receive failed");
+			return EXIT_FAILURE;
+		}
+		memset(&decoded, 0, sizeof(decoded));
+		if(decodePositionPacket(buf, length, &decoded) || memcmp(&sent, &decoded, sizeof(sent)) != 0){
+			printf("Packet %d decoded with other values\n", i);
+			failures++;
+		}
+		//every single bit error must be detected
+		int flip = rand()%(8*POSITIONPACKETSIZE);
+		buf[flip/8] ^= 1 << (flip%8);
+		if(decodePositionPacket(buf, length, &decoded) == 0){
+			printf("Packet %d accepted with bit %d flipped\n", i, flip);
+			failures++;
+		}
+		buf[flip/8] ^= 1 << (flip%8);
+		if(decodePositionPacket(buf, length-1, &decoded) == 0){
+			printf("Truncated packet %d accepted\n", i);
+			failures++;
+		}
+	}
+	//legacy packets are not position packets
+	writePacket(buf, LEGACYPACKETTYPE, -1234, 5678, 910);
+	if(readPacket(buf, LEGACYPACKETSIZE, &type, data) || type != LEGACYPACKETTYPE || data[0] != -1234 || data[1] != 5678 || data[2] != 910){
+		puts("Legacy packet decoded with other values");
+		failures++;
+	}
+	if(decodePositionPacket(buf, LEGACYPACKETSIZE, &decoded) == 0){
+		puts("Legacy packet accepted as a position packet");
+		failures++;
+	}
+	close(s);
+	printf("%d packets sent through the loopback interface, %d failures\n", TESTPACKETS, failures);
+	return failures? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <libfreenect_sync.h>
+#include "kinectDetectionUtil.h"
+#include "kinectRecording.h"
+
+///functions
+int main(int argc, char* argv[])
+{
+	//input parameters
+	if(argc != 3 && argc != 4){
+		printf("usage: %s <file> <number of frames> [<device>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	int nbFrames = atoi(argv[2]);
+	int id = 0;
+	if(argc == 4){
+		id = atoi(argv[3]);
+	}
+	//set Kinect angle to 0 & set LED colour
+	if(freenect_sync_set_tilt_degs(0, id)){
+		printf("Could not tilt device %d.\n", id);
+		return EXIT_FAILURE;
+	}
+	if(freenect_sync_set_led(LED_RED, id)){
+		printf("Could not change LED of device %d.\n", id);
+		return EXIT_FAILURE;
+	}
+	//open recorded file
+	TRecorder recorder;
+	if(openRecorder(&recorder, argv[1])){
+		printf("Could not open %s.\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	//set camera
+	TDepthCamera cam;
+	createPrimaryCamera(&cam, id);
+	unsigned int timestamp;
+	int i;
+	//record depth maps
+	for(i=0; i<nbFrames; i++){
+		if(updateCamera(&cam, &timestamp)){
+			printf("Could not update feed for device %d.\n", id);
+			break;
+		}
+		if(recordFrame(&recorder, cam.data, timestamp)){
+			printf("Could not write frame %d.\n", i);
+			break;
+		}
+	}
+	if(closeRecorder(&recorder)){
+		printf("Could not write index of %s.\n", argv[1]);
+	}
+	printf("%d frames recorded.\n", i);
+	//free data
+	freeCamera(&cam);
+	//stop kinects
+	freenect_sync_set_led(LED_GREEN, id);
+	freenect_sync_stop();
+	return EXIT_SUCCESS;
+}